@@ -0,0 +1,135 @@
+// Random alloc/free storm against tinyalloc's size-class bins and the
+// first-fit allocator they replaced (first_fit_alloc.c). Both replay the
+// same operations over a buffer of the same size.
+
+#include "bench_common.h"
+
+#include "first_fit_alloc.h"
+#include "tinyalloc.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#ifndef VARSWAP_NO_ALLOC_HOOKS
+#include "varswap/alloc_hooks.inl"
+#endif
+
+using namespace varswap;
+
+namespace {
+
+constexpr size_t kOps = 300000;
+constexpr size_t kSlots = 20000;
+constexpr size_t kHeapBytes = size_t(256) << 20;
+constexpr size_t kHeapBlocks = 65536;
+constexpr size_t kSplitThresh = 16;
+constexpr size_t kAlignment = 16;
+
+// A size of 0 frees the block held by `slot`; anything else allocates
+// into the (empty) slot.
+struct StormOp {
+    std::uint32_t slot;
+    std::uint32_t size;
+};
+
+// Touching a random slot frees it when full and fills it otherwise, so
+// about half the slots are live once the storm settles. One allocation in
+// ten is large (4-64 KiB); the rest are 8-512 bytes.
+std::vector<StormOp> makeStorm(unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<bool> live(kSlots, false);
+    std::vector<StormOp> ops;
+    ops.reserve(kOps);
+    for (size_t i = 0; i < kOps; ++i) {
+        auto slot = static_cast<std::uint32_t>(rng() % kSlots);
+        std::uint32_t size = 0;
+        if (!live[slot]) {
+            size = rng() % 10 == 0 ? 4096 + rng() % (60 * 1024) : 8 + rng() % 505;
+        }
+        live[slot] = !live[slot];
+        ops.push_back({slot, size});
+    }
+    return ops;
+}
+
+struct StormResult {
+    size_t failures = 0;
+    bool consistent = true;
+};
+
+template <typename Alloc, typename Free>
+StormResult replay(const std::vector<StormOp>& ops, Alloc&& alloc, Free&& free) {
+    StormResult result;
+    std::vector<unsigned char*> slots(kSlots, nullptr);
+    for (const StormOp& op : ops) {
+        unsigned char*& block = slots[op.slot];
+        if (op.size == 0) {
+            if (block && !free(block)) {
+                result.consistent = false;
+            }
+            block = nullptr;
+            continue;
+        }
+        block = static_cast<unsigned char*>(alloc(op.size));
+        if (!block) {
+            ++result.failures;
+            continue;
+        }
+        block[0] = static_cast<unsigned char>(op.slot);
+        block[op.size - 1] = static_cast<unsigned char>(op.slot);
+    }
+    for (unsigned char* block : slots) {
+        if (block && !free(block)) {
+            result.consistent = false;
+        }
+    }
+    return result;
+}
+
+std::string describe(const StormResult& result) {
+    if (!result.consistent) {
+        return "FREE FAILED";
+    }
+    return result.failures ? std::to_string(result.failures) + " failed allocations" : std::string();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    bench::ProfileReport profileReport(options.profile);
+
+    std::vector<StormOp> ops = makeStorm(1);
+    std::unique_ptr<unsigned char[]> buffer(new unsigned char[kHeapBytes]);
+    const void* base = buffer.get();
+    const void* limit = buffer.get() + kHeapBytes;
+    std::printf("alloc storm: %zu operations over %zu slots, %zu MiB heap\n", ops.size(), kSlots, kHeapBytes >> 20);
+
+    StormResult firstFit;
+    double firstFitMs = bench::bestOfMs(1, [&] {
+        ff_init(base, limit, kHeapBlocks, kSplitThresh, kAlignment, false);
+        firstFit = replay(ops, [](size_t size) { return ff_alloc(size); }, [](void* ptr) { return ff_free(ptr); });
+        firstFit.consistent = firstFit.consistent && ff_check() && ff_num_used() == 0;
+    });
+    bench::printRow("first fit (baseline)", firstFitMs, describe(firstFit));
+
+    StormResult bins;
+    double binsMs = bench::bestOfMs(3, [&] {
+        AllocProfiler::Scope phase("storm");
+        ta_heap* heap = ta_heap_init(base, limit, kHeapBlocks, kSplitThresh, kAlignment, false);
+        bins = replay(ops, [heap](size_t size) { return ta_heap_alloc(heap, size); },
+                      [heap](void* ptr) { return ta_heap_free(heap, ptr); });
+        bins.consistent = bins.consistent && ta_heap_check(heap) && ta_heap_num_used(heap) == 0;
+    });
+    char speedup[32];
+    std::snprintf(speedup, sizeof(speedup), "%.1fx", firstFitMs / binsMs);
+    std::string note = describe(bins);
+    bench::printRow("size-class bins", binsMs, note.empty() ? speedup : note);
+    return firstFit.consistent && bins.consistent ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#ifndef VARSWAP_BENCH_COMMON_H_GUARD
+#define VARSWAP_BENCH_COMMON_H_GUARD
+
+#include "framedata.h"
+#include "varswap/alloc_profile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace bench {
+
+// Flags every benchmark takes: --frames <n> sets the frames per sequence of
+// the synthetic document, --profile prints the per-phase allocation profile
+// (see varswap/alloc_profile.h) when the run ends.
+struct Options {
+    int framesPerSeq = 143;
+    bool profile = false;
+
+    bool parse(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--profile") == 0) {
+                profile = true;
+            } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+                framesPerSeq = std::atoi(argv[++i]);
+            } else {
+                std::fprintf(stderr, "usage: %s [--frames <n>] [--profile]\n", argv[0]);
+                return false;
+            }
+        }
+        return framesPerSeq > 0;
+    }
+};
+
+// Enables the allocation profiler for its lifetime when asked to and prints
+// the phase table on the way out, like ha6_var_tool --profile.
+class ProfileReport {
+public:
+    explicit ProfileReport(bool enabled)
+        : m_enabled(enabled) {
+        if (m_enabled) {
+            varswap::AllocProfiler::instance().setEnabled(true);
+        }
+    }
+    ~ProfileReport() {
+        if (!m_enabled) {
+            return;
+        }
+        varswap::AllocProfiler& profiler = varswap::AllocProfiler::instance();
+        profiler.setEnabled(false);
+        std::cout << "\nAllocation profile:\n";
+        profiler.print(std::cout);
+    }
+    ProfileReport(const ProfileReport&) = delete;
+    ProfileReport& operator=(const ProfileReport&) = delete;
+
+private:
+    bool m_enabled;
+};
+
+// Fills `data` with `framesPerSeq` frames in each of `seqCount` sequences
+// (at most the 1000 initEmpty provides). Every frame carries three IF and
+// four EF blocks drawn from the kinds the scanner tracks, so a document of
+// 1000 x 143 frames holds about 10^6 blocks.
+inline void fillSyntheticDocument(FrameData& data, int seqCount, int framesPerSeq, unsigned seed = 1) {
+    data.initEmpty();
+    std::mt19937 rng(seed);
+    seqCount = std::min(seqCount, data.get_sequence_count());
+    for (int s = 0; s < seqCount; ++s) {
+        Sequence* seq = data.get_sequence(s);
+        seq->name = "seq" + std::to_string(s);
+        seq->frames.resize(framesPerSeq);
+        for (Frame& frame : seq->frames) {
+            Frame_IF spawnCheck{};
+            spawnCheck.type = 25;
+            spawnCheck.parameters[0] = 10000 + static_cast<int>(rng() % seqCount);
+            spawnCheck.parameters[1] = static_cast<int>(rng() % 20);
+            spawnCheck.parameters[2] = static_cast<int>(rng() % 5);
+            frame.IF.push_back(spawnCheck);
+            Frame_IF varCheck{};
+            varCheck.type = 31;
+            varCheck.parameters[1] = static_cast<int>(rng() % 20);
+            varCheck.parameters[2] = 1;
+            frame.IF.push_back(varCheck);
+            Frame_IF composite{};
+            composite.type = 24;
+            composite.parameters[0] = 10000 + static_cast<int>(rng() % seqCount);
+            composite.parameters[1] = static_cast<int>(rng() % 20) * 10 + static_cast<int>(rng() % 10);
+            frame.IF.push_back(composite);
+
+            Frame_EF spawn{};
+            spawn.type = 6;
+            spawn.number = 100 + static_cast<int>(rng() % 2);
+            spawn.parameters[0] = (rng() % 2) ? static_cast<int>(600 + rng() % 50) * 100 + static_cast<int>(rng() % 100)
+                                              : static_cast<int>(rng() % 9) * 10 + static_cast<int>(rng() % 10);
+            frame.EF.push_back(spawn);
+            Frame_EF jump{};
+            jump.type = 1;
+            jump.parameters[0] = static_cast<int>(rng() % seqCount);
+            jump.parameters[8] = static_cast<int>(rng() % 20) * 10 + static_cast<int>(rng() % 10);
+            frame.EF.push_back(jump);
+            Frame_EF varSet{};
+            varSet.type = 6;
+            varSet.number = 105;
+            varSet.parameters[0] = static_cast<int>(rng() % 20);
+            varSet.parameters[1] = static_cast<int>(rng() % 5);
+            varSet.parameters[2] = static_cast<int>(rng() % 2);
+            frame.EF.push_back(varSet);
+            Frame_EF sound{};
+            sound.type = 3;
+            sound.parameters[2] = static_cast<int>(rng() % 500);
+            frame.EF.push_back(sound);
+
+            frame.AF.aniType = (rng() % 4 == 0) ? 0 : 1;
+            frame.AF.jump = static_cast<int>(rng() % seqCount);
+        }
+    }
+}
+
+// Best wall time of `runs` calls to `fn`, in milliseconds.
+template <typename Fn>
+double bestOfMs(int runs, Fn&& fn) {
+    double best = 0.0;
+    for (int run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = run == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+inline void printRow(const char* label, double ms, const std::string& note = std::string()) {
+    std::printf("  %-38s %10.3f ms  %s\n", label, ms, note.c_str());
+}
+
+} // namespace bench
+
+#endif /* VARSWAP_BENCH_COMMON_H_GUARD */
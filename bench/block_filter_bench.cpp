@@ -0,0 +1,113 @@
+// Parameter filters over a 10^6-block document: ParamIndex lookups and
+// BlockTable::select scans against walking sequences -> frames -> blocks.
+
+#include "bench_common.h"
+
+#include "varswap/block_table.h"
+#include "varswap/param_index.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef VARSWAP_NO_ALLOC_HOOKS
+#include "varswap/alloc_hooks.inl"
+#endif
+
+using namespace varswap;
+
+namespace {
+
+size_t walkDocument(const FrameData& data, const ParamQuery& query) {
+    size_t hits = 0;
+    for (int seqIdx = 0; seqIdx < data.get_sequence_count(); ++seqIdx) {
+        const Sequence* seq = data.peek_sequence(seqIdx);
+        if (!seq) {
+            continue;
+        }
+        for (const Frame& frame : seq->frames) {
+            if (query.isEffect) {
+                for (const Frame_EF& effect : frame.EF) {
+                    int value = effect.parameters[query.slot];
+                    hits += effect.type == query.type &&
+                            (query.number == kAnyNumber || effect.number == query.number) && value >= query.min &&
+                            value <= query.max;
+                }
+            } else {
+                for (const Frame_IF& cond : frame.IF) {
+                    int value = cond.parameters[query.slot];
+                    hits += cond.type == query.type && value >= query.min && value <= query.max;
+                }
+            }
+        }
+    }
+    return hits;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    bench::ProfileReport profileReport(options.profile);
+
+    FrameData data;
+    {
+        AllocProfiler::Scope phase("load");
+        bench::fillSyntheticDocument(data, 1000, options.framesPerSeq);
+    }
+
+    BlockTable table;
+    double buildMs = bench::bestOfMs(3, [&] {
+        AllocProfiler::Scope phase("index");
+        table.build(data);
+    });
+    size_t blocks = table.columns(BlockKind::If).size() + table.columns(BlockKind::Ef).size();
+    std::printf("block filter: %zu blocks, table %.1f MB\n", blocks, table.memoryUsage().total() / 1e6);
+    bench::printRow("BlockTable::build", buildMs);
+
+    ParamIndex index;
+    double indexMs = bench::bestOfMs(3, [&] {
+        AllocProfiler::Scope phase("index");
+        index.build(table);
+    });
+    std::printf("param index %.1f MB\n", index.memoryUsage().total() / 1e6);
+    bench::printRow("ParamIndex::build (from table)", indexMs);
+
+    const char* queries[] = {"ef 6#105 p1=2", "ef 6 p0=0..50", "ef 3 p2=100..199", "if 25 p1=3..7", "if 24 p0=10000..10050"};
+    for (const char* text : queries) {
+        ParamQuery query;
+        std::string error;
+        if (!parseParamQuery(text, query, error)) {
+            std::fprintf(stderr, "%s: %s\n", text, error.c_str());
+            return 1;
+        }
+        std::vector<ColumnRange> ranges{{kColumnType, query.type, query.type}, {query.slot, query.min, query.max}};
+        if (query.number != kAnyNumber) {
+            ranges.push_back({kColumnNumber, query.number, query.number});
+        }
+        BlockKind kind = query.isEffect ? BlockKind::Ef : BlockKind::If;
+        size_t tableHits = 0;
+        size_t indexHits = 0;
+        size_t walkHits = 0;
+        AllocProfiler::Scope phase("query");
+        double selectMs = bench::bestOfMs(10, [&] { tableHits = table.select(kind, ranges).size(); });
+        double findMs = bench::bestOfMs(10, [&] { indexHits = index.find(query).size(); });
+        double walkMs = bench::bestOfMs(10, [&] { walkHits = walkDocument(data, query); });
+        if (tableHits != walkHits || indexHits != walkHits) {
+            std::fprintf(stderr, "%s: table found %zu, index found %zu, walk found %zu\n", text, tableHits,
+                         indexHits, walkHits);
+            return 1;
+        }
+        std::printf("%s (%zu hits)\n", text, tableHits);
+        char speedup[32];
+        std::snprintf(speedup, sizeof(speedup), "%.1fx vs walk", walkMs / findMs);
+        bench::printRow("ParamIndex::find (ordered hits)", findMs, speedup);
+        std::snprintf(speedup, sizeof(speedup), "%.1fx vs walk", walkMs / selectMs);
+        bench::printRow("BlockTable::select (row ids)", selectMs, speedup);
+        bench::printRow("document walk (count)", walkMs);
+    }
+    return 0;
+}
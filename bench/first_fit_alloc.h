@@ -0,0 +1,27 @@
+#ifndef VARSWAP_FIRST_FIT_ALLOC_H_GUARD
+#define VARSWAP_FIRST_FIT_ALLOC_H_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The pre-bin tinyalloc, same parameters as ta_init. Single heap, not
+// thread-safe; see first_fit_alloc.c.
+bool ff_init(const void *base, const void *limit, const size_t heap_blocks, const size_t split_thresh, const size_t alignment, bool existing);
+void *ff_alloc(size_t num);
+void *ff_calloc(size_t num, size_t size);
+bool ff_free(void *ptr);
+
+size_t ff_num_free();
+size_t ff_num_used();
+size_t ff_num_fresh();
+bool ff_check();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VARSWAP_FIRST_FIT_ALLOC_H_GUARD */
@@ -0,0 +1,66 @@
+// Thread scaling of the chunked parallel scan, with every result checked
+// against the serial scan.
+
+#include "bench_common.h"
+
+#include "varswap/occurrence.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef VARSWAP_NO_ALLOC_HOOKS
+#include "varswap/alloc_hooks.inl"
+#endif
+
+using namespace varswap;
+
+namespace {
+
+bool sameOccurrences(const std::vector<Occurrence>& lhs, const std::vector<Occurrence>& rhs) {
+    return lhs.size() == rhs.size() &&
+           (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(Occurrence)) == 0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    bench::ProfileReport profileReport(options.profile);
+
+    FrameData data;
+    {
+        AllocProfiler::Scope phase("load");
+        bench::fillSyntheticDocument(data, 1000, options.framesPerSeq);
+    }
+
+    std::vector<Occurrence> serial;
+    double serialMs = bench::bestOfMs(5, [&] {
+        AllocProfiler::Scope phase("scan");
+        serial = collectOccurrences(data, 1);
+    });
+    std::printf("scan threads: %zu occurrences, %u hardware thread(s)\n", serial.size(), resolveScanThreads(0));
+    bench::printRow("1 thread", serialMs);
+
+    unsigned maxThreads = resolveScanThreads(0);
+    for (unsigned threads = 2; threads <= maxThreads * 2; threads *= 2) {
+        std::vector<Occurrence> parallel;
+        double ms = bench::bestOfMs(5, [&] {
+            AllocProfiler::Scope phase("scan");
+            parallel = collectOccurrences(data, threads);
+        });
+        if (!sameOccurrences(serial, parallel)) {
+            std::fprintf(stderr, "%u threads: result differs from the serial scan\n", threads);
+            return 1;
+        }
+        char label[32];
+        char speedup[32];
+        std::snprintf(label, sizeof(label), "%u threads", threads);
+        std::snprintf(speedup, sizeof(speedup), "%.2fx", serialMs / ms);
+        bench::printRow(label, ms, speedup);
+    }
+    return 0;
+}
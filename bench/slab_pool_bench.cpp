@@ -0,0 +1,180 @@
+// Copies every sequence of a synthetic document into separately allocated
+// Sequence_T instances, walks their blocks and tears them down again:
+// once with std::allocator, once with a SlabPool per sequence straight on
+// operator new, and once with those pools carved from one MonotonicArena.
+
+#include "bench_common.h"
+
+#include "monotonic_arena.hpp"
+#include "slab_pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#ifndef VARSWAP_NO_ALLOC_HOOKS
+#include "varswap/alloc_hooks.inl"
+#endif
+
+using namespace varswap;
+
+namespace {
+
+constexpr int kRuns = 10;
+
+struct StageTimes {
+    double build = 0.0;
+    double walk = 0.0;
+    double teardown = 0.0;
+    size_t reserved = 0;
+    std::uint64_t checksum = 0;
+
+    void keepBest(const StageTimes& run, bool first) {
+        build = first ? run.build : std::min(build, run.build);
+        walk = first ? run.walk : std::min(walk, run.walk);
+        teardown = first ? run.teardown : std::min(teardown, run.teardown);
+        reserved = run.reserved;
+        checksum = run.checksum;
+    }
+};
+
+double msSince(std::chrono::steady_clock::time_point& start) {
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
+
+// The synthetic document has no boxes; give every frame a few so the
+// hitbox map nodes are part of the measurement.
+void addHitboxes(FrameData& data) {
+    for (int s = 0; s < data.get_sequence_count(); ++s) {
+        Sequence* seq = data.get_sequence(s);
+        for (Frame& frame : seq->frames) {
+            for (int key : {0, 1, 25}) {
+                frame.hitboxes[key] = Hitbox{{key, -key, key * 2, key * 3}};
+            }
+        }
+    }
+}
+
+// Reads the fields a scan touches, in scan order.
+template <template <typename> class Allocator>
+std::uint64_t walk(const std::vector<Sequence_T<Allocator>>& seqs) {
+    std::uint64_t sum = 0;
+    for (const auto& seq : seqs) {
+        for (const auto& frame : seq.frames) {
+            for (const Frame_IF& cond : frame.IF) {
+                sum += static_cast<std::uint32_t>(cond.type + cond.parameters[1]);
+            }
+            for (const Frame_EF& effect : frame.EF) {
+                sum += static_cast<std::uint32_t>(effect.type + effect.number + effect.parameters[0]);
+            }
+            for (const auto& box : frame.hitboxes) {
+                sum += static_cast<std::uint32_t>(box.second.xy[0]);
+            }
+        }
+    }
+    return sum;
+}
+
+StageTimes runStd(const FrameData& data) {
+    StageTimes times;
+    auto clock = std::chrono::steady_clock::now();
+    {
+        AllocProfiler::Scope phase("std::allocator");
+        std::vector<Sequence_T<std::allocator>> seqs(data.get_sequence_count());
+        for (int s = 0; s < data.get_sequence_count(); ++s) {
+            seqs[s] = *data.peek_sequence(s);
+        }
+        times.build = msSince(clock);
+        times.checksum = walk(seqs);
+        times.walk = msSince(clock);
+    }
+    times.teardown = msSince(clock);
+    return times;
+}
+
+StageTimes runSlab(const FrameData& data, bool sharedArena) {
+    StageTimes times;
+    auto clock = std::chrono::steady_clock::now();
+    {
+        AllocProfiler::Scope phase(sharedArena ? "slab pools + arena" : "slab pools");
+        MonotonicArena arena(1 << 20);
+        std::pmr::memory_resource* upstream = sharedArena ? &arena : std::pmr::new_delete_resource();
+        int seqCount = data.get_sequence_count();
+        // Declared after the pools so the sequences go first.
+        std::vector<std::unique_ptr<SlabPool>> pools;
+        std::vector<Sequence_T<SlabAllocator>> seqs;
+        pools.reserve(seqCount);
+        seqs.reserve(seqCount);
+        for (int s = 0; s < seqCount; ++s) {
+            pools.push_back(std::make_unique<SlabPool>(1024, 16 * 1024, upstream));
+            SlabPool::Scope scope(pools.back().get());
+            seqs.emplace_back();
+            seqs.back() = *data.peek_sequence(s);
+        }
+        times.build = msSince(clock);
+        times.checksum = walk(seqs);
+        times.walk = msSince(clock);
+        for (const auto& pool : pools) {
+            times.reserved += pool->bytesReserved();
+        }
+    }
+    times.teardown = msSince(clock);
+    return times;
+}
+
+void printVariant(const char* name, const StageTimes& times, const StageTimes& baseline) {
+    char label[64];
+    char note[48];
+    std::snprintf(label, sizeof(label), "%s build", name);
+    std::snprintf(note, sizeof(note), "%.2fx", baseline.build / times.build);
+    bench::printRow(label, times.build, note);
+    std::snprintf(label, sizeof(label), "%s walk", name);
+    std::snprintf(note, sizeof(note), "%.2fx", baseline.walk / times.walk);
+    bench::printRow(label, times.walk, note);
+    std::snprintf(label, sizeof(label), "%s teardown", name);
+    std::snprintf(note, sizeof(note), "%.2fx", baseline.teardown / times.teardown);
+    bench::printRow(label, times.teardown, note);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    bench::ProfileReport profileReport(options.profile);
+
+    FrameData data;
+    {
+        AllocProfiler::Scope phase("load");
+        bench::fillSyntheticDocument(data, 1000, options.framesPerSeq);
+        addHitboxes(data);
+    }
+
+    StageTimes stdAlloc;
+    StageTimes pools;
+    StageTimes arena;
+    for (int run = 0; run < kRuns; ++run) {
+        stdAlloc.keepBest(runStd(data), run == 0);
+        pools.keepBest(runSlab(data, false), run == 0);
+        arena.keepBest(runSlab(data, true), run == 0);
+    }
+    if (pools.checksum != stdAlloc.checksum || arena.checksum != stdAlloc.checksum) {
+        std::fprintf(stderr, "pooled copies differ from the document\n");
+        return 1;
+    }
+
+    std::printf("slab pools: %d sequences x %d frames, best of %d\n", data.get_sequence_count(), options.framesPerSeq,
+                kRuns);
+    printVariant("std::allocator", stdAlloc, stdAlloc);
+    printVariant("slab pools", pools, stdAlloc);
+    printVariant("slab pools + arena", arena, stdAlloc);
+    std::printf("  pool slabs reserved: %.1f MiB\n", arena.reserved / (1024.0 * 1024.0));
+    return 0;
+}
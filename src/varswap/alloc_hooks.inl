@@ -0,0 +1,82 @@
+// Global operator new/delete replacements that feed AllocProfiler.
+// Include from exactly one translation unit of a tool build; libraries must
+// not include it. Sizes come from the C runtime's usable-size query, so the
+// replacements add no header to each allocation. Over-aligned new/delete are
+// left to the runtime and are not counted.
+
+#include "varswap/alloc_profile.h"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#define VARSWAP_USABLE_SIZE(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define VARSWAP_USABLE_SIZE(p) malloc_size(p)
+#elif defined(__GLIBC__) || defined(__linux__)
+#include <malloc.h>
+#define VARSWAP_USABLE_SIZE(p) malloc_usable_size(p)
+#else
+#define VARSWAP_USABLE_SIZE(p) std::size_t(0)
+#endif
+
+namespace varswap {
+namespace alloc_hooks {
+
+inline void* allocate(std::size_t size) noexcept {
+    void* p = std::malloc(size ? size : 1);
+    if (p) {
+        AllocProfiler& profiler = AllocProfiler::instance();
+        if (profiler.enabled()) {
+            profiler.recordAlloc(VARSWAP_USABLE_SIZE(p));
+        }
+    }
+    return p;
+}
+
+inline void release(void* p) noexcept {
+    if (!p) {
+        return;
+    }
+    AllocProfiler& profiler = AllocProfiler::instance();
+    if (profiler.enabled()) {
+        profiler.recordFree(VARSWAP_USABLE_SIZE(p));
+    }
+    std::free(p);
+}
+
+} // namespace alloc_hooks
+} // namespace varswap
+
+void* operator new(std::size_t size) {
+    if (void* p = varswap::alloc_hooks::allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = varswap::alloc_hooks::allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return varswap::alloc_hooks::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return varswap::alloc_hooks::allocate(size);
+}
+
+void operator delete(void* p) noexcept { varswap::alloc_hooks::release(p); }
+void operator delete[](void* p) noexcept { varswap::alloc_hooks::release(p); }
+void operator delete(void* p, std::size_t) noexcept { varswap::alloc_hooks::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { varswap::alloc_hooks::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { varswap::alloc_hooks::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { varswap::alloc_hooks::release(p); }
+
+#undef VARSWAP_USABLE_SIZE
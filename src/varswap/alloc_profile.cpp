@@ -0,0 +1,156 @@
+#include "varswap/alloc_profile.h"
+
+#include "tinyalloc.h"
+
+#include <cstdio>
+#include <new>
+
+namespace varswap {
+namespace {
+
+void tinyallocHook(size_t bytes, bool allocated) {
+    if (allocated) {
+        AllocProfiler::instance().recordAlloc(bytes);
+    } else {
+        AllocProfiler::instance().recordFree(bytes);
+    }
+}
+
+std::string formatBytes(std::uint64_t bytes) {
+    char buffer[32];
+    if (bytes >= 1024ull * 1024ull) {
+        std::snprintf(buffer, sizeof(buffer), "%.2f MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+    } else if (bytes >= 1024ull) {
+        std::snprintf(buffer, sizeof(buffer), "%.1f KiB", static_cast<double>(bytes) / 1024.0);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%llu B", static_cast<unsigned long long>(bytes));
+    }
+    return buffer;
+}
+
+} // namespace
+
+AllocProfiler::Scope::Scope(const char* name)
+    : m_active(AllocProfiler::instance().enabled()) {
+    if (m_active) {
+        AllocProfiler::instance().beginPhase(name);
+    }
+}
+
+AllocProfiler::Scope::~Scope() {
+    if (m_active) {
+        AllocProfiler::instance().endPhase();
+    }
+}
+
+AllocProfiler& AllocProfiler::instance() {
+    // Never destroyed, and not built with operator new: the new/delete hooks
+    // call this on their first allocation and after static destructors ran.
+    alignas(AllocProfiler) static unsigned char storage[sizeof(AllocProfiler)];
+    static AllocProfiler* profiler = ::new (static_cast<void*>(storage)) AllocProfiler();
+    return *profiler;
+}
+
+void AllocProfiler::setEnabled(bool enabled) {
+    if (enabled) {
+        // Start from the current live count so peaks are measured from here.
+        m_peak.store(m_live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    ta_set_profile_hook(enabled ? &tinyallocHook : nullptr);
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void AllocProfiler::reset() {
+    m_open.clear();
+    m_phases.clear();
+    m_allocations.store(0, std::memory_order_relaxed);
+    m_frees.store(0, std::memory_order_relaxed);
+    m_bytes.store(0, std::memory_order_relaxed);
+    m_live.store(0, std::memory_order_relaxed);
+    m_peak.store(0, std::memory_order_relaxed);
+}
+
+void AllocProfiler::count(std::size_t bytes, bool allocation) {
+    if (!allocation) {
+        m_frees.fetch_add(1, std::memory_order_relaxed);
+        m_live.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+        return;
+    }
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    const std::int64_t live = m_live.fetch_add(static_cast<std::int64_t>(bytes), std::memory_order_relaxed)
+        + static_cast<std::int64_t>(bytes);
+    std::int64_t peak = m_peak.load(std::memory_order_relaxed);
+    while (live > peak && !m_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void AllocProfiler::beginPhase(const char* name) {
+    // Growing the bookkeeping below allocates; keep that out of the phase.
+    std::size_t index = 0;
+    while (index < m_phases.size() && m_phases[index].name != name) {
+        ++index;
+    }
+    if (index == m_phases.size()) {
+        m_phases.emplace_back();
+        m_phases.back().name = name;
+    }
+    m_open.reserve(m_open.size() + 1);
+
+    const std::int64_t live = m_live.load(std::memory_order_relaxed);
+    OpenPhase open;
+    open.index = index;
+    open.allocations = m_allocations.load(std::memory_order_relaxed);
+    open.frees = m_frees.load(std::memory_order_relaxed);
+    open.bytes = m_bytes.load(std::memory_order_relaxed);
+    open.startLive = live > 0 ? static_cast<std::uint64_t>(live) : 0;
+    // The enclosing phase's peak so far; restored (maxed) when this one ends.
+    const std::int64_t outerPeak = m_peak.exchange(live, std::memory_order_relaxed);
+    open.outerPeak = outerPeak > 0 ? static_cast<std::uint64_t>(outerPeak) : 0;
+    m_open.push_back(open);
+}
+
+void AllocProfiler::endPhase() {
+    if (m_open.empty()) {
+        return;
+    }
+    const OpenPhase open = m_open.back();
+    m_open.pop_back();
+
+    const std::int64_t rawPeak = m_peak.load(std::memory_order_relaxed);
+    const std::uint64_t peak = rawPeak > 0 ? static_cast<std::uint64_t>(rawPeak) : 0;
+    PhaseStats& stats = m_phases[open.index];
+    stats.runs++;
+    stats.allocations += m_allocations.load(std::memory_order_relaxed) - open.allocations;
+    stats.frees += m_frees.load(std::memory_order_relaxed) - open.frees;
+    stats.bytesAllocated += m_bytes.load(std::memory_order_relaxed) - open.bytes;
+    if (peak > stats.peakLiveBytes) {
+        stats.peakLiveBytes = peak;
+    }
+    if (peak > open.startLive && peak - open.startLive > stats.peakGrowth) {
+        stats.peakGrowth = peak - open.startLive;
+    }
+    if (open.outerPeak > peak) {
+        m_peak.store(static_cast<std::int64_t>(open.outerPeak), std::memory_order_relaxed);
+    }
+}
+
+void AllocProfiler::print(std::ostream& os) const {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-10s %5s %10s %10s %12s %12s %12s\n",
+                  "phase", "runs", "allocs", "frees", "allocated", "peak live", "peak growth");
+    os << line;
+    for (const PhaseStats& stats : m_phases) {
+        std::snprintf(line, sizeof(line), "%-10s %5llu %10llu %10llu %12s %12s %12s\n",
+                      stats.name.c_str(),
+                      static_cast<unsigned long long>(stats.runs),
+                      static_cast<unsigned long long>(stats.allocations),
+                      static_cast<unsigned long long>(stats.frees),
+                      formatBytes(stats.bytesAllocated).c_str(),
+                      formatBytes(stats.peakLiveBytes).c_str(),
+                      formatBytes(stats.peakGrowth).c_str());
+        os << line;
+    }
+}
+
+} // namespace varswap
@@ -0,0 +1,92 @@
+#ifndef VARSWAP_ALLOC_PROFILE_H_GUARD
+#define VARSWAP_ALLOC_PROFILE_H_GUARD
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace varswap {
+
+// Allocation counters attributed to named phases (load, scan, metadata,
+// summary, apply, save). Sources feed recordAlloc/recordFree: tinyalloc
+// through its profile hook, and the global operator new/delete replacements
+// in alloc_hooks.inl for tools that include it. While disabled, recording
+// costs one relaxed load.
+class AllocProfiler {
+public:
+    struct PhaseStats {
+        std::string name;
+        std::uint64_t runs = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t frees = 0;
+        std::uint64_t bytesAllocated = 0;
+        // Highest live byte count seen while the phase was active, and the
+        // part of it above the live count when the phase started.
+        std::uint64_t peakLiveBytes = 0;
+        std::uint64_t peakGrowth = 0;
+    };
+
+    // RAII phase marker; phases nest, inner phases also count toward outer.
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool m_active;
+    };
+
+    static AllocProfiler& instance();
+
+    void setEnabled(bool enabled);
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void reset();
+
+    void recordAlloc(std::size_t bytes) {
+        if (enabled()) {
+            count(bytes, true);
+        }
+    }
+    void recordFree(std::size_t bytes) {
+        if (enabled()) {
+            count(bytes, false);
+        }
+    }
+
+    const std::vector<PhaseStats>& phases() const { return m_phases; }
+    void print(std::ostream& os) const;
+
+private:
+    struct OpenPhase {
+        std::size_t index;
+        std::uint64_t allocations;
+        std::uint64_t frees;
+        std::uint64_t bytes;
+        std::uint64_t startLive;
+        std::uint64_t outerPeak;
+    };
+
+    AllocProfiler() = default;
+    void count(std::size_t bytes, bool allocation);
+    void beginPhase(const char* name);
+    void endPhase();
+
+    std::atomic<bool> m_enabled{false};
+    std::atomic<std::uint64_t> m_allocations{0};
+    std::atomic<std::uint64_t> m_frees{0};
+    std::atomic<std::uint64_t> m_bytes{0};
+    std::atomic<std::int64_t> m_live{0};
+    std::atomic<std::int64_t> m_peak{0};
+    // Phases are opened and closed on one thread; counters may be fed from any.
+    std::vector<OpenPhase> m_open;
+    std::vector<PhaseStats> m_phases;
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_ALLOC_PROFILE_H_GUARD */
@@ -0,0 +1,45 @@
+#ifndef VARSWAP_BIT_OPS_H_GUARD
+#define VARSWAP_BIT_OPS_H_GUARD
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace varswap {
+
+// Index of the lowest set bit. `value` must be non-zero.
+inline int countTrailingZeros(std::uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    int index = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+inline int popCount(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value) {
+        value &= value - 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+} // namespace varswap
+
+#endif /* VARSWAP_BIT_OPS_H_GUARD */
@@ -0,0 +1,247 @@
+#include "varswap/block_table.h"
+
+#include "varswap/bit_ops.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VARSWAP_BLOCK_TABLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace varswap {
+
+namespace {
+
+constexpr size_t kMaskBits = 64;
+
+void resizeColumns(BlockColumns& columns, size_t rows, int paramCount, bool hasNumber) {
+    columns.type.resize(rows);
+    columns.number.resize(hasNumber ? rows : 0);
+    columns.parameters.resize(paramCount);
+    for (auto& column : columns.parameters) {
+        column.resize(rows);
+    }
+    columns.seqIndex.resize(rows);
+    columns.frameIndex.resize(rows);
+    columns.blockIndex.resize(rows);
+}
+
+void writeIfRow(BlockColumns& columns, size_t row, const Frame_IF& cond, int seqIndex, size_t frameIndex,
+                size_t blockIndex) {
+    columns.type[row] = cond.type;
+    for (int p = 0; p < kIfParamCount; ++p) {
+        columns.parameters[p][row] = cond.parameters[p];
+    }
+    columns.seqIndex[row] = seqIndex;
+    columns.frameIndex[row] = static_cast<std::uint16_t>(frameIndex);
+    columns.blockIndex[row] = static_cast<std::uint16_t>(blockIndex);
+}
+
+void writeEfRow(BlockColumns& columns, size_t row, const Frame_EF& effect, int seqIndex, size_t frameIndex,
+                size_t blockIndex) {
+    columns.type[row] = effect.type;
+    columns.number[row] = effect.number;
+    for (int p = 0; p < kEfParamCount; ++p) {
+        columns.parameters[p][row] = effect.parameters[p];
+    }
+    columns.seqIndex[row] = seqIndex;
+    columns.frameIndex[row] = static_cast<std::uint16_t>(frameIndex);
+    columns.blockIndex[row] = static_cast<std::uint16_t>(blockIndex);
+}
+
+size_t trackedCount(size_t count) {
+    return std::min<size_t>(count, kMaxHandleIndex);
+}
+
+// Sets bit i of `mask` when values[i] lies outside [min, max].
+void markOutOfRange(const int* values, size_t count, int min, int max, std::vector<std::uint64_t>& mask) {
+    size_t i = 0;
+#ifdef VARSWAP_BLOCK_TABLE_SSE2
+    const __m128i lo = _mm_set1_epi32(min);
+    const __m128i hi = _mm_set1_epi32(max);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i out = _mm_or_si128(_mm_cmplt_epi32(v, lo), _mm_cmpgt_epi32(v, hi));
+        std::uint64_t bits = static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(out)));
+        if (bits) {
+            mask[i / kMaskBits] |= bits << (i % kMaskBits);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if (values[i] < min || values[i] > max) {
+            mask[i / kMaskBits] |= std::uint64_t(1) << (i % kMaskBits);
+        }
+    }
+}
+
+} // namespace
+
+void BlockTable::clear() {
+    m_if = BlockColumns();
+    m_ef = BlockColumns();
+    m_frameBase.clear();
+    m_ifFrameStart.clear();
+    m_efFrameStart.clear();
+    m_generations.clear();
+}
+
+void BlockTable::build(const FrameData& data) {
+    clear();
+    int seqCount = data.get_sequence_count();
+    m_generations.resize(seqCount, 0);
+    m_frameBase.resize(seqCount + 1, 0);
+
+    // Size every column once so the fill below never reallocates.
+    size_t frameTotal = 0;
+    size_t ifTotal = 0;
+    size_t efTotal = 0;
+    for (int seqIdx = 0; seqIdx < seqCount; ++seqIdx) {
+        m_frameBase[seqIdx] = static_cast<std::uint32_t>(frameTotal);
+        const Sequence* seq = data.peek_sequence(seqIdx);
+        if (!seq) {
+            continue;
+        }
+        m_generations[seqIdx] = seq->generation;
+        size_t frameCount = trackedCount(seq->frames.size());
+        frameTotal += frameCount;
+        for (size_t f = 0; f < frameCount; ++f) {
+            ifTotal += trackedCount(seq->frames[f].IF.size());
+            efTotal += trackedCount(seq->frames[f].EF.size());
+        }
+    }
+    m_frameBase[seqCount] = static_cast<std::uint32_t>(frameTotal);
+
+    resizeColumns(m_if, ifTotal, kIfParamCount, false);
+    resizeColumns(m_ef, efTotal, kEfParamCount, true);
+    m_ifFrameStart.assign(frameTotal + 1, static_cast<std::uint32_t>(ifTotal));
+    m_efFrameStart.assign(frameTotal + 1, static_cast<std::uint32_t>(efTotal));
+
+    size_t ifRow = 0;
+    size_t efRow = 0;
+    for (int seqIdx = 0; seqIdx < seqCount; ++seqIdx) {
+        const Sequence* seq = data.peek_sequence(seqIdx);
+        if (!seq) {
+            continue;
+        }
+        size_t frameCount = trackedCount(seq->frames.size());
+        for (size_t f = 0; f < frameCount; ++f) {
+            size_t slot = m_frameBase[seqIdx] + f;
+            m_ifFrameStart[slot] = static_cast<std::uint32_t>(ifRow);
+            m_efFrameStart[slot] = static_cast<std::uint32_t>(efRow);
+            ifRow += trackedCount(seq->frames[f].IF.size());
+            efRow += trackedCount(seq->frames[f].EF.size());
+        }
+        storeSequence(*seq, seqIdx);
+    }
+}
+
+bool BlockTable::sameShape(const Sequence& seq, int seqIndex) const {
+    std::uint32_t base = m_frameBase[seqIndex];
+    size_t frameCount = trackedCount(seq.frames.size());
+    if (frameCount != m_frameBase[seqIndex + 1] - base) {
+        return false;
+    }
+    for (size_t f = 0; f < frameCount; ++f) {
+        size_t slot = base + f;
+        if (trackedCount(seq.frames[f].IF.size()) != m_ifFrameStart[slot + 1] - m_ifFrameStart[slot] ||
+            trackedCount(seq.frames[f].EF.size()) != m_efFrameStart[slot + 1] - m_efFrameStart[slot]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BlockTable::storeSequence(const Sequence& seq, int seqIndex) {
+    std::uint32_t base = m_frameBase[seqIndex];
+    size_t frameCount = trackedCount(seq.frames.size());
+    for (size_t f = 0; f < frameCount; ++f) {
+        const Frame& frame = seq.frames[f];
+        size_t ifRow = m_ifFrameStart[base + f];
+        size_t efRow = m_efFrameStart[base + f];
+        size_t ifCount = trackedCount(frame.IF.size());
+        for (size_t b = 0; b < ifCount; ++b) {
+            writeIfRow(m_if, ifRow + b, frame.IF[b], seqIndex, f, b);
+        }
+        size_t efCount = trackedCount(frame.EF.size());
+        for (size_t b = 0; b < efCount; ++b) {
+            writeEfRow(m_ef, efRow + b, frame.EF[b], seqIndex, f, b);
+        }
+    }
+    m_generations[seqIndex] = seq.generation;
+}
+
+void BlockTable::syncSequence(const FrameData& data, int seqIndex) {
+    if (seqIndex < 0 || seqIndex >= static_cast<int>(m_generations.size()) ||
+        static_cast<int>(m_generations.size()) != data.get_sequence_count()) {
+        build(data);
+        return;
+    }
+    const Sequence* seq = data.peek_sequence(seqIndex);
+    if (!seq || !sameShape(*seq, seqIndex)) {
+        build(data);
+        return;
+    }
+    storeSequence(*seq, seqIndex);
+}
+
+std::vector<std::uint32_t> BlockTable::select(BlockKind kind, const std::vector<ColumnRange>& ranges) const {
+    const BlockColumns& cols = columns(kind);
+    size_t rows = cols.size();
+    std::vector<std::uint32_t> result;
+    if (rows == 0) {
+        return result;
+    }
+
+    std::vector<std::uint64_t> rejected((rows + kMaskBits - 1) / kMaskBits, 0);
+    for (const ColumnRange& range : ranges) {
+        const std::vector<int>* column = nullptr;
+        if (range.column == kColumnType) {
+            column = &cols.type;
+        } else if (range.column == kColumnNumber) {
+            column = kind == BlockKind::Ef ? &cols.number : nullptr;
+        } else if (range.column >= 0 && range.column < static_cast<int>(cols.parameters.size())) {
+            column = &cols.parameters[range.column];
+        }
+        if (!column || range.min > range.max) {
+            return result;
+        }
+        markOutOfRange(column->data(), rows, range.min, range.max, rejected);
+    }
+
+    for (size_t word = 0; word < rejected.size(); ++word) {
+        std::uint64_t accepted = ~rejected[word];
+        size_t first = word * kMaskBits;
+        if (rows - first < kMaskBits) {
+            accepted &= (std::uint64_t(1) << (rows - first)) - 1;
+        }
+        while (accepted) {
+            result.push_back(static_cast<std::uint32_t>(first + countTrailingZeros(accepted)));
+            accepted &= accepted - 1;
+        }
+    }
+    return result;
+}
+
+MemoryUsage BlockTable::memoryUsage() const {
+    MemoryUsage usage;
+    for (const BlockColumns* cols : {&m_if, &m_ef}) {
+        usage.add_vector(cols->type);
+        usage.add_vector(cols->number);
+        usage.add_vector(cols->parameters);
+        for (const auto& column : cols->parameters) {
+            usage.add_vector(column);
+        }
+        usage.add_vector(cols->seqIndex);
+        usage.add_vector(cols->frameIndex);
+        usage.add_vector(cols->blockIndex);
+    }
+    usage.add_vector(m_frameBase);
+    usage.add_vector(m_ifFrameStart);
+    usage.add_vector(m_efFrameStart);
+    usage.add_vector(m_generations);
+    return usage;
+}
+
+} // namespace varswap
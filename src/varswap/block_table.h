@@ -0,0 +1,80 @@
+#ifndef VARSWAP_BLOCK_TABLE_H_GUARD
+#define VARSWAP_BLOCK_TABLE_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace varswap {
+
+enum class BlockKind : std::uint8_t {
+    If,
+    Ef
+};
+
+constexpr int kIfParamCount = 9;
+constexpr int kEfParamCount = 12;
+
+// Column ids accepted by ColumnRange besides plain parameter indices.
+constexpr int kColumnType = -1;
+constexpr int kColumnNumber = -2;
+
+// Structure-of-arrays copy of every IF or EF block in a document, one row per
+// block in (sequence, frame, block) order.
+struct BlockColumns {
+    std::vector<int> type;
+    std::vector<int> number; // EF only
+    std::vector<std::vector<int>> parameters; // one column per parameter slot
+    std::vector<int> seqIndex;
+    std::vector<std::uint16_t> frameIndex;
+    std::vector<std::uint16_t> blockIndex;
+
+    size_t size() const { return type.size(); }
+};
+
+// Inclusive [min, max] filter on one column.
+struct ColumnRange {
+    int column;
+    int min;
+    int max;
+};
+
+// Document-wide columnar index over EF/IF blocks. Queries scan contiguous int
+// columns instead of walking sequences -> frames -> blocks; ParamIndex
+// (param_index.h) is built from the columns. Edits are pushed in per
+// sequence with syncSequence().
+class BlockTable {
+public:
+    void build(const FrameData& data);
+    void clear();
+    bool empty() const { return m_generations.empty(); }
+
+    // Re-reads one sequence. Cheap when its frame and block counts are
+    // unchanged, otherwise the whole table is rebuilt.
+    void syncSequence(const FrameData& data, int seqIndex);
+
+    const BlockColumns& columns(BlockKind kind) const { return kind == BlockKind::If ? m_if : m_ef; }
+
+    // Rows matching every range, ascending.
+    std::vector<std::uint32_t> select(BlockKind kind, const std::vector<ColumnRange>& ranges) const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    BlockColumns m_if;
+    BlockColumns m_ef;
+    // Row offsets per (sequence, frame): index m_frameBase[seq] + frame.
+    std::vector<std::uint32_t> m_frameBase;
+    std::vector<std::uint32_t> m_ifFrameStart;
+    std::vector<std::uint32_t> m_efFrameStart;
+    std::vector<unsigned int> m_generations;
+
+    bool sameShape(const Sequence& seq, int seqIndex) const;
+    void storeSequence(const Sequence& seq, int seqIndex);
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_BLOCK_TABLE_H_GUARD */
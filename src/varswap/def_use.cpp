@@ -0,0 +1,305 @@
+#include "varswap/def_use.h"
+
+#include "varswap/bit_ops.h"
+#include "varswap/scc.h"
+#include "varswap/var_usage.h"
+
+#include <algorithm>
+
+namespace varswap {
+
+namespace {
+
+constexpr size_t kWordBits = 64;
+
+void setBit(std::vector<std::uint64_t>& bits, int index) {
+    bits[static_cast<size_t>(index) / kWordBits] |= std::uint64_t(1) << (static_cast<size_t>(index) % kWordBits);
+}
+
+void resetBit(std::vector<std::uint64_t>& bits, int index) {
+    bits[static_cast<size_t>(index) / kWordBits] &= ~(std::uint64_t(1) << (static_cast<size_t>(index) % kWordBits));
+}
+
+bool anyBit(const std::vector<std::uint64_t>& bits) {
+    for (std::uint64_t word : bits) {
+        if (word) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendBits(std::vector<int>& out, const std::uint64_t* bits, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        for (std::uint64_t word = bits[w]; word; word &= word - 1) {
+            out.push_back(static_cast<int>(w * kWordBits + countTrailingZeros(word)));
+        }
+    }
+}
+
+} // namespace
+
+std::uint64_t DefUseGraph::packKey(VarCategory category, int varId) {
+    return (static_cast<std::uint64_t>(varIdSpace(category)) << 32) | static_cast<std::uint32_t>(varId);
+}
+
+void DefUseGraph::resize(int patternCount) {
+    m_patternCount = patternCount;
+    m_words = (static_cast<size_t>(patternCount) + kWordBits - 1) / kWordBits;
+    m_edges.assign(patternCount, {});
+    m_keysOf.assign(patternCount, {});
+    m_vars.clear();
+    m_reachedBy.clear();
+    m_reachDirty = true;
+}
+
+void DefUseGraph::clear() {
+    resize(0);
+}
+
+void DefUseGraph::build(const FrameData& data, const std::vector<Occurrence>& occurrences, const int* vars) {
+    resize(data.get_sequence_count());
+    size_t begin = 0;
+    for (int seqIndex = 0; seqIndex < m_patternCount; ++seqIndex) {
+        size_t end = begin;
+        while (end < occurrences.size() && occurrences[end].seqIndex == seqIndex) {
+            ++end;
+        }
+        readSequence(data, occurrences.data() + begin, occurrences.data() + end, vars + begin, seqIndex);
+        begin = end;
+    }
+}
+
+void DefUseGraph::updateSequence(const FrameData& data, const std::vector<Occurrence>& occurrences,
+                                 const int* vars, int seqIndex) {
+    if (data.get_sequence_count() != m_patternCount) {
+        build(data, occurrences, vars);
+        return;
+    }
+    if (seqIndex < 0 || seqIndex >= m_patternCount) {
+        return;
+    }
+    auto bySeq = [](const Occurrence& lhs, const Occurrence& rhs) { return lhs.seqIndex < rhs.seqIndex; };
+    Occurrence probe{};
+    probe.seqIndex = seqIndex;
+    auto range = std::equal_range(occurrences.begin(), occurrences.end(), probe, bySeq);
+    size_t first = static_cast<size_t>(range.first - occurrences.begin());
+    size_t last = static_cast<size_t>(range.second - occurrences.begin());
+
+    std::vector<int> oldEdges = std::move(m_edges[seqIndex]);
+    dropSequence(seqIndex);
+    readSequence(data, occurrences.data() + first, occurrences.data() + last, vars + first, seqIndex);
+    if (m_edges[seqIndex] != oldEdges) {
+        m_reachDirty = true;
+    }
+}
+
+void DefUseGraph::dropSequence(int seqIndex) {
+    for (std::uint64_t key : m_keysOf[seqIndex]) {
+        auto it = m_vars.find(key);
+        if (it == m_vars.end()) {
+            continue;
+        }
+        resetBit(it->second.writers, seqIndex);
+        resetBit(it->second.readers, seqIndex);
+        if (!anyBit(it->second.writers) && !anyBit(it->second.readers)) {
+            m_vars.erase(it);
+        }
+    }
+    m_keysOf[seqIndex].clear();
+    m_edges[seqIndex].clear();
+}
+
+void DefUseGraph::readSequence(const FrameData& data, const Occurrence* first, const Occurrence* last,
+                               const int* vars, int seqIndex) {
+    std::vector<int>& edges = m_edges[seqIndex];
+    edges.clear();
+    if (const Sequence* seq = data.peek_sequence(seqIndex)) {
+        for (const auto& frame : seq->frames) {
+            if (frame.AF.aniType == 0 && frame.AF.jump >= 0 && frame.AF.jump < m_patternCount) {
+                edges.push_back(frame.AF.jump);
+            }
+        }
+    }
+
+    std::vector<std::uint64_t>& keys = m_keysOf[seqIndex];
+    for (const Occurrence* occ = first; occ != last; ++occ, ++vars) {
+        if (occ->jumpTargetSupportsPattern()) {
+            const int* jump = resolveField(data, *occ, OccurrenceField::JumpTarget);
+            if (jump && *jump >= kPatternJumpOffset && *jump - kPatternJumpOffset < m_patternCount) {
+                edges.push_back(*jump - kPatternJumpOffset);
+            }
+        }
+        if (!resolveField(data, *occ, OccurrenceField::Value)) {
+            continue;
+        }
+        std::uint64_t key = packKey(occ->category, *vars);
+        VarNodes& nodes = m_vars[key];
+        if (nodes.writers.empty()) {
+            nodes.writers.assign(m_words, 0);
+            nodes.readers.assign(m_words, 0);
+        }
+        setBit(kindReadsVar(occ->kind) ? nodes.readers : nodes.writers, seqIndex);
+        keys.push_back(key);
+    }
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+void DefUseGraph::computeReach() {
+    // Components come out sinks first, so each one's reach set is its
+    // members plus the already finished sets of the components it jumps into.
+    const int n = m_patternCount;
+    StrongComponents scc;
+    findStrongComponents(n, m_edges, [](int to) { return to; }, scc);
+    const std::vector<int>& component = scc.component;
+    std::vector<std::uint64_t> reach(static_cast<size_t>(scc.count()) * m_words, 0); // row per component
+
+    for (int id = 0; id < scc.count(); ++id) {
+        std::uint64_t* row = reach.data() + static_cast<size_t>(id) * m_words;
+        for (int i = scc.memberStart[id]; i < scc.memberStart[id + 1]; ++i) {
+            int member = scc.members[i];
+            row[member / kWordBits] |= std::uint64_t(1) << (member % kWordBits);
+            for (int to : m_edges[member]) {
+                int target = component[to];
+                if (target == id) {
+                    continue;
+                }
+                const std::uint64_t* other = reach.data() + static_cast<size_t>(target) * m_words;
+                for (size_t w = 0; w < m_words; ++w) {
+                    row[w] |= other[w];
+                }
+            }
+        }
+    }
+
+    // Queries ask who reaches a pattern, so store the transpose.
+    m_reachedBy.assign(static_cast<size_t>(n) * m_words, 0);
+    for (int from = 0; from < n; ++from) {
+        const std::uint64_t* row = reach.data() + static_cast<size_t>(component[from]) * m_words;
+        std::uint64_t bit = std::uint64_t(1) << (from % kWordBits);
+        for (size_t w = 0; w < m_words; ++w) {
+            for (std::uint64_t word = row[w]; word; word &= word - 1) {
+                size_t to = w * kWordBits + countTrailingZeros(word);
+                m_reachedBy[to * m_words + from / kWordBits] |= bit;
+            }
+        }
+    }
+    m_reachDirty = false;
+}
+
+const std::vector<int>& DefUseGraph::jumpTargets(int seqIndex) const {
+    static const std::vector<int> kNone;
+    return (seqIndex >= 0 && seqIndex < m_patternCount) ? m_edges[seqIndex] : kNone;
+}
+
+bool DefUseGraph::canReach(int from, int to) {
+    if (from < 0 || to < 0 || from >= m_patternCount || to >= m_patternCount) {
+        return false;
+    }
+    if (m_reachDirty) {
+        computeReach();
+    }
+    return (reachedBy(to)[from / kWordBits] >> (from % kWordBits)) & 1;
+}
+
+bool DefUseGraph::isRead(VarCategory category, int varId) const {
+    auto it = m_vars.find(packKey(category, varId));
+    return it != m_vars.end() && anyBit(it->second.readers);
+}
+
+bool DefUseGraph::isWritten(VarCategory category, int varId) const {
+    auto it = m_vars.find(packKey(category, varId));
+    return it != m_vars.end() && anyBit(it->second.writers);
+}
+
+std::vector<int> DefUseGraph::writersReaching(VarCategory category, int varId, int seqIndex) {
+    std::vector<int> result;
+    auto it = m_vars.find(packKey(category, varId));
+    if (it == m_vars.end() || seqIndex < 0 || seqIndex >= m_patternCount) {
+        return result;
+    }
+    if (m_reachDirty) {
+        computeReach();
+    }
+    const std::uint64_t* row = reachedBy(seqIndex);
+    std::vector<std::uint64_t> hits(m_words);
+    for (size_t w = 0; w < m_words; ++w) {
+        hits[w] = it->second.writers[w] & row[w];
+    }
+    appendBits(result, hits.data(), m_words);
+    return result;
+}
+
+std::vector<int> DefUseGraph::unreachedReaders(VarCategory category, int varId) {
+    std::vector<int> result;
+    auto it = m_vars.find(packKey(category, varId));
+    if (it == m_vars.end()) {
+        return result;
+    }
+    if (m_reachDirty) {
+        computeReach();
+    }
+    const VarNodes& nodes = it->second;
+    std::vector<int> readers;
+    appendBits(readers, nodes.readers.data(), m_words);
+    for (int reader : readers) {
+        const std::uint64_t* row = reachedBy(reader);
+        bool reached = false;
+        for (size_t w = 0; w < m_words && !reached; ++w) {
+            reached = (nodes.writers[w] & row[w]) != 0;
+        }
+        if (!reached) {
+            result.push_back(reader);
+        }
+    }
+    return result;
+}
+
+std::vector<int> DefUseGraph::readNeverWritten(VarCategory category) const {
+    std::vector<int> result;
+    std::uint64_t space = static_cast<std::uint64_t>(varIdSpace(category)) << 32;
+    for (const auto& entry : m_vars) {
+        if ((entry.first & ~std::uint64_t(0xFFFFFFFFu)) == space && anyBit(entry.second.readers) &&
+            !anyBit(entry.second.writers)) {
+            result.push_back(static_cast<int>(static_cast<std::uint32_t>(entry.first)));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<int> DefUseGraph::writtenNeverRead(VarCategory category) const {
+    std::vector<int> result;
+    std::uint64_t space = static_cast<std::uint64_t>(varIdSpace(category)) << 32;
+    for (const auto& entry : m_vars) {
+        if ((entry.first & ~std::uint64_t(0xFFFFFFFFu)) == space && anyBit(entry.second.writers) &&
+            !anyBit(entry.second.readers)) {
+            result.push_back(static_cast<int>(static_cast<std::uint32_t>(entry.first)));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+MemoryUsage DefUseGraph::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_edges);
+    usage.add_vector(m_keysOf);
+    for (int p = 0; p < m_patternCount; ++p) {
+        usage.add_vector(m_edges[p]);
+        usage.add_vector(m_keysOf[p]);
+    }
+    usage.add_unordered_map(m_vars);
+    for (const auto& entry : m_vars) {
+        usage.add_vector(entry.second.writers);
+        usage.add_vector(entry.second.readers);
+    }
+    usage.add_vector(m_reachedBy);
+    return usage;
+}
+
+} // namespace varswap
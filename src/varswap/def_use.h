@@ -0,0 +1,76 @@
+#ifndef VARSWAP_DEF_USE_H_GUARD
+#define VARSWAP_DEF_USE_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace varswap {
+
+// Pattern-level def-use graph. Nodes are patterns; an edge p -> q means p
+// can continue into q, either by ending into it (AF jump with aniType 0) or
+// through a tracked IF pattern jump. For every (category, var) it keeps two
+// pattern bitsets, the patterns writing the var and the patterns reading it
+// (see kindReadsVar), so "which writers reach this reader" is one AND of
+// bitsets. Reachability is a bitset per pattern, recomputed on the first
+// query after an edge change.
+//
+// Var ids come from a decoded var column (var_decode.h). Projectile and
+// ProjectileNoChange are one id space here.
+class DefUseGraph {
+public:
+    void build(const FrameData& data, const std::vector<Occurrence>& occurrences, const int* vars);
+    // Re-reads one pattern's jumps and var accesses. `occurrences` and `vars`
+    // must already hold the pattern's fresh rows.
+    void updateSequence(const FrameData& data, const std::vector<Occurrence>& occurrences, const int* vars,
+                        int seqIndex);
+    void clear();
+    bool empty() const { return m_edges.empty(); }
+
+    const std::vector<int>& jumpTargets(int seqIndex) const;
+    // True when `from` can run into `to`; every pattern reaches itself.
+    bool canReach(int from, int to);
+
+    bool isRead(VarCategory category, int varId) const;
+    bool isWritten(VarCategory category, int varId) const;
+    // Patterns that write the var and can reach `seqIndex`, ascending.
+    std::vector<int> writersReaching(VarCategory category, int varId, int seqIndex);
+    // Patterns that read the var and that no writer of it can reach.
+    std::vector<int> unreachedReaders(VarCategory category, int varId);
+    // Var ids of this category read somewhere but written nowhere, and the
+    // reverse. Ascending.
+    std::vector<int> readNeverWritten(VarCategory category) const;
+    std::vector<int> writtenNeverRead(VarCategory category) const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct VarNodes {
+        std::vector<std::uint64_t> writers; // pattern bitsets
+        std::vector<std::uint64_t> readers;
+    };
+
+    static std::uint64_t packKey(VarCategory category, int varId);
+    void resize(int patternCount);
+    void readSequence(const FrameData& data, const Occurrence* first, const Occurrence* last, const int* vars,
+                      int seqIndex);
+    void dropSequence(int seqIndex);
+    void computeReach();
+    const std::uint64_t* reachedBy(int seqIndex) const { return m_reachedBy.data() + seqIndex * m_words; }
+
+    int m_patternCount = 0;
+    size_t m_words = 0; // words per pattern bitset
+    std::vector<std::vector<int>> m_edges; // sorted, unique
+    std::vector<std::vector<std::uint64_t>> m_keysOf; // var keys each pattern touches
+    std::unordered_map<std::uint64_t, VarNodes> m_vars;
+    // Row p: patterns that can reach p. Valid while !m_reachDirty.
+    std::vector<std::uint64_t> m_reachedBy;
+    bool m_reachDirty = true;
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_DEF_USE_H_GUARD */
@@ -0,0 +1,112 @@
+#include "varswap/document_epochs.h"
+
+#include <algorithm>
+
+namespace varswap {
+
+// Ordering argument: a reader stores its epoch into its slot and only then
+// loads m_current, both seq_cst. The editor swaps m_current before scanning
+// the slots. So either the scan sees the reader's epoch and keeps every
+// version at or after it, or the reader's load comes after the swap and it
+// never sees the retired version at all.
+
+DocumentEpochs::Pin::Pin(Pin&& other) noexcept
+    : m_slot(other.m_slot), m_version(other.m_version) {
+    other.m_slot = nullptr;
+    other.m_version = nullptr;
+}
+
+DocumentEpochs::Pin& DocumentEpochs::Pin::operator=(Pin&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_slot = other.m_slot;
+        m_version = other.m_version;
+        other.m_slot = nullptr;
+        other.m_version = nullptr;
+    }
+    return *this;
+}
+
+void DocumentEpochs::Pin::release() {
+    if (m_slot) {
+        m_slot->store(0, std::memory_order_release);
+    }
+    m_slot = nullptr;
+    m_version = nullptr;
+}
+
+DocumentEpochs::DocumentEpochs() {
+    for (auto& slot : m_slots) {
+        slot.store(0, std::memory_order_relaxed);
+    }
+}
+
+DocumentEpochs::~DocumentEpochs() {
+    for (const Version* version : m_retired) {
+        delete version;
+    }
+    delete m_current.load(std::memory_order_acquire);
+}
+
+std::uint64_t DocumentEpochs::publish(const FrameData& data) {
+    std::uint64_t epoch = m_epoch.load(std::memory_order_relaxed) + 1;
+    const Version* next = new Version{epoch, data.snapshot()};
+    const Version* previous = m_current.exchange(next, std::memory_order_seq_cst);
+    m_epoch.store(epoch, std::memory_order_seq_cst);
+    if (previous) {
+        m_retired.push_back(previous);
+    }
+    reclaim();
+    return epoch;
+}
+
+size_t DocumentEpochs::reclaim() {
+    if (m_retired.empty()) {
+        return 0;
+    }
+    std::uint64_t oldestPinned = kClaimed;
+    for (const auto& slot : m_slots) {
+        std::uint64_t pinned = slot.load(std::memory_order_seq_cst);
+        if (pinned != 0 && pinned != kClaimed) {
+            oldestPinned = std::min(oldestPinned, pinned);
+        }
+    }
+
+    auto keep = std::partition(m_retired.begin(), m_retired.end(), [oldestPinned](const Version* version) {
+        return version->epoch >= oldestPinned;
+    });
+    for (auto it = keep; it != m_retired.end(); ++it) {
+        delete *it;
+    }
+    m_retired.erase(keep, m_retired.end());
+    return m_retired.size();
+}
+
+DocumentEpochs::Pin DocumentEpochs::pin() const {
+    Pin result;
+    for (auto& slot : m_slots) {
+        std::uint64_t expected = 0;
+        if (!slot.compare_exchange_strong(expected, kClaimed, std::memory_order_acquire)) {
+            continue;
+        }
+        // Versions become current before the epoch counter moves, so the
+        // loaded version is never older than the epoch stored here.
+        std::uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+        if (epoch == 0) {
+            slot.store(0, std::memory_order_release);
+            return result;
+        }
+        slot.store(epoch, std::memory_order_seq_cst);
+        const Version* version = m_current.load(std::memory_order_seq_cst);
+        if (!version) {
+            slot.store(0, std::memory_order_release);
+            return result;
+        }
+        result.m_slot = &slot;
+        result.m_version = version;
+        return result;
+    }
+    return result;
+}
+
+} // namespace varswap
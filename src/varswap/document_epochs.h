@@ -0,0 +1,77 @@
+#ifndef VARSWAP_DOCUMENT_EPOCHS_H_GUARD
+#define VARSWAP_DOCUMENT_EPOCHS_H_GUARD
+
+#include "framedata.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace varswap {
+
+// Epoch-based publication of immutable document versions.
+//
+// The editing thread calls publish() after a batch of edits; each call
+// captures a FrameData::Snapshot and makes it the current version. Worker
+// threads call pin() to get the current version, read it without taking any
+// lock, and drop the Pin when done. A superseded version is freed by the
+// editing thread (in publish() or reclaim()) once no pin can still see it.
+//
+// publish(), reclaim() and the destructor belong to the editing thread;
+// pin() and Pin may be used from any thread.
+class DocumentEpochs {
+public:
+    struct Version {
+        std::uint64_t epoch;
+        FrameData::Snapshot snapshot;
+    };
+
+    class Pin {
+    public:
+        Pin() = default;
+        Pin(Pin&& other) noexcept;
+        Pin& operator=(Pin&& other) noexcept;
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        ~Pin() { release(); }
+
+        // False when nothing was published yet or every reader slot is taken.
+        bool valid() const { return m_version != nullptr; }
+        std::uint64_t epoch() const { return m_version ? m_version->epoch : 0; }
+        const FrameData::Snapshot& snapshot() const { return m_version->snapshot; }
+        void release();
+
+    private:
+        friend class DocumentEpochs;
+        std::atomic<std::uint64_t>* m_slot = nullptr;
+        const Version* m_version = nullptr;
+    };
+
+    static constexpr int kMaxReaders = 64;
+
+    DocumentEpochs();
+    ~DocumentEpochs();
+    DocumentEpochs(const DocumentEpochs&) = delete;
+    DocumentEpochs& operator=(const DocumentEpochs&) = delete;
+
+    std::uint64_t publish(const FrameData& data);
+    // Frees superseded versions no reader has pinned. Returns how many remain.
+    size_t reclaim();
+    size_t retiredCount() const { return m_retired.size(); }
+    std::uint64_t currentEpoch() const { return m_epoch.load(std::memory_order_acquire); }
+
+    Pin pin() const;
+
+private:
+    // 0 = free, kClaimed = taken but not yet pinned, otherwise pinned epoch.
+    static constexpr std::uint64_t kClaimed = ~std::uint64_t(0);
+
+    std::atomic<const Version*> m_current{nullptr};
+    std::atomic<std::uint64_t> m_epoch{0};
+    mutable std::atomic<std::uint64_t> m_slots[kMaxReaders];
+    std::vector<const Version*> m_retired;
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_DOCUMENT_EPOCHS_H_GUARD */
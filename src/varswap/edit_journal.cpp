@@ -0,0 +1,257 @@
+#include "varswap/edit_journal.h"
+
+#include <algorithm>
+
+namespace varswap {
+
+namespace {
+
+int* paramSlot(FrameData& data, const ParamEdit& edit) {
+    Sequence* seq = data.get_sequence(edit.seqIndex);
+    if (!seq || edit.frameIndex >= seq->frames.size()) {
+        return nullptr;
+    }
+    Frame& frame = seq->frames[edit.frameIndex];
+    if (edit.isEffect) {
+        if (edit.blockIndex >= frame.EF.size() || edit.slot >= sizeof(Frame_EF::parameters) / sizeof(int)) {
+            return nullptr;
+        }
+        return &frame.EF[edit.blockIndex].parameters[edit.slot];
+    }
+    if (edit.blockIndex >= frame.IF.size() || edit.slot >= sizeof(Frame_IF::parameters) / sizeof(int)) {
+        return nullptr;
+    }
+    return &frame.IF[edit.blockIndex].parameters[edit.slot];
+}
+
+const int* blockParameters(const FrameData& data, const Occurrence& occ, size_t& count) {
+    if (occ.isEffect()) {
+        const Frame_EF* effect = resolveEf(data, occ);
+        count = sizeof(Frame_EF::parameters) / sizeof(int);
+        return effect ? effect->parameters : nullptr;
+    }
+    const Frame_IF* cond = resolveIf(data, occ);
+    count = sizeof(Frame_IF::parameters) / sizeof(int);
+    return cond ? cond->parameters : nullptr;
+}
+
+const int* peekParamSlot(const FrameData& data, const ParamEdit& edit) {
+    const Sequence* seq = data.peek_sequence(edit.seqIndex);
+    if (!seq || seq->generation != edit.generation || edit.frameIndex >= seq->frames.size()) {
+        return nullptr;
+    }
+    const Frame& frame = seq->frames[edit.frameIndex];
+    if (edit.isEffect) {
+        if (edit.blockIndex >= frame.EF.size() || edit.slot >= sizeof(Frame_EF::parameters) / sizeof(int)) {
+            return nullptr;
+        }
+        return &frame.EF[edit.blockIndex].parameters[edit.slot];
+    }
+    if (edit.blockIndex >= frame.IF.size() || edit.slot >= sizeof(Frame_IF::parameters) / sizeof(int)) {
+        return nullptr;
+    }
+    return &frame.IF[edit.blockIndex].parameters[edit.slot];
+}
+
+bool sameParam(const ParamEdit& lhs, const ParamEdit& rhs) {
+    return lhs.seqIndex == rhs.seqIndex && lhs.frameIndex == rhs.frameIndex && lhs.blockIndex == rhs.blockIndex &&
+           lhs.isEffect == rhs.isEffect && lhs.slot == rhs.slot;
+}
+
+bool paramLess(const ParamEdit& lhs, const ParamEdit& rhs) {
+    if (lhs.seqIndex != rhs.seqIndex) {
+        return lhs.seqIndex < rhs.seqIndex;
+    }
+    if (lhs.frameIndex != rhs.frameIndex) {
+        return lhs.frameIndex < rhs.frameIndex;
+    }
+    if (lhs.isEffect != rhs.isEffect) {
+        return lhs.isEffect < rhs.isEffect;
+    }
+    if (lhs.blockIndex != rhs.blockIndex) {
+        return lhs.blockIndex < rhs.blockIndex;
+    }
+    return lhs.slot < rhs.slot;
+}
+
+} // namespace
+
+void EditJournal::setMemoryLimit(size_t bytes) {
+    m_memoryLimit = bytes;
+    enforceLimit();
+}
+
+void EditJournal::beginGroup() {
+    if (m_openGroupStart != SIZE_MAX) {
+        return;
+    }
+    // A new action forgets everything that was undone.
+    size_t keep = m_undoGroups ? m_groupEnds[m_undoGroups - 1] : 0;
+    m_edits.resize(keep);
+    m_groupEnds.resize(m_undoGroups);
+    m_openGroupStart = keep;
+}
+
+void EditJournal::record(const ParamEdit& edit) {
+    if (m_openGroupStart == SIZE_MAX || edit.before == edit.after) {
+        return;
+    }
+    m_edits.push_back(edit);
+}
+
+bool EditJournal::snapshot(const FrameData& data, const Occurrence& occ, ParamSnapshot& before) {
+    size_t count = 0;
+    const int* parameters = blockParameters(data, occ, count);
+    before.taken = parameters != nullptr;
+    if (parameters) {
+        std::copy(parameters, parameters + count, before.values.begin());
+    }
+    return before.taken;
+}
+
+void EditJournal::recordBlock(const FrameData& data, const Occurrence& occ, const ParamSnapshot& before) {
+    size_t count = 0;
+    const int* parameters = blockParameters(data, occ, count);
+    if (!before.taken || !parameters) {
+        return;
+    }
+    for (size_t slot = 0; slot < count; ++slot) {
+        record({occ.seqIndex, occ.frameIndex, occ.blockIndex, data.sequence_generation(occ.seqIndex),
+                occ.isEffect(), static_cast<std::uint8_t>(slot), before.values[slot], parameters[slot]});
+    }
+}
+
+void EditJournal::commitGroup() {
+    if (m_openGroupStart == SIZE_MAX) {
+        return;
+    }
+    mergeOpenGroup();
+    bool empty = m_edits.size() == m_openGroupStart;
+    m_openGroupStart = SIZE_MAX;
+    if (!empty) {
+        m_groupEnds.push_back(m_edits.size());
+        m_undoGroups = m_groupEnds.size();
+        enforceLimit();
+    }
+}
+
+void EditJournal::mergeOpenGroup() {
+    // Replaying an int recorded twice would trip the check in replay, since
+    // its first edit expects a value the second one already overwrote.
+    auto first = m_edits.begin() + static_cast<std::ptrdiff_t>(m_openGroupStart);
+    std::stable_sort(first, m_edits.end(), paramLess);
+    auto out = first;
+    for (auto run = first; run != m_edits.end();) {
+        auto next = run + 1;
+        while (next != m_edits.end() && sameParam(*run, *next)) {
+            ++next;
+        }
+        ParamEdit merged = *(next - 1);
+        merged.before = run->before;
+        if (merged.before != merged.after) {
+            *out++ = merged;
+        }
+        run = next;
+    }
+    m_edits.erase(out, m_edits.end());
+}
+
+bool EditJournal::undo(FrameData& data, std::vector<int>& touched, std::string& error) {
+    if (!canUndo()) {
+        error = "Nothing to undo.";
+        return false;
+    }
+    if (!replay(data, m_undoGroups - 1, false, touched, error)) {
+        return false;
+    }
+    --m_undoGroups;
+    return true;
+}
+
+bool EditJournal::redo(FrameData& data, std::vector<int>& touched, std::string& error) {
+    if (!canRedo()) {
+        error = "Nothing to redo.";
+        return false;
+    }
+    if (!replay(data, m_undoGroups, true, touched, error)) {
+        return false;
+    }
+    ++m_undoGroups;
+    return true;
+}
+
+bool EditJournal::replay(FrameData& data, size_t group, bool forward, std::vector<int>& touched,
+                         std::string& error) {
+    size_t first = group ? m_groupEnds[group - 1] : 0;
+    size_t last = m_groupEnds[group];
+
+    // Check every int first, so a refused step writes nothing. Read through
+    // peek_sequence to avoid unsharing sequences for a step that is refused.
+    for (size_t i = first; i < last; ++i) {
+        const ParamEdit& edit = m_edits[i];
+        const int* value = peekParamSlot(data, edit);
+        if (!value || *value != (forward ? edit.before : edit.after)) {
+            clear();
+            error = "The document changed outside the journal; undo history was cleared.";
+            return false;
+        }
+    }
+
+    size_t touchedFrom = touched.size();
+    for (size_t i = first; i < last; ++i) {
+        const ParamEdit& edit = m_edits[i];
+        *paramSlot(data, edit) = forward ? edit.after : edit.before;
+        if (touched.size() == touchedFrom || touched.back() != edit.seqIndex) {
+            touched.push_back(edit.seqIndex);
+        }
+    }
+    std::sort(touched.begin() + touchedFrom, touched.end());
+    touched.erase(std::unique(touched.begin() + touchedFrom, touched.end()), touched.end());
+    for (size_t i = touchedFrom; i < touched.size(); ++i) {
+        data.mark_modified(touched[i]);
+    }
+    return true;
+}
+
+void EditJournal::clear() {
+    m_edits.clear();
+    m_groupEnds.clear();
+    m_undoGroups = 0;
+    m_openGroupStart = SIZE_MAX;
+}
+
+void EditJournal::enforceLimit() {
+    if (m_openGroupStart != SIZE_MAX) {
+        return;
+    }
+    size_t limitEdits = m_memoryLimit / sizeof(ParamEdit);
+    auto keptAfterDropping = [this](size_t groups) {
+        return m_edits.size() - (groups ? m_groupEnds[groups - 1] : 0);
+    };
+    // Drop whole undo groups from the front, never the newest group and
+    // never a redo group.
+    size_t dropGroups = 0;
+    size_t maxDrop = std::min(m_undoGroups, m_groupEnds.empty() ? size_t{0} : m_groupEnds.size() - 1);
+    while (dropGroups < maxDrop && keptAfterDropping(dropGroups) > limitEdits) {
+        ++dropGroups;
+    }
+    if (dropGroups == 0) {
+        return;
+    }
+    size_t dropEdits = m_groupEnds[dropGroups - 1];
+    m_edits.erase(m_edits.begin(), m_edits.begin() + static_cast<std::ptrdiff_t>(dropEdits));
+    m_groupEnds.erase(m_groupEnds.begin(), m_groupEnds.begin() + static_cast<std::ptrdiff_t>(dropGroups));
+    for (size_t& end : m_groupEnds) {
+        end -= dropEdits;
+    }
+    m_undoGroups -= dropGroups;
+}
+
+MemoryUsage EditJournal::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_edits);
+    usage.add_vector(m_groupEnds);
+    return usage;
+}
+
+} // namespace varswap
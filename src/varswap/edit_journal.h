@@ -0,0 +1,91 @@
+#ifndef VARSWAP_EDIT_JOURNAL_H_GUARD
+#define VARSWAP_EDIT_JOURNAL_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace varswap {
+
+// One parameter int of one block, before and after an edit. `generation`
+// is the owning sequence's generation when the edit was made.
+struct ParamEdit {
+    int seqIndex;
+    std::uint16_t frameIndex;
+    std::uint16_t blockIndex;
+    std::uint32_t generation;
+    bool isEffect;
+    std::uint8_t slot;
+    int before;
+    int after;
+};
+
+// Parameters of one block, copied before it is edited so that the edit can
+// be journaled as a diff. IF blocks use the first 9 ints.
+struct ParamSnapshot {
+    std::array<int, sizeof(Frame_EF::parameters) / sizeof(int)> values{};
+    bool taken = false;
+};
+
+// Undo/redo history of parameter edits, grouped per apply action. Undo and
+// redo write back only the recorded ints, so their cost is the size of the
+// group rather than of the patterns it touched. Groups are kept in one flat
+// array; once it outgrows the memory limit the oldest groups are dropped,
+// but the newest group is always kept.
+//
+// A group is refused, and the whole history dropped, when one of its blocks
+// was structurally edited or holds a different value than recorded, since
+// the edit can no longer be undone or redone exactly.
+class EditJournal {
+public:
+    static constexpr size_t kDefaultMemoryLimit = 16u << 20;
+
+    void setMemoryLimit(size_t bytes);
+    size_t memoryLimit() const { return m_memoryLimit; }
+
+    // Edits recorded between begin and commit form one undo step. Commit
+    // merges repeated edits of one int into a single edit from the first
+    // `before` to the last `after`, dropping it when the two match; a group
+    // left empty is discarded. Beginning a group clears the redo side.
+    void beginGroup();
+    void record(const ParamEdit& edit);
+    // Takes `before` of the block behind `occ`; false when `occ` is stale.
+    static bool snapshot(const FrameData& data, const Occurrence& occ, ParamSnapshot& before);
+    // Records every parameter of the block behind `occ` that now differs
+    // from `before`.
+    void recordBlock(const FrameData& data, const Occurrence& occ, const ParamSnapshot& before);
+    void commitGroup();
+
+    bool canUndo() const { return m_undoGroups > 0; }
+    bool canRedo() const { return m_undoGroups < m_groupEnds.size(); }
+    size_t undoDepth() const { return m_undoGroups; }
+    size_t redoDepth() const { return m_groupEnds.size() - m_undoGroups; }
+
+    // Write the group back and append the sequences it touched, sorted and
+    // unique, to `touched`. False with `error` set when nothing was written.
+    bool undo(FrameData& data, std::vector<int>& touched, std::string& error);
+    bool redo(FrameData& data, std::vector<int>& touched, std::string& error);
+    void clear();
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    bool replay(FrameData& data, size_t group, bool forward, std::vector<int>& touched, std::string& error);
+    void mergeOpenGroup();
+    void enforceLimit();
+
+    std::vector<ParamEdit> m_edits;
+    std::vector<size_t> m_groupEnds; // end offset in m_edits per group
+    size_t m_undoGroups = 0; // groups [0, m_undoGroups) can be undone
+    size_t m_openGroupStart = SIZE_MAX;
+    size_t m_memoryLimit = kDefaultMemoryLimit;
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_EDIT_JOURNAL_H_GUARD */
@@ -1,7 +1,9 @@
 #include "varswap/occurrence.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <thread>
 
 namespace varswap {
 
@@ -35,312 +37,341 @@ int composeProjectileRaw(int varId, int delta, int base) {
     return varId * base + delta;
 }
 
-void applyProjectileCategoryOverrides(Occurrence& occ) {
-    if (occ.category != VarCategory::Projectile) {
-        return;
+int varFromRaw(ValueEncoding encoding, int raw) {
+    switch (encoding) {
+        case ValueEncoding::Direct:
+            return raw;
+        case ValueEncoding::ProjectileComposite:
+            return projectileVarFromRaw(raw);
+        case ValueEncoding::TensComposite:
+            return std::div(raw, 10).quot;
+        case ValueEncoding::HundredsComposite:
+        default:
+            return std::div(raw, 100).quot;
     }
-    if (!occ.valuePtr) {
-        return;
+}
+
+int remainderFromRaw(ValueEncoding encoding, int raw) {
+    switch (encoding) {
+        case ValueEncoding::ProjectileComposite:
+            return projectileDeltaFromRaw(raw);
+        case ValueEncoding::TensComposite:
+            return std::div(raw, 10).rem;
+        case ValueEncoding::HundredsComposite:
+            return std::div(raw, 100).rem;
+        case ValueEncoding::Direct:
+        default:
+            return 0;
     }
-    if (occ.encoding != ValueEncoding::TensComposite && occ.encoding != ValueEncoding::ProjectileComposite) {
-        return;
+}
+
+int composeRaw(ValueEncoding encoding, int raw, int newVar) {
+    switch (encoding) {
+        case ValueEncoding::Direct:
+            return newVar;
+        case ValueEncoding::ProjectileComposite:
+            return composeProjectileRaw(newVar, projectileDeltaFromRaw(raw), projectileBase(raw));
+        case ValueEncoding::TensComposite:
+            return newVar * 10 + std::div(raw, 10).rem;
+        case ValueEncoding::HundredsComposite:
+        default:
+            return newVar * 100 + std::div(raw, 100).rem;
     }
-    int raw = *occ.valuePtr;
-    int base = (occ.encoding == ValueEncoding::ProjectileComposite) ? projectileBase(raw) : 10;
+}
+
+VarCategory projectileCategoryOverride(VarCategory category, ValueEncoding encoding, int raw) {
+    if (category != VarCategory::Projectile) {
+        return category;
+    }
+    if (encoding != ValueEncoding::TensComposite && encoding != ValueEncoding::ProjectileComposite) {
+        return category;
+    }
+    int base = (encoding == ValueEncoding::ProjectileComposite) ? projectileBase(raw) : 10;
     if (base <= 0) {
-        return;
+        return category;
     }
     int remainder = raw % base;
     if (remainder < 0) {
         remainder += base;
     }
     if (remainder == 0) {
-        occ.category = VarCategory::ProjectileNoChange;
-    }
-}
-
-Occurrence makeOccurrence(OccurrenceKind kind,
-                          VarCategory category,
-                          Sequence* seq,
-                          Frame* frame,
-                          Frame_IF* ifBlock,
-                          Frame_EF* efBlock,
-                          int seqIndex,
-                          int frameIndex,
-                          int blockIndex,
-                          ValueEncoding encoding,
-                          int* valuePtr) {
-    Occurrence occ{kind, category, seq, frame, ifBlock, efBlock, seqIndex, frameIndex, blockIndex, encoding, valuePtr};
-    applyProjectileCategoryOverrides(occ);
+        return VarCategory::ProjectileNoChange;
+    }
+    return category;
+}
+
+bool ifMatchesKind(OccurrenceKind kind, const Frame_IF& cond) {
+    OccurrenceKind actual;
+    return classifyIf(cond.type, actual) && actual == kind;
+}
+
+bool efMatchesKind(OccurrenceKind kind, const Frame_EF& effect) {
+    OccurrenceKind actual;
+    return classifyEf(effect.type, effect.number, actual) && actual == kind;
+}
+
+// Resolves the owning sequence without unsharing it.
+const Sequence* resolveSequence(const FrameData& data, const Occurrence& occ) {
+    const Sequence* seq = data.peek_sequence(occ.seqIndex);
+    if (!seq || seq->generation != occ.generation || occ.frameIndex >= seq->frames.size()) {
+        return nullptr;
+    }
+    return seq;
+}
+
+const int* resolveParameters(const FrameData& data, const Occurrence& occ) {
+    if (occ.isEffect()) {
+        const Frame_EF* effect = resolveEf(data, occ);
+        return effect ? effect->parameters : nullptr;
+    }
+    const Frame_IF* cond = resolveIf(data, occ);
+    return cond ? cond->parameters : nullptr;
+}
+
+} // namespace
+
+const KindLayout kKindLayouts[static_cast<int>(OccurrenceKind::Count)] = {
+    //  category                 encoding                            effect jumpPat   Val Cmp Mode Jump Chg ChgMode
+    {VarCategory::Projectile, ValueEncoding::TensComposite,       false, false, {3, -1, -1, -1, -1, -1}}, // IfType2
+    {VarCategory::Projectile, ValueEncoding::TensComposite,       false, true,  {3, -1, -1, 0, -1, -1}},  // IfType3
+    {VarCategory::Projectile, ValueEncoding::TensComposite,       false, true,  {1, -1, -1, 0, -1, -1}},  // IfType24
+    {VarCategory::Extra,      ValueEncoding::Direct,              false, true,  {1, 2, 3, 0, -1, -1}},    // IfType25
+    {VarCategory::Extra,      ValueEncoding::Direct,              false, false, {1, -1, -1, -1, 2, -1}},  // IfType31
+    {VarCategory::Extra,      ValueEncoding::Direct,              false, false, {3, -1, -1, -1, 0, 4}},   // IfType38
+    {VarCategory::Projectile, ValueEncoding::TensComposite,       true,  false, {8, -1, -1, -1, -1, -1}}, // EfType1
+    {VarCategory::Projectile, ValueEncoding::TensComposite,       true,  false, {9, -1, -1, -1, -1, -1}}, // EfType11
+    {VarCategory::Projectile, ValueEncoding::ProjectileComposite, true,  false, {0, -1, -1, -1, -1, -1}}, // EfType6No100
+    {VarCategory::Projectile, ValueEncoding::ProjectileComposite, true,  false, {0, -1, -1, -1, -1, -1}}, // EfType6No101
+    {VarCategory::Dash,       ValueEncoding::Direct,              true,  false, {0, -1, -1, -1, -1, -1}}, // EfType6No102
+    {VarCategory::Dash,       ValueEncoding::Direct,              true,  false, {0, -1, -1, -1, -1, -1}}, // EfType6No103
+    {VarCategory::Extra,      ValueEncoding::Direct,              true,  false, {0, -1, -1, -1, 1, 2}},   // EfType6No105
+};
+
+const KindLayout* gKindLayouts = kKindLayouts;
+
+Occurrence makeOccurrence(OccurrenceKind kind, int seqIndex, size_t frameIndex, size_t blockIndex,
+                          unsigned int generation, const int* parameters) {
+    const KindLayout& layout = kindLayout(kind);
+    int raw = parameters[layout.slots[static_cast<int>(OccurrenceField::Value)]];
+    Occurrence occ{};
+    occ.seqIndex = seqIndex;
+    occ.frameIndex = static_cast<std::uint16_t>(frameIndex);
+    occ.blockIndex = static_cast<std::uint16_t>(blockIndex);
+    occ.generation = generation;
+    occ.kind = kind;
+    occ.category = projectileCategoryOverride(layout.category, layout.encoding, raw);
     return occ;
 }
 
+namespace {
+
+void collectFromSequence(const Sequence* seq, int seqIdx, std::vector<Occurrence>& result) {
+    if (!seq) {
+        return;
+    }
+    size_t frameCount = std::min<size_t>(seq->frames.size(), kMaxHandleIndex);
+    for (size_t frameIdx = 0; frameIdx < frameCount; ++frameIdx) {
+        const Frame& frame = seq->frames[frameIdx];
+        OccurrenceKind kind;
+
+        size_t ifCount = std::min<size_t>(frame.IF.size(), kMaxHandleIndex);
+        for (size_t ifIdx = 0; ifIdx < ifCount; ++ifIdx) {
+            const Frame_IF& cond = frame.IF[ifIdx];
+            if (classifyIf(cond.type, kind)) {
+                result.push_back(makeOccurrence(kind, seqIdx, frameIdx, ifIdx, seq->generation, cond.parameters));
+            }
+        }
+
+        size_t efCount = std::min<size_t>(frame.EF.size(), kMaxHandleIndex);
+        for (size_t efIdx = 0; efIdx < efCount; ++efIdx) {
+            const Frame_EF& effect = frame.EF[efIdx];
+            if (classifyEf(effect.type, effect.number, kind)) {
+                result.push_back(makeOccurrence(kind, seqIdx, frameIdx, efIdx, seq->generation, effect.parameters));
+            }
+        }
+    }
+}
+
 } // namespace
 
-std::vector<Occurrence> collectOccurrences(FrameData& data) {
+void collectSequenceOccurrences(const FrameData& data, int seqIdx, std::vector<Occurrence>& result) {
+    collectFromSequence(data.peek_sequence(seqIdx), seqIdx, result);
+}
+
+namespace {
+
+// Sequences per work item. Workers claim chunks in index order and each
+// chunk fills its own vector, so concatenating chunks in index order gives
+// exactly the serial output however the chunks were scheduled.
+constexpr int kScanChunk = 32;
+
+template <typename SequenceAt>
+std::vector<Occurrence> collectAll(int seqCount, unsigned threadCount, const SequenceAt& sequenceAt) {
     std::vector<Occurrence> result;
-    int seqCount = data.get_sequence_count();
-    for (int seqIdx = 0; seqIdx < seqCount; ++seqIdx) {
-        Sequence* seq = data.get_sequence(seqIdx);
-        if (!seq) {
-            continue;
+    const int chunkCount = (seqCount + kScanChunk - 1) / kScanChunk;
+    unsigned workers = resolveScanThreads(threadCount);
+    if (workers > static_cast<unsigned>(chunkCount)) {
+        workers = static_cast<unsigned>(chunkCount);
+    }
+    if (workers <= 1) {
+        for (int seqIdx = 0; seqIdx < seqCount; ++seqIdx) {
+            collectFromSequence(sequenceAt(seqIdx), seqIdx, result);
         }
-        for (size_t frameIdx = 0; frameIdx < seq->frames.size(); ++frameIdx) {
-            Frame& frame = seq->frames[frameIdx];
-
-            for (size_t ifIdx = 0; ifIdx < frame.IF.size(); ++ifIdx) {
-                Frame_IF& cond = frame.IF[ifIdx];
-                switch (cond.type) {
-                    case 2:
-                        result.emplace_back(makeOccurrence(OccurrenceKind::IfType2, VarCategory::Projectile,
-                                                           seq, &frame, &cond, nullptr, seqIdx,
-                                                           static_cast<int>(frameIdx), static_cast<int>(ifIdx),
-                                                           ValueEncoding::TensComposite, &cond.parameters[3]));
-                        break;
-                    case 3:
-                        {
-                            auto& occ = result.emplace_back(makeOccurrence(OccurrenceKind::IfType3, VarCategory::Projectile,
-                                                            seq, &frame, &cond, nullptr, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(ifIdx),
-                                                            ValueEncoding::TensComposite, &cond.parameters[3]));
-                            occ.jumpTargetPtr = &cond.parameters[0];
-                            occ.jumpTargetSupportsPattern = true;
-                        }
-                        break;
-                    case 24:
-                        {
-                            auto& occ = result.emplace_back(makeOccurrence(OccurrenceKind::IfType24, VarCategory::Projectile,
-                                                            seq, &frame, &cond, nullptr, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(ifIdx),
-                                                            ValueEncoding::TensComposite, &cond.parameters[1]));
-                            occ.jumpTargetPtr = &cond.parameters[0];
-                            occ.jumpTargetSupportsPattern = true;
-                        }
-                        break;
-                    case 25:
-                        {
-                            auto& occ = result.emplace_back(makeOccurrence(OccurrenceKind::IfType25, VarCategory::Extra,
-                                                            seq, &frame, &cond, nullptr, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(ifIdx),
-                                                            ValueEncoding::Direct, &cond.parameters[1]));
-                            occ.compareValuePtr = &cond.parameters[2];
-                            occ.compareModePtr = &cond.parameters[3];
-                            occ.jumpTargetPtr = &cond.parameters[0];
-                            occ.jumpTargetSupportsPattern = true;
-                        }
-                        break;
-                    case 31:
-                        {
-                            auto& occ = result.emplace_back(makeOccurrence(OccurrenceKind::IfType31, VarCategory::Extra,
-                                                            seq, &frame, &cond, nullptr, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(ifIdx),
-                                                            ValueEncoding::Direct, &cond.parameters[1]));
-                            occ.changeValuePtr = &cond.parameters[2];
-                        }
-                        break;
-                    case 38:
-                        {
-                            auto& occ = result.emplace_back(makeOccurrence(OccurrenceKind::IfType38, VarCategory::Extra,
-                                                            seq, &frame, &cond, nullptr, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(ifIdx),
-                                                            ValueEncoding::Direct, &cond.parameters[3]));
-                            occ.changeValuePtr = &cond.parameters[0];
-                            occ.changeModePtr = &cond.parameters[4];
-                        }
-                        break;
-                    default:
-                        break;
-                }
-            }
+        return result;
+    }
 
-            for (size_t efIdx = 0; efIdx < frame.EF.size(); ++efIdx) {
-                Frame_EF& effect = frame.EF[efIdx];
-                switch (effect.type) {
-                    case 1:
-                    case 101:
-                        result.emplace_back(makeOccurrence(OccurrenceKind::EfType1, VarCategory::Projectile,
-                                                          seq, &frame, nullptr, &effect, seqIdx,
-                                                          static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                          ValueEncoding::TensComposite, &effect.parameters[8]));
-                        break;
-                    case 11:
-                    case 111:
-                        result.emplace_back(makeOccurrence(OccurrenceKind::EfType11, VarCategory::Projectile,
-                                                          seq, &frame, nullptr, &effect, seqIdx,
-                                                          static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                          ValueEncoding::TensComposite, &effect.parameters[9]));
-                        break;
-                    case 6:
-                        switch (effect.number) {
-                            case 100:
-                                result.push_back(makeOccurrence(OccurrenceKind::EfType6No100, VarCategory::Projectile,
-                                                            seq, &frame, nullptr, &effect, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                            ValueEncoding::ProjectileComposite, &effect.parameters[0]));
-                                break;
-                            case 101:
-                                result.push_back(makeOccurrence(OccurrenceKind::EfType6No101, VarCategory::Projectile,
-                                                            seq, &frame, nullptr, &effect, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                            ValueEncoding::ProjectileComposite, &effect.parameters[0]));
-                                break;
-                            case 102:
-                                result.push_back(makeOccurrence(OccurrenceKind::EfType6No102, VarCategory::Dash,
-                                                            seq, &frame, nullptr, &effect, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                            ValueEncoding::Direct, &effect.parameters[0]));
-                                break;
-                            case 103:
-                                result.push_back(makeOccurrence(OccurrenceKind::EfType6No103, VarCategory::Dash,
-                                                            seq, &frame, nullptr, &effect, seqIdx,
-                                                            static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                            ValueEncoding::Direct, &effect.parameters[0]));
-                                break;
-                            case 105:
-                                {
-                                    auto& occ = result.emplace_back(makeOccurrence(OccurrenceKind::EfType6No105, VarCategory::Extra,
-                                                                seq, &frame, nullptr, &effect, seqIdx,
-                                                                static_cast<int>(frameIdx), static_cast<int>(efIdx),
-                                                                ValueEncoding::Direct, &effect.parameters[0]));
-                                    occ.changeValuePtr = &effect.parameters[1];
-                                    occ.changeModePtr = &effect.parameters[2];
-                                }
-                                break;
-                            default:
-                                break;
-                        }
-                        break;
-                    default:
-                        break;
-                }
+    std::vector<std::vector<Occurrence>> chunks(static_cast<size_t>(chunkCount));
+    std::atomic<int> nextChunk{0};
+    auto work = [&]() {
+        for (int chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < chunkCount;
+             chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) {
+            const int first = chunk * kScanChunk;
+            const int last = std::min(first + kScanChunk, seqCount);
+            auto& out = chunks[static_cast<size_t>(chunk)];
+            for (int seqIdx = first; seqIdx < last; ++seqIdx) {
+                collectFromSequence(sequenceAt(seqIdx), seqIdx, out);
             }
         }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned i = 1; i < workers; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += chunk.size();
+    }
+    result.reserve(total);
+    for (const auto& chunk : chunks) {
+        result.insert(result.end(), chunk.begin(), chunk.end());
     }
     return result;
 }
 
-std::string kindLabel(OccurrenceKind kind) {
-    switch (kind) {
-        case OccurrenceKind::IfType2:
-            return "IF type 2 (Effect despawn var delta)";
-        case OccurrenceKind::IfType3:
-            return "IF type 3 (Branch on hit var delta)";
-        case OccurrenceKind::IfType24:
-            return "IF type 24 (Projectile variable check)";
-        case OccurrenceKind::IfType25:
-            return "IF type 25 (Variable comparison)";
-        case OccurrenceKind::IfType31:
-            return "IF type 31 (Change variable on command)";
-        case OccurrenceKind::IfType38:
-            return "IF type 38 (Change variable on hit)";
-        case OccurrenceKind::EfType1:
-            return "EF type 1/101 (Spawn pattern var delta)";
-        case OccurrenceKind::EfType11:
-            return "EF type 11/111 (Random spawn var delta)";
-        case OccurrenceKind::EfType6No100:
-            return "EF type 6 #100 (Increase projectile variable)";
-        case OccurrenceKind::EfType6No101:
-            return "EF type 6 #101 (Decrease projectile variable)";
-        case OccurrenceKind::EfType6No102:
-            return "EF type 6 #102 (Increase dash variable)";
-        case OccurrenceKind::EfType6No103:
-            return "EF type 6 #103 (Decrease dash variable)";
-        case OccurrenceKind::EfType6No105:
-            return "EF type 6 #105 (Change variable)";
-    }
-    return "Unknown";
-}
-
-std::string kindCode(OccurrenceKind kind) {
-    switch (kind) {
-        case OccurrenceKind::IfType2:
-            return "IF02";
-        case OccurrenceKind::IfType3:
-            return "IF03";
-        case OccurrenceKind::IfType24:
-            return "IF24";
-        case OccurrenceKind::IfType25:
-            return "IF25";
-        case OccurrenceKind::IfType31:
-            return "IF31";
-        case OccurrenceKind::IfType38:
-            return "IF38";
-        case OccurrenceKind::EfType1:
-            return "EF1";
-        case OccurrenceKind::EfType11:
-            return "EF11";
-        case OccurrenceKind::EfType6No100:
-            return "EF6-100";
-        case OccurrenceKind::EfType6No101:
-            return "EF6-101";
-        case OccurrenceKind::EfType6No102:
-            return "EF6-102";
-        case OccurrenceKind::EfType6No103:
-            return "EF6-103";
-        case OccurrenceKind::EfType6No105:
-            return "EF6-105";
-    }
-    return "?";
-}
-
-int currentVar(const Occurrence& occ) {
-    if (!occ.valuePtr) {
-        return 0;
+} // namespace
+
+unsigned resolveScanThreads(unsigned threadCount) {
+    if (threadCount != 0) {
+        return threadCount;
     }
-    int raw = *occ.valuePtr;
-    if (occ.encoding == ValueEncoding::Direct) {
-        return raw;
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware != 0 ? hardware : 1;
+}
+
+std::vector<Occurrence> collectOccurrences(const FrameData& data, unsigned threadCount) {
+    return collectAll(data.get_sequence_count(), threadCount,
+                      [&data](int seqIdx) { return data.peek_sequence(seqIdx); });
+}
+
+std::vector<Occurrence> collectOccurrences(const FrameData::Snapshot& snapshot, unsigned threadCount) {
+    return collectAll(snapshot.get_sequence_count(), threadCount,
+                      [&snapshot](int seqIdx) { return snapshot.get_sequence(seqIdx); });
+}
+
+const Frame_IF* resolveIf(const FrameData& data, const Occurrence& occ) {
+    if (occ.isEffect()) {
+        return nullptr;
     }
-    if (occ.encoding == ValueEncoding::ProjectileComposite) {
-        return projectileVarFromRaw(raw);
+    const Sequence* seq = resolveSequence(data, occ);
+    if (!seq) {
+        return nullptr;
     }
-    if (occ.encoding == ValueEncoding::TensComposite) {
-        auto parts = std::div(raw, 10);
-        return parts.quot;
+    const auto& blocks = seq->frames[occ.frameIndex].IF;
+    if (occ.blockIndex >= blocks.size() || !ifMatchesKind(occ.kind, blocks[occ.blockIndex])) {
+        return nullptr;
     }
-    auto parts = std::div(raw, 100);
-    return parts.quot;
+    return &blocks[occ.blockIndex];
 }
 
-int compositeRemainder(const Occurrence& occ) {
-    if (!occ.valuePtr) {
+const Frame_EF* resolveEf(const FrameData& data, const Occurrence& occ) {
+    if (!occ.isEffect()) {
+        return nullptr;
+    }
+    const Sequence* seq = resolveSequence(data, occ);
+    if (!seq) {
+        return nullptr;
+    }
+    const auto& blocks = seq->frames[occ.frameIndex].EF;
+    if (occ.blockIndex >= blocks.size() || !efMatchesKind(occ.kind, blocks[occ.blockIndex])) {
+        return nullptr;
+    }
+    return &blocks[occ.blockIndex];
+}
+
+bool isStale(const FrameData& data, const Occurrence& occ) {
+    return resolveParameters(data, occ) == nullptr;
+}
+
+const int* resolveField(const FrameData& data, const Occurrence& occ, OccurrenceField field) {
+    int slot = kindLayout(occ.kind).slots[static_cast<int>(field)];
+    if (slot < 0) {
+        return nullptr;
+    }
+    const int* parameters = resolveParameters(data, occ);
+    return parameters ? parameters + slot : nullptr;
+}
+
+int readField(const FrameData& data, const Occurrence& occ, OccurrenceField field, int fallback) {
+    const int* value = resolveField(data, occ, field);
+    return value ? *value : fallback;
+}
+
+bool writeField(FrameData& data, const Occurrence& occ, OccurrenceField field, int value) {
+    if (!resolveField(data, occ, field)) {
+        return false;
+    }
+    Sequence* seq = data.get_sequence(occ.seqIndex);
+    Frame& frame = seq->frames[occ.frameIndex];
+    int* parameters = occ.isEffect() ? frame.EF[occ.blockIndex].parameters : frame.IF[occ.blockIndex].parameters;
+    parameters[kindLayout(occ.kind).slots[static_cast<int>(field)]] = value;
+    seq->modified = true;
+    return true;
+}
+
+int currentVar(const FrameData& data, const Occurrence& occ) {
+    const int* value = resolveField(data, occ, OccurrenceField::Value);
+    if (!value) {
         return 0;
     }
-    if (occ.encoding == ValueEncoding::ProjectileComposite) {
-        return projectileDeltaFromRaw(*occ.valuePtr);
+    return varFromRaw(occ.encoding(), *value);
+}
+
+int compositeRemainder(const FrameData& data, const Occurrence& occ) {
+    const int* value = resolveField(data, occ, OccurrenceField::Value);
+    if (!value) {
+        return 0;
     }
-    if (occ.encoding == ValueEncoding::TensComposite) {
-        auto parts = std::div(*occ.valuePtr, 10);
-        return parts.rem;
+    return remainderFromRaw(occ.encoding(), *value);
+}
+
+bool isGlobalProjectileOp(const FrameData& data, const Occurrence& occ) {
+    if (occ.kind != OccurrenceKind::EfType6No100 && occ.kind != OccurrenceKind::EfType6No101) {
+        return false;
     }
-    if (occ.encoding == ValueEncoding::HundredsComposite) {
-        auto parts = std::div(*occ.valuePtr, 100);
-        return parts.rem;
+    if (occ.encoding() != ValueEncoding::ProjectileComposite) {
+        return false;
     }
-    return 0;
+    const int* value = resolveField(data, occ, OccurrenceField::Value);
+    return value && std::abs(*value) >= 100;
 }
 
-void applyVarChange(Occurrence& occ, int newVar) {
-    if (!occ.valuePtr) {
+int composeVarValue(ValueEncoding encoding, int raw, int newVar) {
+    return composeRaw(encoding, raw, newVar);
+}
+
+void applyVarChange(FrameData& data, const Occurrence& occ, int newVar) {
+    const int* value = resolveField(data, occ, OccurrenceField::Value);
+    if (!value) {
         return;
     }
-    if (occ.encoding == ValueEncoding::Direct) {
-        *occ.valuePtr = newVar;
-    } else if (occ.encoding == ValueEncoding::ProjectileComposite) {
-        int raw = *occ.valuePtr;
-        int base = projectileBase(raw);
-        int delta = projectileDeltaFromRaw(raw);
-        *occ.valuePtr = composeProjectileRaw(newVar, delta, base);
-    } else if (occ.encoding == ValueEncoding::TensComposite) {
-        auto parts = std::div(*occ.valuePtr, 10);
-        *occ.valuePtr = newVar * 10 + parts.rem;
-    } else {
-        auto parts = std::div(*occ.valuePtr, 100);
-        *occ.valuePtr = newVar * 100 + parts.rem;
-    }
-    if (occ.sequence) {
-        occ.sequence->modified = true;
-    }
+    writeField(data, occ, OccurrenceField::Value, composeRaw(occ.encoding(), *value, newVar));
 }
 
 const char* categoryLabel(VarCategory category) {
@@ -3,12 +3,13 @@
 
 #include "framedata.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace varswap {
 
-enum class VarCategory {
+enum class VarCategory : std::uint8_t {
     Projectile,
     ProjectileNoChange,
     Extra,
@@ -18,7 +19,9 @@ enum class VarCategory {
     Count
 };
 
-enum class OccurrenceKind {
+// Built-in kinds. A schema file (occurrence_schema.h) can add more, numbered
+// from Count up to kMaxOccurrenceKinds - 1.
+enum class OccurrenceKind : std::uint8_t {
     IfType2,
     IfType3,
     IfType24,
@@ -31,42 +34,124 @@ enum class OccurrenceKind {
     EfType6No101,
     EfType6No102,
     EfType6No103,
-    EfType6No105
+    EfType6No105,
+    Count
 };
 
-enum class ValueEncoding {
+constexpr int kMaxOccurrenceKinds = 64;
+
+enum class ValueEncoding : std::uint8_t {
     Direct,
     TensComposite,
     HundredsComposite,
     ProjectileComposite
 };
 
+// Parameter slots an occurrence can expose for reading and editing.
+enum class OccurrenceField : std::uint8_t {
+    Value,
+    CompareValue,
+    CompareMode,
+    JumpTarget,
+    ChangeValue,
+    ChangeMode,
+    Count
+};
+
+// Static description of where each kind keeps its fields.
+struct KindLayout {
+    VarCategory category;
+    ValueEncoding encoding;
+    bool isEffect;
+    bool jumpTargetSupportsPattern;
+    std::int8_t slots[static_cast<int>(OccurrenceField::Count)]; // -1 when absent
+};
+
+// Jump slots that may name a pattern (jumpTargetSupportsPattern) store
+// pattern p as kPatternJumpOffset + p; smaller values are frame numbers.
+constexpr int kPatternJumpOffset = 10000;
+
+// Layouts of the built-in kinds.
+extern const KindLayout kKindLayouts[static_cast<int>(OccurrenceKind::Count)];
+// Layouts of every kind in the installed schema, indexed by kind.
+extern const KindLayout* gKindLayouts;
+
+inline const KindLayout& kindLayout(OccurrenceKind kind) {
+    return gKindLayouts[static_cast<int>(kind)];
+}
+
+inline bool hasSlot(const KindLayout& layout, OccurrenceField field) {
+    return layout.slots[static_cast<int>(field)] >= 0;
+}
+
+// Compact handle to a tracked EF/IF block. It holds indices rather than
+// pointers, so it survives copy-on-write clones and vector reallocation.
+// `generation` is the owning sequence's generation at scan time; once the
+// sequence is structurally edited the handle is stale and resolves to nothing.
 struct Occurrence {
+    int seqIndex;
+    std::uint16_t frameIndex;
+    std::uint16_t blockIndex;
+    std::uint32_t generation;
     OccurrenceKind kind;
     VarCategory category;
-    Sequence* sequence;
-    Frame* frame;
-    Frame_IF* ifBlock;
-    Frame_EF* efBlock;
-    int seqIndex;
-    int frameIndex;
-    int blockIndex;
-    ValueEncoding encoding;
-    int* valuePtr;
-    int* compareValuePtr = nullptr;
-    int* compareModePtr = nullptr;
-    int* jumpTargetPtr = nullptr;
-    bool jumpTargetSupportsPattern = false;
-    int* changeValuePtr = nullptr;
-    int* changeModePtr = nullptr;
+
+    ValueEncoding encoding() const { return kindLayout(kind).encoding; }
+    bool isEffect() const { return kindLayout(kind).isEffect; }
+    bool jumpTargetSupportsPattern() const { return kindLayout(kind).jumpTargetSupportsPattern; }
+    bool hasField(OccurrenceField field) const {
+        return kindLayout(kind).slots[static_cast<int>(field)] >= 0;
+    }
 };
 
-std::vector<Occurrence> collectOccurrences(FrameData& data);
-std::string kindLabel(OccurrenceKind kind);
-std::string kindCode(OccurrenceKind kind);
-int currentVar(const Occurrence& occ);
-int compositeRemainder(const Occurrence& occ);
-void applyVarChange(Occurrence& occ, int newVar);
+static_assert(sizeof(Occurrence) <= 16, "Occurrence should stay a compact handle");
+
+// Handles store 16-bit frame/block indices; anything beyond is not tracked.
+constexpr size_t kMaxHandleIndex = UINT16_MAX;
+
+// Maps a block to the kind the scanner tracks it as, using the installed
+// schema's lookup tables. False when untracked.
+bool classifyIf(int type, OccurrenceKind& kind);
+bool classifyEf(int type, int number, OccurrenceKind& kind);
+Occurrence makeOccurrence(OccurrenceKind kind, int seqIndex, size_t frameIndex, size_t blockIndex,
+                          unsigned int generation, const int* parameters);
+
+// Scans every sequence. With threadCount > 1 (0 = one per hardware thread)
+// sequences are split across workers; the result is identical to the serial
+// scan. The document must not be edited while a parallel scan runs.
+std::vector<Occurrence> collectOccurrences(const FrameData& data, unsigned threadCount = 1);
+// Scans a published snapshot, e.g. from a worker thread. The handles carry
+// the snapshot's generations, so they resolve against the live document
+// only while those sequences were not structurally edited since.
+std::vector<Occurrence> collectOccurrences(const FrameData::Snapshot& snapshot, unsigned threadCount = 1);
+// Worker count a scan with `threadCount` will use at most.
+unsigned resolveScanThreads(unsigned threadCount);
+// Appends the occurrences of a single sequence, in collectOccurrences order.
+void collectSequenceOccurrences(const FrameData& data, int seqIndex, std::vector<Occurrence>& out);
+
+// Handle resolution. Lookups return nullptr when the handle is stale or the
+// block is of the other kind.
+bool isStale(const FrameData& data, const Occurrence& occ);
+const Frame_IF* resolveIf(const FrameData& data, const Occurrence& occ);
+const Frame_EF* resolveEf(const FrameData& data, const Occurrence& occ);
+const int* resolveField(const FrameData& data, const Occurrence& occ, OccurrenceField field);
+int readField(const FrameData& data, const Occurrence& occ, OccurrenceField field, int fallback = 0);
+// Unshares the owning sequence, writes the field and marks the sequence modified.
+bool writeField(FrameData& data, const Occurrence& occ, OccurrenceField field, int value);
+inline int rawValue(const FrameData& data, const Occurrence& occ) {
+    return readField(data, occ, OccurrenceField::Value);
+}
+
+const char* kindLabel(OccurrenceKind kind);
+const char* kindCode(OccurrenceKind kind);
+int currentVar(const FrameData& data, const Occurrence& occ);
+int compositeRemainder(const FrameData& data, const Occurrence& occ);
+// EF6 #100/#101 writing a global projectile register (|raw| >= 100).
+bool isGlobalProjectileOp(const FrameData& data, const Occurrence& occ);
+// Raw Value that holds `newVar` and keeps the remainder of `raw`; this is
+// what applyVarChange writes.
+int composeVarValue(ValueEncoding encoding, int raw, int newVar);
+void applyVarChange(FrameData& data, const Occurrence& occ, int newVar);
 const char* categoryLabel(VarCategory category);
 
 } // namespace varswap
@@ -0,0 +1,494 @@
+#include "varswap/occurrence_schema.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+namespace varswap {
+
+namespace {
+
+struct BuiltInKind {
+    OccurrenceKind kind;
+    const char* code;
+    const char* label;
+    int types[2]; // second is -1 when unused
+    int number;
+};
+
+const BuiltInKind kBuiltInKinds[] = {
+    {OccurrenceKind::IfType2, "IF02", "IF type 2 (Effect despawn var delta)", {2, -1}, kAnyNumber},
+    {OccurrenceKind::IfType3, "IF03", "IF type 3 (Branch on hit var delta)", {3, -1}, kAnyNumber},
+    {OccurrenceKind::IfType24, "IF24", "IF type 24 (Projectile variable check)", {24, -1}, kAnyNumber},
+    {OccurrenceKind::IfType25, "IF25", "IF type 25 (Variable comparison)", {25, -1}, kAnyNumber},
+    {OccurrenceKind::IfType31, "IF31", "IF type 31 (Change variable on command)", {31, -1}, kAnyNumber},
+    {OccurrenceKind::IfType38, "IF38", "IF type 38 (Change variable on hit)", {38, -1}, kAnyNumber},
+    {OccurrenceKind::EfType1, "EF1", "EF type 1/101 (Spawn pattern var delta)", {1, 101}, kAnyNumber},
+    {OccurrenceKind::EfType11, "EF11", "EF type 11/111 (Random spawn var delta)", {11, 111}, kAnyNumber},
+    {OccurrenceKind::EfType6No100, "EF6-100", "EF type 6 #100 (Increase projectile variable)", {6, -1}, 100},
+    {OccurrenceKind::EfType6No101, "EF6-101", "EF type 6 #101 (Decrease projectile variable)", {6, -1}, 101},
+    {OccurrenceKind::EfType6No102, "EF6-102", "EF type 6 #102 (Increase dash variable)", {6, -1}, 102},
+    {OccurrenceKind::EfType6No103, "EF6-103", "EF type 6 #103 (Decrease dash variable)", {6, -1}, 103},
+    {OccurrenceKind::EfType6No105, "EF6-105", "EF type 6 #105 (Change variable)", {6, -1}, 105},
+};
+
+static_assert(sizeof(kBuiltInKinds) / sizeof(kBuiltInKinds[0]) == static_cast<size_t>(OccurrenceKind::Count),
+              "every built-in kind needs a schema entry");
+
+struct NamedValue {
+    const char* name;
+    int value;
+};
+
+const NamedValue kCategoryNames[] = {
+    {"projectile", static_cast<int>(VarCategory::Projectile)},
+    {"projectile-nochange", static_cast<int>(VarCategory::ProjectileNoChange)},
+    {"extra", static_cast<int>(VarCategory::Extra)},
+    {"dash", static_cast<int>(VarCategory::Dash)},
+    {"assist", static_cast<int>(VarCategory::Assist)},
+    {"unknown", static_cast<int>(VarCategory::Unknown)},
+};
+
+const NamedValue kEncodingNames[] = {
+    {"direct", static_cast<int>(ValueEncoding::Direct)},
+    {"tens", static_cast<int>(ValueEncoding::TensComposite)},
+    {"hundreds", static_cast<int>(ValueEncoding::HundredsComposite)},
+    {"projectile", static_cast<int>(ValueEncoding::ProjectileComposite)},
+};
+
+const NamedValue kSlotNames[] = {
+    {"value", static_cast<int>(OccurrenceField::Value)},
+    {"compare", static_cast<int>(OccurrenceField::CompareValue)},
+    {"mode", static_cast<int>(OccurrenceField::CompareMode)},
+    {"jump", static_cast<int>(OccurrenceField::JumpTarget)},
+    {"change", static_cast<int>(OccurrenceField::ChangeValue)},
+    {"changemode", static_cast<int>(OccurrenceField::ChangeMode)},
+};
+
+template <size_t N>
+bool lookupName(const NamedValue (&names)[N], const std::string& name, int& value) {
+    for (const NamedValue& entry : names) {
+        if (name == entry.name) {
+            value = entry.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseNumber(const std::string& text, int& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || parsed < INT_MIN + 1 || parsed > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// Splits on whitespace; double quotes group, so label="two words" is one token.
+std::vector<std::string> tokenize(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::string current;
+    bool quoted = false;
+    bool inToken = false;
+    for (char ch : line) {
+        if (ch == '"') {
+            quoted = !quoted;
+            inToken = true;
+        } else if (!quoted && (ch == ' ' || ch == '\t' || ch == '\r')) {
+            if (inToken) {
+                tokens.push_back(current);
+                current.clear();
+                inToken = false;
+            }
+        } else if (!quoted && ch == '#') {
+            break;
+        } else {
+            current.push_back(ch);
+            inToken = true;
+        }
+    }
+    if (inToken) {
+        tokens.push_back(current);
+    }
+    return tokens;
+}
+
+int paramCount(bool isEffect) {
+    return isEffect ? 12 : 9;
+}
+
+constexpr int kDenseRange = 256;
+constexpr std::uint8_t kNoKind = 0xFF;
+
+bool isDense(int value) {
+    return value >= 0 && value < kDenseRange;
+}
+
+struct SparseRule {
+    bool isEffect;
+    int type;
+    int number;
+    std::uint8_t kind;
+
+    bool operator<(const SparseRule& other) const {
+        return std::tie(isEffect, type, number) < std::tie(other.isEffect, other.type, other.number);
+    }
+};
+
+// Dense lookup tables built from a schema. Types and EF numbers in
+// [0, kDenseRange) are direct array lookups; anything else falls back to a
+// sorted rule list.
+struct CompiledSchema {
+    OccurrenceSchema schema;
+    std::vector<KindLayout> layouts;
+    std::uint8_t ifKinds[kDenseRange];
+    std::uint8_t efKinds[kDenseRange];          // rules without a number filter
+    std::int16_t efNumberBlocks[kDenseRange];   // index into efNumberKinds, -1 if none
+    std::vector<std::uint8_t> efNumberKinds;    // kDenseRange entries per block
+    std::vector<SparseRule> sparse;
+
+    bool findSparse(bool isEffect, int type, int number, std::uint8_t& kind) const {
+        SparseRule key{isEffect, type, number, kNoKind};
+        auto it = std::lower_bound(sparse.begin(), sparse.end(), key);
+        if (it == sparse.end() || it->isEffect != isEffect || it->type != type || it->number != number) {
+            return false;
+        }
+        kind = it->kind;
+        return true;
+    }
+
+    std::uint8_t classifyIf(int type) const {
+        if (isDense(type)) {
+            return ifKinds[type];
+        }
+        std::uint8_t kind = kNoKind;
+        findSparse(false, type, kAnyNumber, kind);
+        return kind;
+    }
+
+    std::uint8_t classifyEf(int type, int number) const {
+        std::uint8_t kind = kNoKind;
+        if (isDense(type)) {
+            std::int16_t block = efNumberBlocks[type];
+            if (block >= 0 && isDense(number)) {
+                kind = efNumberKinds[static_cast<size_t>(block) * kDenseRange + number];
+                if (kind != kNoKind) {
+                    return kind;
+                }
+            }
+        }
+        if (!sparse.empty() && findSparse(true, type, number, kind)) {
+            return kind;
+        }
+        if (isDense(type)) {
+            return efKinds[type];
+        }
+        findSparse(true, type, kAnyNumber, kind);
+        return kind;
+    }
+};
+
+std::unique_ptr<CompiledSchema> compile(const OccurrenceSchema& schema) {
+    auto compiled = std::make_unique<CompiledSchema>();
+    compiled->schema = schema;
+    compiled->layouts.assign(kMaxOccurrenceKinds, KindLayout{});
+    std::fill(std::begin(compiled->ifKinds), std::end(compiled->ifKinds), kNoKind);
+    std::fill(std::begin(compiled->efKinds), std::end(compiled->efKinds), kNoKind);
+    std::fill(std::begin(compiled->efNumberBlocks), std::end(compiled->efNumberBlocks), std::int16_t(-1));
+
+    const auto& kinds = schema.kinds();
+    for (size_t index = 0; index < kinds.size(); ++index) {
+        const KindDefinition& def = kinds[index];
+        const auto kind = static_cast<std::uint8_t>(index);
+        compiled->layouts[index] = def.layout;
+        for (int type : def.types) {
+            if (!def.layout.isEffect) {
+                if (isDense(type)) {
+                    compiled->ifKinds[type] = kind;
+                } else {
+                    compiled->sparse.push_back({false, type, kAnyNumber, kind});
+                }
+            } else if (def.number == kAnyNumber) {
+                if (isDense(type)) {
+                    compiled->efKinds[type] = kind;
+                } else {
+                    compiled->sparse.push_back({true, type, kAnyNumber, kind});
+                }
+            } else if (isDense(type) && isDense(def.number)) {
+                std::int16_t& block = compiled->efNumberBlocks[type];
+                if (block < 0) {
+                    block = static_cast<std::int16_t>(compiled->efNumberKinds.size() / kDenseRange);
+                    compiled->efNumberKinds.resize(compiled->efNumberKinds.size() + kDenseRange, kNoKind);
+                }
+                compiled->efNumberKinds[static_cast<size_t>(block) * kDenseRange + def.number] = kind;
+            } else {
+                compiled->sparse.push_back({true, type, def.number, kind});
+            }
+        }
+    }
+    std::sort(compiled->sparse.begin(), compiled->sparse.end());
+    return compiled;
+}
+
+std::unique_ptr<CompiledSchema>& installedSchema() {
+    static std::unique_ptr<CompiledSchema> installed = compile(OccurrenceSchema::builtIn());
+    return installed;
+}
+
+} // namespace
+
+OccurrenceSchema OccurrenceSchema::builtIn() {
+    OccurrenceSchema schema;
+    for (const BuiltInKind& entry : kBuiltInKinds) {
+        KindDefinition def;
+        def.code = entry.code;
+        def.label = entry.label;
+        def.layout = kKindLayouts[static_cast<int>(entry.kind)];
+        for (int type : entry.types) {
+            if (type >= 0) {
+                def.types.push_back(type);
+            }
+        }
+        def.number = entry.number;
+        schema.m_kinds.push_back(std::move(def));
+    }
+    return schema;
+}
+
+bool OccurrenceSchema::parseLine(const std::string& line, std::string& error) {
+    std::vector<std::string> tokens = tokenize(line);
+    if (tokens.empty()) {
+        return true;
+    }
+    if (tokens.size() < 3) {
+        error = "expected <code> <if|ef> <types>";
+        return false;
+    }
+
+    bool isEffect = false;
+    if (tokens[1] == "ef") {
+        isEffect = true;
+    } else if (tokens[1] != "if") {
+        error = "block must be 'if' or 'ef', got '" + tokens[1] + "'";
+        return false;
+    }
+
+    auto existing = std::find_if(m_kinds.begin(), m_kinds.end(),
+                                 [&](const KindDefinition& def) { return def.code == tokens[0]; });
+    KindDefinition def;
+    if (existing != m_kinds.end()) {
+        if (existing->layout.isEffect != isEffect) {
+            error = "kind " + tokens[0] + " cannot change between IF and EF";
+            return false;
+        }
+        def = *existing;
+    } else {
+        def.code = tokens[0];
+        def.label = tokens[0];
+        def.layout.category = VarCategory::Unknown;
+        def.layout.encoding = ValueEncoding::Direct;
+        def.layout.isEffect = isEffect;
+        def.layout.jumpTargetSupportsPattern = false;
+        std::fill(std::begin(def.layout.slots), std::end(def.layout.slots), std::int8_t(-1));
+    }
+
+    def.types.clear();
+    if (tokens[2] != "none") {
+        std::stringstream list(tokens[2]);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            int type = 0;
+            if (!parseNumber(item, type)) {
+                error = "invalid type '" + item + "'";
+                return false;
+            }
+            def.types.push_back(type);
+        }
+    }
+
+    for (size_t i = 3; i < tokens.size(); ++i) {
+        const std::string& token = tokens[i];
+        if (token == "jumppattern") {
+            def.layout.jumpTargetSupportsPattern = true;
+            continue;
+        }
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            error = "unexpected '" + token + "'";
+            return false;
+        }
+        std::string key = token.substr(0, eq);
+        std::string value = token.substr(eq + 1);
+        int parsed = 0;
+        if (key == "label") {
+            def.label = value;
+        } else if (key == "number") {
+            if (!isEffect) {
+                error = "number= only applies to EF kinds";
+                return false;
+            }
+            if (value == "any") {
+                def.number = kAnyNumber;
+            } else if (!parseNumber(value, def.number)) {
+                error = "invalid number '" + value + "'";
+                return false;
+            }
+        } else if (key == "category") {
+            if (!lookupName(kCategoryNames, value, parsed)) {
+                error = "unknown category '" + value + "'";
+                return false;
+            }
+            def.layout.category = static_cast<VarCategory>(parsed);
+        } else if (key == "encoding") {
+            if (!lookupName(kEncodingNames, value, parsed)) {
+                error = "unknown encoding '" + value + "'";
+                return false;
+            }
+            def.layout.encoding = static_cast<ValueEncoding>(parsed);
+        } else if (lookupName(kSlotNames, key, parsed)) {
+            int slot = 0;
+            if (!parseNumber(value, slot) || slot < -1 || slot >= paramCount(isEffect)) {
+                error = "slot " + key + " must be -1.." + std::to_string(paramCount(isEffect) - 1);
+                return false;
+            }
+            def.layout.slots[parsed] = static_cast<std::int8_t>(slot);
+        } else {
+            error = "unknown key '" + key + "'";
+            return false;
+        }
+    }
+
+    if (!def.types.empty() && def.layout.slots[static_cast<int>(OccurrenceField::Value)] < 0) {
+        error = "kind " + def.code + " needs a value= slot";
+        return false;
+    }
+    if (existing != m_kinds.end()) {
+        *existing = std::move(def);
+    } else {
+        m_kinds.push_back(std::move(def));
+    }
+    return true;
+}
+
+bool OccurrenceSchema::parse(std::istream& in, std::string& error) {
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        std::string lineError;
+        if (!parseLine(line, lineError)) {
+            error = "line " + std::to_string(lineNumber) + ": " + lineError;
+            return false;
+        }
+    }
+    return validate(error);
+}
+
+bool OccurrenceSchema::loadFile(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    if (!parse(in, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool OccurrenceSchema::validate(std::string& error) const {
+    if (m_kinds.size() > static_cast<size_t>(kMaxOccurrenceKinds)) {
+        error = "at most " + std::to_string(kMaxOccurrenceKinds) + " kinds are supported";
+        return false;
+    }
+    std::set<std::tuple<bool, int, int>> seen;
+    for (const KindDefinition& def : m_kinds) {
+        for (int slot : def.layout.slots) {
+            if (slot >= paramCount(def.layout.isEffect)) {
+                error = "kind " + def.code + " has a slot out of range";
+                return false;
+            }
+        }
+        if (def.layout.jumpTargetSupportsPattern && !hasSlot(def.layout, OccurrenceField::JumpTarget)) {
+            error = "kind " + def.code + " sets jumppattern without a jump= slot";
+            return false;
+        }
+        for (int type : def.types) {
+            int number = def.layout.isEffect ? def.number : kAnyNumber;
+            if (!seen.emplace(def.layout.isEffect, type, number).second) {
+                error = std::string(def.layout.isEffect ? "EF" : "IF") + " type " + std::to_string(type) +
+                        (number == kAnyNumber ? std::string() : " #" + std::to_string(number)) +
+                        " is claimed by more than one kind (" + def.code + ")";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool installSchema(const OccurrenceSchema& schema, std::string& error) {
+    if (!schema.validate(error)) {
+        return false;
+    }
+    auto compiled = compile(schema);
+    gKindLayouts = compiled->layouts.data();
+    installedSchema() = std::move(compiled);
+    return true;
+}
+
+const OccurrenceSchema& activeSchema() {
+    return installedSchema()->schema;
+}
+
+bool parseCategoryName(const std::string& name, VarCategory& category) {
+    int parsed = 0;
+    if (!lookupName(kCategoryNames, name, parsed)) {
+        return false;
+    }
+    category = static_cast<VarCategory>(parsed);
+    return true;
+}
+
+bool classifyIf(int type, OccurrenceKind& kind) {
+    std::uint8_t found = installedSchema()->classifyIf(type);
+    if (found == kNoKind) {
+        return false;
+    }
+    kind = static_cast<OccurrenceKind>(found);
+    return true;
+}
+
+bool classifyEf(int type, int number, OccurrenceKind& kind) {
+    std::uint8_t found = installedSchema()->classifyEf(type, number);
+    if (found == kNoKind) {
+        return false;
+    }
+    kind = static_cast<OccurrenceKind>(found);
+    return true;
+}
+
+const char* kindLabel(OccurrenceKind kind) {
+    const auto& kinds = activeSchema().kinds();
+    size_t index = static_cast<size_t>(kind);
+    return index < kinds.size() ? kinds[index].label.c_str() : "Unknown";
+}
+
+const char* kindCode(OccurrenceKind kind) {
+    const auto& kinds = activeSchema().kinds();
+    size_t index = static_cast<size_t>(kind);
+    return index < kinds.size() ? kinds[index].code.c_str() : "?";
+}
+
+} // namespace varswap
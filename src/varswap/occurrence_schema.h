@@ -0,0 +1,66 @@
+#ifndef VARSWAP_OCCURRENCE_SCHEMA_H_GUARD
+#define VARSWAP_OCCURRENCE_SCHEMA_H_GUARD
+
+#include "varswap/occurrence.h"
+
+#include <climits>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace varswap {
+
+constexpr int kAnyNumber = INT_MIN;
+
+// One tracked kind: which blocks it matches and where their fields live.
+// The index in OccurrenceSchema::kinds() is the OccurrenceKind value.
+struct KindDefinition {
+    std::string code;
+    std::string label;
+    KindLayout layout{};
+    std::vector<int> types; // IF or EF types mapped to this kind; empty = untracked
+    int number = kAnyNumber; // EF number filter
+};
+
+// The set of kinds the scanner tracks. Starts from the built-in kinds and can
+// be extended or overridden by a schema file, one kind per line:
+//
+//   # code   block types   [number=N] category=C encoding=E value=N [slots] [label="..."]
+//   EF6-106  ef    6       number=106 category=extra encoding=direct value=0 change=1
+//   IF38     if    none
+//
+// block is `if` or `ef`; types is a comma-separated list or `none`. Slots are
+// compare=, mode=, jump=, change= and changemode=; `jumppattern` marks a jump
+// slot that may name a pattern. Categories: projectile, projectile-nochange,
+// extra, dash, assist, unknown. Encodings: direct, tens, hundreds, projectile.
+// A line whose code already exists replaces that kind (keeping its label
+// unless a new one is given); any other code adds a kind.
+class OccurrenceSchema {
+public:
+    static OccurrenceSchema builtIn();
+
+    const std::vector<KindDefinition>& kinds() const { return m_kinds; }
+
+    bool parse(std::istream& in, std::string& error);
+    bool loadFile(const std::string& path, std::string& error);
+    // Checks slot ranges, kind count and that no block maps to two kinds.
+    bool validate(std::string& error) const;
+
+private:
+    bool parseLine(const std::string& line, std::string& error);
+
+    std::vector<KindDefinition> m_kinds;
+};
+
+// Compiles `schema` into the dense lookup tables behind classifyIf,
+// classifyEf, kindLayout, kindLabel and kindCode. Call at startup, before
+// any scan; it must not race with scans or with code holding kind labels.
+bool installSchema(const OccurrenceSchema& schema, std::string& error);
+const OccurrenceSchema& activeSchema();
+
+// Category by its schema-file name (projectile, extra, ...).
+bool parseCategoryName(const std::string& name, VarCategory& category);
+
+} // namespace varswap
+
+#endif /* VARSWAP_OCCURRENCE_SCHEMA_H_GUARD */
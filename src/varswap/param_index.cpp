@@ -0,0 +1,207 @@
+#include "varswap/param_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <sstream>
+
+namespace varswap {
+
+namespace {
+
+bool parseNumber(const std::string& text, int& out) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+} // namespace
+
+bool parseParamQuery(const std::string& text, ParamQuery& query, std::string& error) {
+    std::istringstream in(text);
+    std::string block;
+    std::string type;
+    std::string condition;
+    std::string extra;
+    in >> block >> type >> condition;
+    if (condition.empty() || (in >> extra)) {
+        error = "expected \"<if|ef> <type>[#<number>] p<slot>=<value>[..<value>]\"";
+        return false;
+    }
+
+    ParamQuery parsed;
+    std::transform(block.begin(), block.end(), block.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (block != "if" && block != "ef") {
+        error = "block must be if or ef";
+        return false;
+    }
+    parsed.isEffect = block == "ef";
+
+    size_t hash = type.find('#');
+    if (!parseNumber(type.substr(0, hash), parsed.type)) {
+        error = "invalid type " + type;
+        return false;
+    }
+    if (hash != std::string::npos) {
+        if (!parsed.isEffect || !parseNumber(type.substr(hash + 1), parsed.number)) {
+            error = "only EF blocks take a #number";
+            return false;
+        }
+    }
+
+    size_t equals = condition.find('=');
+    if (condition.size() < 2 || std::tolower(static_cast<unsigned char>(condition[0])) != 'p' ||
+        equals == std::string::npos || !parseNumber(condition.substr(1, equals - 1), parsed.slot)) {
+        error = "expected p<slot>=<value>";
+        return false;
+    }
+    int slotCount = parsed.isEffect ? kEfParamCount : kIfParamCount;
+    if (parsed.slot < 0 || parsed.slot >= slotCount) {
+        error = "slot must be 0.." + std::to_string(slotCount - 1);
+        return false;
+    }
+    std::string values = condition.substr(equals + 1);
+    size_t dots = values.find("..");
+    bool ok = dots == std::string::npos
+                  ? parseNumber(values, parsed.min) && parseNumber(values, parsed.max)
+                  : parseNumber(values.substr(0, dots), parsed.min) && parseNumber(values.substr(dots + 2), parsed.max);
+    if (!ok || parsed.min > parsed.max) {
+        error = "invalid value or range " + values;
+        return false;
+    }
+    query = parsed;
+    return true;
+}
+
+void ParamIndex::build(const BlockTable& table) {
+    clear();
+    m_blocks.reserve(table.columns(BlockKind::If).size() + table.columns(BlockKind::Ef).size());
+    addRows(table.columns(BlockKind::If), false);
+    addRows(table.columns(BlockKind::Ef), true);
+
+    // Ids were appended in scan order, so sorting the pairs keeps scan order
+    // among equal values. Unused slots are all zero and already sorted.
+    for (Column& column : m_columns) {
+        if (!std::is_sorted(column.begin(), column.end())) {
+            std::sort(column.begin(), column.end());
+        }
+        column.shrink_to_fit();
+    }
+    for (auto& entry : m_efNumbers) {
+        std::sort(entry.second.begin(), entry.second.end(),
+                  [](const Group& lhs, const Group& rhs) { return lhs.number < rhs.number; });
+    }
+}
+
+void ParamIndex::addRows(const BlockColumns& cols, bool isEffect) {
+    int slotCount = isEffect ? kEfParamCount : kIfParamCount;
+    auto& groups = isEffect ? m_efGroups : m_ifGroups;
+    for (size_t row = 0; row < cols.size(); ++row) {
+        int type = cols.type[row];
+        int number = isEffect ? cols.number[row] : 0;
+        auto inserted = groups.emplace(packGroup(type, number), static_cast<std::uint32_t>(m_columns.size()));
+        std::uint32_t first = inserted.first->second;
+        if (inserted.second) {
+            m_columns.resize(m_columns.size() + slotCount);
+            if (isEffect) {
+                m_efNumbers[type].push_back({number, first});
+            }
+        }
+        auto id = static_cast<std::uint32_t>(m_blocks.size());
+        m_blocks.push_back({cols.seqIndex[row], cols.frameIndex[row], cols.blockIndex[row]});
+        for (int slot = 0; slot < slotCount; ++slot) {
+            m_columns[first + slot].emplace_back(cols.parameters[slot][row], id);
+        }
+    }
+}
+
+void ParamIndex::clear() {
+    m_blocks.clear();
+    m_columns.clear();
+    m_ifGroups.clear();
+    m_efGroups.clear();
+    m_efNumbers.clear();
+}
+
+std::vector<ParamHit> ParamIndex::find(const ParamQuery& query) const {
+    std::vector<ParamHit> hits;
+    int slotCount = query.isEffect ? kEfParamCount : kIfParamCount;
+    if (query.slot < 0 || query.slot >= slotCount || query.min > query.max) {
+        return hits;
+    }
+
+    std::vector<Group> groups;
+    if (!query.isEffect) {
+        auto it = m_ifGroups.find(packGroup(query.type, 0));
+        if (it != m_ifGroups.end()) {
+            groups.push_back({0, it->second});
+        }
+    } else if (query.number != kAnyNumber) {
+        auto it = m_efGroups.find(packGroup(query.type, query.number));
+        if (it != m_efGroups.end()) {
+            groups.push_back({query.number, it->second});
+        }
+    } else {
+        auto it = m_efNumbers.find(query.type);
+        if (it != m_efNumbers.end()) {
+            groups = it->second;
+        }
+    }
+
+    struct Match {
+        int value;
+        std::uint32_t id;
+        int number;
+    };
+    auto byValue = [](const Match& lhs, const Match& rhs) {
+        return lhs.value != rhs.value ? lhs.value < rhs.value : lhs.id < rhs.id;
+    };
+    // Each group's run is already ordered, so merging the runs is enough.
+    std::vector<Match> matches;
+    for (const Group& group : groups) {
+        const Column& column = m_columns[group.firstColumn + query.slot];
+        auto first = std::lower_bound(column.begin(), column.end(), std::make_pair(query.min, std::uint32_t{0}));
+        auto last = std::upper_bound(first, column.end(), std::make_pair(query.max, UINT32_MAX));
+        size_t runStart = matches.size();
+        for (auto it = first; it != last; ++it) {
+            matches.push_back({it->first, it->second, group.number});
+        }
+        std::inplace_merge(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(runStart), matches.end(),
+                           byValue);
+    }
+
+    hits.reserve(matches.size());
+    for (const Match& match : matches) {
+        const Block& block = m_blocks[match.id];
+        hits.push_back({block.seqIndex, block.frameIndex, block.blockIndex, match.number, match.value});
+    }
+    return hits;
+}
+
+MemoryUsage ParamIndex::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_blocks);
+    usage.add_vector(m_columns);
+    for (const Column& column : m_columns) {
+        usage.add_vector(column);
+    }
+    usage.add_unordered_map(m_ifGroups);
+    usage.add_unordered_map(m_efGroups);
+    usage.add_unordered_map(m_efNumbers);
+    for (const auto& entry : m_efNumbers) {
+        usage.add_vector(entry.second);
+    }
+    return usage;
+}
+
+} // namespace varswap
@@ -0,0 +1,87 @@
+#ifndef VARSWAP_PARAM_INDEX_H_GUARD
+#define VARSWAP_PARAM_INDEX_H_GUARD
+
+#include "framedata.h"
+#include "varswap/block_table.h"
+#include "varswap/occurrence.h"
+#include "varswap/occurrence_schema.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace varswap {
+
+// Blocks whose parameter `slot` holds a value in [min, max]. `number` only
+// applies to EF blocks; kAnyNumber matches every number.
+struct ParamQuery {
+    bool isEffect = true;
+    int type = 0;
+    int number = kAnyNumber;
+    int slot = 0;
+    int min = 0;
+    int max = 0;
+};
+
+// Parses "<if|ef> <type>[#<number>] p<slot>=<value>[..<value>]", e.g.
+// "ef 3 p2=450", "ef 6#105 p0=10..29" or "if 40 p1=12".
+bool parseParamQuery(const std::string& text, ParamQuery& query, std::string& error);
+
+struct ParamHit {
+    int seqIndex;
+    std::uint16_t frameIndex;
+    std::uint16_t blockIndex;
+    int number; // EF number; 0 for IF blocks
+    int value;
+};
+
+// Index over every parameter of every IF and EF block, tracked by the
+// scanner or not. Blocks are grouped by (IF/EF, type, number) through a hash
+// map; each group keeps one column per parameter slot, sorted by value, so
+// an exact value or a value range is a binary search plus the hits. Built in
+// one pass over a BlockTable, which the pane keeps in step with edits per
+// sequence, and rebuilt from it rather than patched.
+class ParamIndex {
+public:
+    void build(const BlockTable& table);
+    void clear();
+    bool empty() const { return m_blocks.empty(); }
+
+    // Hits ordered by value, then scan order.
+    std::vector<ParamHit> find(const ParamQuery& query) const;
+    size_t blockCount() const { return m_blocks.size(); }
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct Block {
+        int seqIndex;
+        std::uint16_t frameIndex;
+        std::uint16_t blockIndex;
+    };
+    struct Group {
+        int number;
+        std::uint32_t firstColumn;
+    };
+    // Sorted (value, block id) pairs of one slot of one group.
+    using Column = std::vector<std::pair<int, std::uint32_t>>;
+
+    static std::uint64_t packGroup(int type, int number) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(type)) << 32) |
+               static_cast<std::uint32_t>(number);
+    }
+
+    void addRows(const BlockColumns& cols, bool isEffect);
+
+    std::vector<Block> m_blocks;
+    std::vector<Column> m_columns;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_ifGroups; // (type, 0) -> first column
+    std::unordered_map<std::uint64_t, std::uint32_t> m_efGroups; // (type, number) -> first column
+    std::unordered_map<int, std::vector<Group>> m_efNumbers; // type -> groups, by number
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_PARAM_INDEX_H_GUARD */
@@ -0,0 +1,176 @@
+#include "varswap/pattern_xref.h"
+
+#include <algorithm>
+
+namespace varswap {
+
+namespace {
+
+constexpr int kSpawnPatternSlot = 0;
+
+} // namespace
+
+const char* patternRefSourceLabel(PatternRefSource source) {
+    switch (source) {
+        case PatternRefSource::IfJump:
+            return "IF jump";
+        case PatternRefSource::EfSpawn:
+            return "EF spawn";
+        case PatternRefSource::FrameEnd:
+        default:
+            return "Frame end";
+    }
+}
+
+bool efSpawnTarget(const Frame_EF& effect, int seqIndex, int& target) {
+    switch (effect.type) {
+        case 1:
+        case 11:
+            target = effect.parameters[kSpawnPatternSlot];
+            return true;
+        case 101:
+        case 111:
+            target = seqIndex + effect.parameters[kSpawnPatternSlot];
+            return true;
+        default:
+            return false;
+    }
+}
+
+void PatternXref::clear() {
+    m_incoming.clear();
+    m_targetsOf.clear();
+}
+
+void PatternXref::build(const FrameData& data) {
+    clear();
+    int seqCount = data.get_sequence_count();
+    m_incoming.resize(seqCount);
+    m_targetsOf.resize(seqCount);
+    std::vector<std::pair<int, PatternRef>> refs;
+    for (int seqIndex = 0; seqIndex < seqCount; ++seqIndex) {
+        refs.clear();
+        readSequence(data, seqIndex, refs);
+        // Sources arrive in order, so appending keeps every list sorted.
+        insertSequence(seqIndex, refs);
+    }
+}
+
+void PatternXref::updateSequence(const FrameData& data, int seqIndex) {
+    if (static_cast<int>(m_incoming.size()) != data.get_sequence_count()) {
+        build(data);
+        return;
+    }
+    if (seqIndex < 0 || seqIndex >= static_cast<int>(m_incoming.size())) {
+        return;
+    }
+    for (int target : m_targetsOf[seqIndex]) {
+        auto& list = m_incoming[target];
+        auto bySeq = [](const PatternRef& ref, int seq) { return ref.seqIndex < seq; };
+        auto first = std::lower_bound(list.begin(), list.end(), seqIndex, bySeq);
+        auto last = first;
+        while (last != list.end() && last->seqIndex == seqIndex) {
+            ++last;
+        }
+        list.erase(first, last);
+    }
+    m_targetsOf[seqIndex].clear();
+
+    std::vector<std::pair<int, PatternRef>> refs;
+    readSequence(data, seqIndex, refs);
+    insertSequence(seqIndex, refs);
+}
+
+void PatternXref::readSequence(const FrameData& data, int seqIndex,
+                               std::vector<std::pair<int, PatternRef>>& out) const {
+    const Sequence* seq = data.peek_sequence(seqIndex);
+    if (!seq) {
+        return;
+    }
+    int seqCount = static_cast<int>(m_incoming.size());
+    auto add = [&](int target, size_t frameIndex, int blockIndex, int slot, PatternRefSource source) {
+        if (target < 0 || target >= seqCount) {
+            return;
+        }
+        PatternRef ref{seqIndex, static_cast<std::uint16_t>(frameIndex), static_cast<std::int16_t>(blockIndex),
+                       static_cast<std::int8_t>(slot), source};
+        out.emplace_back(target, ref);
+    };
+
+    size_t frameCount = std::min(seq->frames.size(), kMaxHandleIndex);
+    for (size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        const auto& frame = seq->frames[frameIndex];
+        size_t ifCount = std::min<size_t>(frame.IF.size(), INT16_MAX);
+        for (size_t b = 0; b < ifCount; ++b) {
+            OccurrenceKind kind;
+            if (!classifyIf(frame.IF[b].type, kind)) {
+                continue;
+            }
+            const KindLayout& layout = kindLayout(kind);
+            if (!layout.jumpTargetSupportsPattern || !hasSlot(layout, OccurrenceField::JumpTarget)) {
+                continue;
+            }
+            int slot = layout.slots[static_cast<int>(OccurrenceField::JumpTarget)];
+            int raw = frame.IF[b].parameters[slot];
+            if (raw >= kPatternJumpOffset) {
+                add(raw - kPatternJumpOffset, frameIndex, static_cast<int>(b), slot, PatternRefSource::IfJump);
+            }
+        }
+        size_t efCount = std::min<size_t>(frame.EF.size(), INT16_MAX);
+        for (size_t b = 0; b < efCount; ++b) {
+            int target;
+            if (!efSpawnTarget(frame.EF[b], seqIndex, target)) {
+                continue;
+            }
+            add(target, frameIndex, static_cast<int>(b), kSpawnPatternSlot, PatternRefSource::EfSpawn);
+        }
+        if (frame.AF.aniType == 0) {
+            add(frame.AF.jump, frameIndex, -1, -1, PatternRefSource::FrameEnd);
+        }
+    }
+}
+
+void PatternXref::insertSequence(int seqIndex, const std::vector<std::pair<int, PatternRef>>& refs) {
+    auto& targets = m_targetsOf[seqIndex];
+    auto bySeq = [](int seq, const PatternRef& ref) { return seq < ref.seqIndex; };
+    for (const auto& entry : refs) {
+        auto& list = m_incoming[entry.first];
+        // After every earlier reference from this sequence and before any
+        // from a later one.
+        list.insert(std::upper_bound(list.begin(), list.end(), seqIndex, bySeq), entry.second);
+        targets.push_back(entry.first);
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+}
+
+const std::vector<PatternRef>& PatternXref::referencesTo(int pattern) const {
+    static const std::vector<PatternRef> kNone;
+    if (pattern < 0 || pattern >= static_cast<int>(m_incoming.size())) {
+        return kNone;
+    }
+    return m_incoming[pattern];
+}
+
+size_t PatternXref::referenceCount() const {
+    size_t count = 0;
+    for (const auto& list : m_incoming) {
+        count += list.size();
+    }
+    return count;
+}
+
+MemoryUsage PatternXref::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_incoming);
+    usage.add_vector(m_targetsOf);
+    for (const auto& list : m_incoming) {
+        usage.add_vector(list);
+    }
+    for (const auto& list : m_targetsOf) {
+        usage.add_vector(list);
+    }
+    return usage;
+}
+
+} // namespace varswap
@@ -0,0 +1,58 @@
+#ifndef VARSWAP_PATTERN_XREF_H_GUARD
+#define VARSWAP_PATTERN_XREF_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace varswap {
+
+enum class PatternRefSource : std::uint8_t {
+    IfJump,   // IF jump slot naming a pattern (kPatternJumpOffset + p)
+    EfSpawn,  // EF 1/11 spawn, or EF 101/111 relative spawn
+    FrameEnd  // AF.jump of a frame whose aniType is 0 (end)
+};
+
+// One place that names a pattern. blockIndex and slot are -1 for FrameEnd.
+struct PatternRef {
+    int seqIndex;
+    std::uint16_t frameIndex;
+    std::int16_t blockIndex;
+    std::int8_t slot;
+    PatternRefSource source;
+};
+
+const char* patternRefSourceLabel(PatternRefSource source);
+
+// EF 1/11 spawn the pattern in parameter 0; EF 101/111 name it relative to
+// the spawning pattern. False for any other effect.
+bool efSpawnTarget(const Frame_EF& effect, int seqIndex, int& target);
+
+// Reverse lookup from a pattern to everything that jumps to or spawns it.
+// References to one pattern are kept in (seq, frame, IF, EF, AF) order.
+// Edits are pushed in per sequence with updateSequence(), which costs the
+// references of that sequence rather than a rebuild.
+class PatternXref {
+public:
+    void build(const FrameData& data);
+    void updateSequence(const FrameData& data, int seqIndex);
+    void clear();
+
+    const std::vector<PatternRef>& referencesTo(int pattern) const;
+    size_t referenceCount() const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    void readSequence(const FrameData& data, int seqIndex, std::vector<std::pair<int, PatternRef>>& out) const;
+    void insertSequence(int seqIndex, const std::vector<std::pair<int, PatternRef>>& refs);
+
+    std::vector<std::vector<PatternRef>> m_incoming; // per target pattern
+    std::vector<std::vector<int>> m_targetsOf; // per source pattern, unique
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_PATTERN_XREF_H_GUARD */
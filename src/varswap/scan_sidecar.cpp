@@ -0,0 +1,249 @@
+#include "varswap/scan_sidecar.h"
+
+#include "varswap/occurrence_schema.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace varswap {
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'S', 'W', 'I'};
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t hashBytes(const void* bytes, size_t size, std::uint64_t hash) {
+    const auto* p = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ p[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+template <typename T>
+std::uint64_t hashValue(const T& value, std::uint64_t hash) {
+    return hashBytes(&value, sizeof(value), hash);
+}
+
+struct Header {
+    char magic[4];
+    std::uint32_t format;
+    std::uint64_t contentHash;
+    std::uint64_t schema;
+    std::uint32_t sequenceCount;
+    std::uint32_t reserved;
+    std::uint64_t occurrenceCount;
+    std::uint64_t labelBytes;
+};
+
+// On-disk occurrence; Occurrence itself carries a generation.
+struct Record {
+    std::int32_t seqIndex;
+    std::uint16_t frameIndex;
+    std::uint16_t blockIndex;
+    std::uint8_t kind;
+    std::uint8_t category;
+    std::uint16_t reserved;
+};
+
+static_assert(sizeof(Header) == 48, "sidecar header layout is part of the format");
+static_assert(sizeof(Record) == 12, "sidecar record layout is part of the format");
+
+size_t payloadBytes(size_t count, size_t labelBytes) {
+    return count * (sizeof(Record) + 2 * sizeof(int) + sizeof(std::uint64_t)) + labelBytes;
+}
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+const char* readArray(const char* in, std::vector<T>& values, size_t count) {
+    values.resize(count);
+    std::memcpy(values.data(), in, count * sizeof(T));
+    return in + count * sizeof(T);
+}
+
+} // namespace
+
+std::string scanSidecarPath(const std::string& documentPath) {
+    return documentPath + ".varswap-index";
+}
+
+bool hashFileContents(const std::vector<std::string>& paths, std::uint64_t& hash, std::string& error) {
+    hash = kFnvOffset;
+    std::vector<char> buffer(1 << 20);
+    for (const std::string& path : paths) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            error = "cannot open " + path;
+            return false;
+        }
+        while (in) {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            hash = hashBytes(buffer.data(), static_cast<size_t>(in.gcount()), hash);
+        }
+        if (in.bad()) {
+            error = "cannot read " + path;
+            return false;
+        }
+        // Keeps "ab" + "c" apart from "a" + "bc".
+        hash = hashValue(static_cast<std::uint64_t>(paths.size()), hash);
+    }
+    return true;
+}
+
+std::uint64_t activeSchemaFingerprint() {
+    std::uint64_t hash = kFnvOffset;
+    for (const KindDefinition& def : activeSchema().kinds()) {
+        hash = hashBytes(def.code.data(), def.code.size() + 1, hash);
+        hash = hashValue(static_cast<int>(def.layout.category), hash);
+        hash = hashValue(static_cast<int>(def.layout.encoding), hash);
+        hash = hashValue(def.layout.isEffect, hash);
+        hash = hashValue(def.layout.jumpTargetSupportsPattern, hash);
+        hash = hashBytes(def.layout.slots, sizeof(def.layout.slots), hash);
+        hash = hashValue(def.number, hash);
+        hash = hashValue(def.types.size(), hash);
+        hash = hashBytes(def.types.data(), def.types.size() * sizeof(int), hash);
+    }
+    return hash;
+}
+
+bool writeScanSidecar(const std::string& path, const ScanSidecar& sidecar, std::string& error) {
+    size_t count = sidecar.occurrences.size();
+    if (sidecar.vars.size() != count || sidecar.remainders.size() != count || sidecar.varKeys.size() != count) {
+        error = "scan columns do not match the occurrence count";
+        return false;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.format = kScanSidecarFormat;
+    header.contentHash = sidecar.contentHash;
+    header.schema = activeSchemaFingerprint();
+    int sequenceCount = 0;
+    for (const Occurrence& occ : sidecar.occurrences) {
+        sequenceCount = std::max(sequenceCount, occ.seqIndex + 1);
+    }
+    header.sequenceCount = static_cast<std::uint32_t>(sequenceCount);
+    header.occurrenceCount = count;
+    header.labelBytes = sidecar.labels.size();
+
+    std::vector<Record> records(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Occurrence& occ = sidecar.occurrences[i];
+        records[i] = {occ.seqIndex, occ.frameIndex, occ.blockIndex, static_cast<std::uint8_t>(occ.kind),
+                      static_cast<std::uint8_t>(occ.category), 0};
+    }
+
+    // Written aside and renamed into place, so a reader never sees half a
+    // sidecar.
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            error = "cannot write " + tempPath;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(out, records);
+        writeArray(out, sidecar.vars);
+        writeArray(out, sidecar.remainders);
+        writeArray(out, sidecar.varKeys);
+        out.write(sidecar.labels.data(), static_cast<std::streamsize>(sidecar.labels.size()));
+        if (!out) {
+            error = "cannot write " + tempPath;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        error = "cannot replace " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readScanSidecar(const std::string& path, std::uint64_t contentHash, const FrameData& data, ScanSidecar& sidecar,
+                     std::string& error) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        error = "no sidecar";
+        return false;
+    }
+    auto size = static_cast<size_t>(in.tellg());
+    Header header{};
+    if (size < sizeof(Header) || !in.seekg(0) || !in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        error = "truncated sidecar";
+        return false;
+    }
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.format != kScanSidecarFormat) {
+        error = "sidecar format changed";
+        return false;
+    }
+    if (header.contentHash != contentHash) {
+        error = "sidecar is for other content";
+        return false;
+    }
+    if (header.schema != activeSchemaFingerprint()) {
+        error = "sidecar was written with another schema";
+        return false;
+    }
+    int sequenceCount = data.get_sequence_count();
+    if (header.sequenceCount > static_cast<std::uint32_t>(sequenceCount) ||
+        size - sizeof(Header) != payloadBytes(header.occurrenceCount, header.labelBytes)) {
+        error = "sidecar does not fit the document";
+        return false;
+    }
+
+    // One read for the whole payload, then straight copies into the columns.
+    std::vector<char> payload(size - sizeof(Header));
+    if (!in.read(payload.data(), static_cast<std::streamsize>(payload.size()))) {
+        error = "truncated sidecar";
+        return false;
+    }
+    size_t count = header.occurrenceCount;
+    std::vector<Record> records;
+    const char* cursor = readArray(payload.data(), records, count);
+    cursor = readArray(cursor, sidecar.vars, count);
+    cursor = readArray(cursor, sidecar.remainders, count);
+    cursor = readArray(cursor, sidecar.varKeys, count);
+    sidecar.labels.assign(cursor, header.labelBytes);
+
+    sidecar.contentHash = contentHash;
+    sidecar.occurrences.resize(count);
+    size_t kindCount = activeSchema().kinds().size();
+    for (size_t i = 0; i < count; ++i) {
+        const Record& record = records[i];
+        const Sequence* seq = data.peek_sequence(record.seqIndex);
+        if (!seq || record.frameIndex >= seq->frames.size() || record.kind >= kindCount ||
+            record.category >= static_cast<std::uint8_t>(VarCategory::Count)) {
+            error = "sidecar does not fit the document";
+            return false;
+        }
+        Occurrence& occ = sidecar.occurrences[i];
+        occ = Occurrence{};
+        occ.seqIndex = record.seqIndex;
+        occ.frameIndex = record.frameIndex;
+        occ.blockIndex = record.blockIndex;
+        occ.generation = seq->generation;
+        occ.kind = static_cast<OccurrenceKind>(record.kind);
+        occ.category = static_cast<VarCategory>(record.category);
+        const auto& frame = seq->frames[occ.frameIndex];
+        size_t blockCount = occ.isEffect() ? frame.EF.size() : frame.IF.size();
+        if (occ.blockIndex >= blockCount) {
+            error = "sidecar does not fit the document";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace varswap
@@ -0,0 +1,48 @@
+#ifndef VARSWAP_SCAN_SIDECAR_H_GUARD
+#define VARSWAP_SCAN_SIDECAR_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace varswap {
+
+// Bumped whenever the sidecar layout or anything stored in it changes
+// meaning, so older sidecars are rescanned instead of misread.
+constexpr std::uint32_t kScanSidecarFormat = 1;
+
+// Scan results saved next to an HA6 file (or .txt bundle), so reopening the
+// same content skips collectOccurrences, value decoding, the var index and
+// label building. A sidecar is only used when the content hash, the
+// installed schema and the format all match.
+struct ScanSidecar {
+    std::uint64_t contentHash = 0;
+    // Generations are not stored; reading stamps the live ones.
+    std::vector<Occurrence> occurrences;
+    std::vector<int> vars;
+    std::vector<int> remainders;
+    std::vector<std::uint64_t> varKeys; // VarIndex key per occurrence
+    // Pattern label, node label and lowercase search text of every
+    // occurrence, each NUL-terminated. Empty when the writer had no labels.
+    std::string labels;
+};
+
+std::string scanSidecarPath(const std::string& documentPath);
+
+// FNV-1a over the bytes of every file, in order.
+bool hashFileContents(const std::vector<std::string>& paths, std::uint64_t& hash, std::string& error);
+// Fingerprint of the installed schema's kinds, layouts and block mappings.
+std::uint64_t activeSchemaFingerprint();
+
+bool writeScanSidecar(const std::string& path, const ScanSidecar& sidecar, std::string& error);
+// False when the file is missing or unreadable, was written for other
+// content, schema or format, or does not fit `data`.
+bool readScanSidecar(const std::string& path, std::uint64_t contentHash, const FrameData& data, ScanSidecar& sidecar,
+                     std::string& error);
+
+} // namespace varswap
+
+#endif /* VARSWAP_SCAN_SIDECAR_H_GUARD */
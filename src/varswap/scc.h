@@ -0,0 +1,88 @@
+#ifndef VARSWAP_SCC_H_GUARD
+#define VARSWAP_SCC_H_GUARD
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace varswap {
+
+// Strongly connected components of a pattern graph. Ids are assigned sinks
+// first: every edge leaving a component points at a smaller id, so filling
+// per-component data in id order sees each target's result finished.
+struct StrongComponents {
+    std::vector<int> component;   // node -> component id
+    std::vector<int> members;     // nodes grouped by id, ascending within a group
+    std::vector<int> memberStart; // count() + 1 offsets into members
+
+    int count() const { return static_cast<int>(memberStart.size()) - 1; }
+};
+
+// Tarjan's SCC pass, iterative so deep jump chains cannot overflow the call
+// stack. `edges[node]` is any indexable list; `targetOf(edge)` maps one entry
+// to the node it points at.
+template <typename EdgeLists, typename TargetOf>
+void findStrongComponents(int nodeCount, const EdgeLists& edges, TargetOf targetOf, StrongComponents& out) {
+    std::vector<int> index(nodeCount, -1);
+    std::vector<int> low(nodeCount, 0);
+    std::vector<char> onStack(nodeCount, 0);
+    std::vector<int> stack;
+    std::vector<std::pair<int, size_t>> frames; // (node, next edge)
+    int counter = 0;
+
+    out.component.assign(nodeCount, -1);
+    out.members.clear();
+    out.members.reserve(nodeCount);
+    out.memberStart.assign(1, 0);
+    for (int root = 0; root < nodeCount; ++root) {
+        if (index[root] >= 0) {
+            continue;
+        }
+        frames.emplace_back(root, 0);
+        while (!frames.empty()) {
+            int node = frames.back().first;
+            size_t& next = frames.back().second;
+            if (next == 0 && index[node] < 0) {
+                index[node] = low[node] = counter++;
+                stack.push_back(node);
+                onStack[node] = 1;
+            }
+            const auto& list = edges[node];
+            if (next < list.size()) {
+                int to = targetOf(list[next++]);
+                if (index[to] < 0) {
+                    frames.emplace_back(to, 0);
+                } else if (onStack[to]) {
+                    low[node] = std::min(low[node], index[to]);
+                }
+                continue;
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                int parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[node]);
+            }
+            if (low[node] != index[node]) {
+                continue;
+            }
+
+            int id = out.count();
+            size_t start = out.members.size();
+            int member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = 0;
+                out.component[member] = id;
+                out.members.push_back(member);
+            } while (member != node);
+            std::sort(out.members.begin() + start, out.members.end());
+            out.memberStart.push_back(static_cast<int>(out.members.size()));
+        }
+    }
+}
+
+} // namespace varswap
+
+#endif /* VARSWAP_SCC_H_GUARD */
@@ -0,0 +1,365 @@
+#include "varswap/spawn_tree.h"
+
+#include "varswap/pattern_xref.h"
+#include "varswap/scc.h"
+#include "varswap/var_decode.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+namespace varswap {
+
+namespace {
+
+int saturate(long long value) {
+    return static_cast<int>(std::max<long long>(INT_MIN, std::min<long long>(INT_MAX, value)));
+}
+
+// Sorts by register and folds duplicates. Zero nets are dropped unless a
+// spawn cycle makes them unbounded.
+void normalize(std::vector<RegisterDelta>& deltas) {
+    std::sort(deltas.begin(), deltas.end(),
+              [](const RegisterDelta& lhs, const RegisterDelta& rhs) { return lhs.var < rhs.var; });
+    size_t out = 0;
+    for (size_t i = 0; i < deltas.size();) {
+        RegisterDelta merged = deltas[i];
+        long long sum = merged.delta;
+        for (++i; i < deltas.size() && deltas[i].var == merged.var; ++i) {
+            sum += deltas[i].delta;
+            merged.unbounded = merged.unbounded || deltas[i].unbounded;
+        }
+        merged.delta = saturate(sum);
+        if (merged.delta != 0 || merged.unbounded) {
+            deltas[out++] = merged;
+        }
+    }
+    deltas.resize(out);
+}
+
+const RegisterDelta* findDelta(const std::vector<RegisterDelta>& deltas, int var) {
+    auto it = std::lower_bound(deltas.begin(), deltas.end(), var,
+                               [](const RegisterDelta& entry, int v) { return entry.var < v; });
+    return (it != deltas.end() && it->var == var) ? &*it : nullptr;
+}
+
+} // namespace
+
+void SpawnTree::clear() {
+    m_patternCount = 0;
+    m_targets.clear();
+    m_parents.clear();
+    m_own.clear();
+    m_component.clear();
+    m_memberStart.clear();
+    m_members.clear();
+    m_cyclic.clear();
+    m_subtree.clear();
+    m_subtreeValid.clear();
+    m_componentsDirty = true;
+}
+
+void SpawnTree::resize(int patternCount) {
+    clear();
+    m_patternCount = patternCount;
+    m_targets.resize(patternCount);
+    m_parents.resize(patternCount);
+    m_own.resize(patternCount);
+}
+
+void SpawnTree::build(const FrameData& data) {
+    resize(data.get_sequence_count());
+    std::vector<std::pair<int, int>> targets;
+    for (int seqIndex = 0; seqIndex < m_patternCount; ++seqIndex) {
+        readSequence(data, seqIndex, targets, m_own[seqIndex]);
+        m_targets[seqIndex] = targets;
+        for (const auto& edge : targets) {
+            // Sources arrive in order, so the parent lists stay sorted.
+            m_parents[edge.first].push_back(seqIndex);
+        }
+    }
+}
+
+void SpawnTree::updateSequence(const FrameData& data, int seqIndex) {
+    if (m_patternCount != data.get_sequence_count()) {
+        build(data);
+        return;
+    }
+    if (seqIndex < 0 || seqIndex >= m_patternCount) {
+        return;
+    }
+    std::vector<std::pair<int, int>> targets;
+    std::vector<RegisterDelta> own;
+    readSequence(data, seqIndex, targets, own);
+    if (targets != m_targets[seqIndex]) {
+        setTargets(seqIndex, targets);
+        m_componentsDirty = true;
+    } else {
+        invalidateAbove(seqIndex);
+    }
+    m_own[seqIndex] = std::move(own);
+}
+
+void SpawnTree::readSequence(const FrameData& data, int seqIndex, std::vector<std::pair<int, int>>& targets,
+                             std::vector<RegisterDelta>& own) const {
+    targets.clear();
+    own.clear();
+    const Sequence* seq = data.peek_sequence(seqIndex);
+    if (!seq) {
+        return;
+    }
+    for (const auto& frame : seq->frames) {
+        for (const auto& effect : frame.EF) {
+            int target;
+            if (efSpawnTarget(effect, seqIndex, target)) {
+                if (target >= 0 && target < m_patternCount) {
+                    targets.emplace_back(target, 1);
+                }
+                continue;
+            }
+            OccurrenceKind kind;
+            if (!classifyEf(effect.type, effect.number, kind) ||
+                (kind != OccurrenceKind::EfType6No100 && kind != OccurrenceKind::EfType6No101)) {
+                continue;
+            }
+            const KindLayout& layout = kindLayout(kind);
+            if (layout.encoding != ValueEncoding::ProjectileComposite) {
+                continue;
+            }
+            // Same test as isGlobalProjectileOp.
+            int raw = effect.parameters[layout.slots[static_cast<int>(OccurrenceField::Value)]];
+            if (std::abs(raw) < 100) {
+                continue;
+            }
+            int var;
+            int delta;
+            decodeRawValues(layout.encoding, &raw, 1, &var, &delta);
+            own.push_back({var, kind == OccurrenceKind::EfType6No101 ? -delta : delta, false});
+        }
+    }
+
+    std::sort(targets.begin(), targets.end());
+    size_t out = 0;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (out > 0 && targets[out - 1].first == targets[i].first) {
+            ++targets[out - 1].second;
+        } else {
+            targets[out++] = targets[i];
+        }
+    }
+    targets.resize(out);
+    normalize(own);
+}
+
+void SpawnTree::setTargets(int seqIndex, std::vector<std::pair<int, int>>& targets) {
+    for (const auto& edge : m_targets[seqIndex]) {
+        auto& parents = m_parents[edge.first];
+        auto it = std::lower_bound(parents.begin(), parents.end(), seqIndex);
+        if (it != parents.end() && *it == seqIndex) {
+            parents.erase(it);
+        }
+    }
+    for (const auto& edge : targets) {
+        auto& parents = m_parents[edge.first];
+        parents.insert(std::lower_bound(parents.begin(), parents.end(), seqIndex), seqIndex);
+    }
+    m_targets[seqIndex].swap(targets);
+}
+
+void SpawnTree::invalidateAbove(int seqIndex) {
+    if (m_componentsDirty) {
+        return;
+    }
+    std::vector<char> seen(m_patternCount, 0);
+    std::vector<int> queue(1, seqIndex);
+    seen[seqIndex] = 1;
+    while (!queue.empty()) {
+        int node = queue.back();
+        queue.pop_back();
+        m_subtreeValid[m_component[node]] = 0;
+        for (int parent : m_parents[node]) {
+            if (!seen[parent]) {
+                seen[parent] = 1;
+                queue.push_back(parent);
+            }
+        }
+    }
+}
+
+void SpawnTree::computeComponents() {
+    // Components come out sinks first, which is the order the subtree sums
+    // are filled in.
+    StrongComponents scc;
+    findStrongComponents(m_patternCount, m_targets, [](const std::pair<int, int>& edge) { return edge.first; },
+                         scc);
+    m_component = std::move(scc.component);
+    m_members = std::move(scc.members);
+    m_memberStart = std::move(scc.memberStart);
+
+    m_cyclic.assign(static_cast<size_t>(m_memberStart.size() - 1), 0);
+    for (size_t id = 0; id < m_cyclic.size(); ++id) {
+        bool cyclic = m_memberStart[id + 1] - m_memberStart[id] > 1;
+        if (!cyclic) {
+            int node = m_members[m_memberStart[id]];
+            const auto& self = m_targets[node];
+            cyclic = std::binary_search(self.begin(), self.end(), std::make_pair(node, 0),
+                                        [](const std::pair<int, int>& lhs, const std::pair<int, int>& rhs) {
+                                            return lhs.first < rhs.first;
+                                        });
+        }
+        m_cyclic[id] = cyclic ? 1 : 0;
+    }
+
+    m_subtree.assign(m_cyclic.size(), {});
+    m_subtreeValid.assign(m_cyclic.size(), 0);
+    m_componentsDirty = false;
+}
+
+void SpawnTree::computeDeltas() {
+    if (m_componentsDirty) {
+        computeComponents();
+    }
+    std::vector<RegisterDelta> sum;
+    for (size_t c = 0; c < m_cyclic.size(); ++c) {
+        if (m_subtreeValid[c]) {
+            continue;
+        }
+        sum.clear();
+        for (int m = m_memberStart[c]; m < m_memberStart[c + 1]; ++m) {
+            int member = m_members[m];
+            sum.insert(sum.end(), m_own[member].begin(), m_own[member].end());
+            for (const auto& edge : m_targets[member]) {
+                int child = m_component[edge.first];
+                if (child == static_cast<int>(c)) {
+                    continue;
+                }
+                for (RegisterDelta entry : m_subtree[child]) {
+                    entry.delta = saturate(static_cast<long long>(entry.delta) * edge.second);
+                    sum.push_back(entry);
+                }
+            }
+        }
+        normalize(sum);
+        if (m_cyclic[c]) {
+            for (auto& entry : sum) {
+                entry.unbounded = true;
+            }
+        }
+        m_subtree[c] = sum;
+        m_subtreeValid[c] = 1;
+    }
+}
+
+const std::vector<std::pair<int, int>>& SpawnTree::spawnTargets(int seqIndex) const {
+    static const std::vector<std::pair<int, int>> kNone;
+    return (seqIndex >= 0 && seqIndex < m_patternCount) ? m_targets[seqIndex] : kNone;
+}
+
+const std::vector<int>& SpawnTree::spawnedBy(int seqIndex) const {
+    static const std::vector<int> kNone;
+    return (seqIndex >= 0 && seqIndex < m_patternCount) ? m_parents[seqIndex] : kNone;
+}
+
+const std::vector<RegisterDelta>& SpawnTree::ownDelta(int seqIndex) const {
+    static const std::vector<RegisterDelta> kNone;
+    return (seqIndex >= 0 && seqIndex < m_patternCount) ? m_own[seqIndex] : kNone;
+}
+
+const std::vector<RegisterDelta>& SpawnTree::subtreeDelta(int seqIndex) {
+    static const std::vector<RegisterDelta> kNone;
+    if (seqIndex < 0 || seqIndex >= m_patternCount) {
+        return kNone;
+    }
+    computeDeltas();
+    return m_subtree[m_component[seqIndex]];
+}
+
+std::vector<SpawnImbalance> SpawnTree::imbalances() {
+    computeDeltas();
+    std::vector<SpawnImbalance> result;
+    for (size_t c = 0; c < m_cyclic.size(); ++c) {
+        if (m_subtree[c].empty()) {
+            continue;
+        }
+        bool spawnedFromOutside = false;
+        for (int m = m_memberStart[c]; m < m_memberStart[c + 1] && !spawnedFromOutside; ++m) {
+            for (int parent : m_parents[m_members[m]]) {
+                if (m_component[parent] != static_cast<int>(c)) {
+                    spawnedFromOutside = true;
+                    break;
+                }
+            }
+        }
+        if (spawnedFromOutside) {
+            continue;
+        }
+        int root = m_members[m_memberStart[c]];
+        for (const auto& entry : m_subtree[c]) {
+            result.push_back({root, entry.var, entry.delta, entry.unbounded});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const SpawnImbalance& lhs, const SpawnImbalance& rhs) {
+        return lhs.root != rhs.root ? lhs.root < rhs.root : lhs.var < rhs.var;
+    });
+    return result;
+}
+
+std::vector<int> SpawnTree::imbalancePath(int root, int var) {
+    std::vector<int> path;
+    if (root < 0 || root >= m_patternCount) {
+        return path;
+    }
+    computeDeltas();
+    std::vector<char> seen(m_patternCount, 0);
+    int node = root;
+    while (node >= 0) {
+        path.push_back(node);
+        seen[node] = 1;
+        // Leave the current spawn cycle as soon as a child below it carries
+        // the imbalance; only walk around the cycle when nothing below does
+        // and this pattern does not change the register itself.
+        int next = -1;
+        int sibling = -1;
+        for (const auto& edge : m_targets[node]) {
+            if (seen[edge.first] || !findDelta(m_subtree[m_component[edge.first]], var)) {
+                continue;
+            }
+            if (m_component[edge.first] != m_component[node]) {
+                next = edge.first;
+                break;
+            }
+            if (sibling < 0) {
+                sibling = edge.first;
+            }
+        }
+        if (next < 0 && !findDelta(m_own[node], var)) {
+            next = sibling;
+        }
+        node = next;
+    }
+    return path;
+}
+
+MemoryUsage SpawnTree::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_targets);
+    usage.add_vector(m_parents);
+    usage.add_vector(m_own);
+    usage.add_vector(m_component);
+    usage.add_vector(m_memberStart);
+    usage.add_vector(m_members);
+    usage.add_vector(m_cyclic);
+    usage.add_vector(m_subtree);
+    usage.add_vector(m_subtreeValid);
+    for (int p = 0; p < m_patternCount; ++p) {
+        usage.add_vector(m_targets[p]);
+        usage.add_vector(m_parents[p]);
+        usage.add_vector(m_own[p]);
+    }
+    for (const auto& deltas : m_subtree) {
+        usage.add_vector(deltas);
+    }
+    return usage;
+}
+
+} // namespace varswap
@@ -0,0 +1,82 @@
+#ifndef VARSWAP_SPAWN_TREE_H_GUARD
+#define VARSWAP_SPAWN_TREE_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace varswap {
+
+// Net change to one global projectile register. `unbounded` marks a delta
+// that a spawn cycle can repeat without limit; `delta` then holds one turn.
+struct RegisterDelta {
+    int var;
+    int delta;
+    bool unbounded;
+};
+
+// A spawn tree whose register changes do not cancel out.
+struct SpawnImbalance {
+    int root;
+    int var;
+    int net;
+    bool unbounded;
+};
+
+// Spawn graph over patterns: p -> q when p spawns q through EF 1/11/101/111,
+// counted once per spawning effect. Each pattern's own EF6 #100/#101 global
+// register changes are summed per register, and the net over its whole spawn
+// subtree is memoized per strongly connected component. A changed pattern
+// only invalidates the memo of its component and the components above it,
+// unless its spawn targets changed, which redoes the component pass.
+class SpawnTree {
+public:
+    void build(const FrameData& data);
+    void updateSequence(const FrameData& data, int seqIndex);
+    void clear();
+
+    // (target, spawn count) pairs, by target.
+    const std::vector<std::pair<int, int>>& spawnTargets(int seqIndex) const;
+    const std::vector<int>& spawnedBy(int seqIndex) const;
+    // Sorted by register, zero nets dropped.
+    const std::vector<RegisterDelta>& ownDelta(int seqIndex) const;
+    const std::vector<RegisterDelta>& subtreeDelta(int seqIndex);
+
+    // Nonzero subtree nets of the patterns nothing spawns, and of the
+    // lowest pattern of each spawn cycle nothing outside it spawns.
+    std::vector<SpawnImbalance> imbalances();
+    // Spawn chain from `root` down to the pattern whose own change leaves
+    // `var` unbalanced, following children with a nonzero subtree net.
+    std::vector<int> imbalancePath(int root, int var);
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    void resize(int patternCount);
+    void readSequence(const FrameData& data, int seqIndex, std::vector<std::pair<int, int>>& targets,
+                      std::vector<RegisterDelta>& own) const;
+    void setTargets(int seqIndex, std::vector<std::pair<int, int>>& targets);
+    void computeComponents();
+    void computeDeltas();
+    void invalidateAbove(int seqIndex);
+
+    int m_patternCount = 0;
+    std::vector<std::vector<std::pair<int, int>>> m_targets;
+    std::vector<std::vector<int>> m_parents; // sorted, unique
+    std::vector<std::vector<RegisterDelta>> m_own;
+
+    // Valid while !m_componentsDirty. Components are numbered sinks first.
+    std::vector<int> m_component;
+    std::vector<int> m_memberStart; // component c owns m_members[start[c], start[c + 1])
+    std::vector<int> m_members;
+    std::vector<char> m_cyclic;
+    std::vector<std::vector<RegisterDelta>> m_subtree; // per component
+    std::vector<char> m_subtreeValid;
+    bool m_componentsDirty = true;
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_SPAWN_TREE_H_GUARD */
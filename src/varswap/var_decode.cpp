@@ -0,0 +1,213 @@
+#include "varswap/var_decode.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VARSWAP_VAR_DECODE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define VARSWAP_VAR_DECODE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace varswap {
+
+namespace {
+
+// Unsigned reciprocals: x / 10 == (x * 0xCCCCCCCD) >> 35 and
+// x / 100 == (x * 0x51EB851F) >> 37 for every 32-bit x. Signed values are
+// divided as |x| and the sign put back, which truncates like std::div.
+constexpr unsigned kMagic10 = 0xCCCCCCCDu;
+constexpr int kShift10 = 35;
+constexpr unsigned kMagic100 = 0x51EB851Fu;
+constexpr int kShift100 = 37;
+
+void decodeScalar(ValueEncoding encoding, int raw, int& var, int& remainder) {
+    switch (encoding) {
+        case ValueEncoding::Direct:
+            var = raw;
+            remainder = 0;
+            return;
+        case ValueEncoding::TensComposite:
+            var = raw / 10;
+            remainder = raw % 10;
+            return;
+        case ValueEncoding::HundredsComposite:
+            var = raw / 100;
+            remainder = raw % 100;
+            return;
+        case ValueEncoding::ProjectileComposite:
+        default: {
+            int base = (raw >= 100 || raw <= -100) ? 100 : 10;
+            var = raw / base;
+            remainder = raw % base;
+            if (remainder < 0) {
+                remainder += base;
+            }
+            return;
+        }
+    }
+}
+
+#ifdef VARSWAP_VAR_DECODE_SSE2
+
+__m128i divSigned(__m128i x, unsigned magic, int shift) {
+    const __m128i m = _mm_set1_epi32(static_cast<int>(magic));
+    const __m128i lowLanes = _mm_set_epi32(0, -1, 0, -1);
+    __m128i sign = _mm_srai_epi32(x, 31);
+    __m128i ax = _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(ax, m), shift);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(ax, 32), m), shift);
+    __m128i q = _mm_or_si128(_mm_and_si128(even, lowLanes), _mm_slli_epi64(odd, 32));
+    return _mm_sub_epi32(_mm_xor_si128(q, sign), sign);
+}
+
+__m128i times10(__m128i q) {
+    return _mm_add_epi32(_mm_slli_epi32(q, 3), _mm_slli_epi32(q, 1));
+}
+
+__m128i times100(__m128i q) {
+    return _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(q, 6), _mm_slli_epi32(q, 5)), _mm_slli_epi32(q, 2));
+}
+
+__m128i select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void decode4(ValueEncoding encoding, __m128i x, __m128i& var, __m128i& remainder) {
+    if (encoding == ValueEncoding::TensComposite) {
+        var = divSigned(x, kMagic10, kShift10);
+        remainder = _mm_sub_epi32(x, times10(var));
+        return;
+    }
+    if (encoding == ValueEncoding::HundredsComposite) {
+        var = divSigned(x, kMagic100, kShift100);
+        remainder = _mm_sub_epi32(x, times100(var));
+        return;
+    }
+    __m128i global = _mm_or_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(99)), _mm_cmplt_epi32(x, _mm_set1_epi32(-99)));
+    __m128i q10 = divSigned(x, kMagic10, kShift10);
+    __m128i q100 = divSigned(x, kMagic100, kShift100);
+    var = select(global, q100, q10);
+    __m128i base = select(global, _mm_set1_epi32(100), _mm_set1_epi32(10));
+    remainder = _mm_sub_epi32(x, select(global, times100(q100), times10(q10)));
+    __m128i negative = _mm_srai_epi32(remainder, 31);
+    remainder = _mm_add_epi32(remainder, _mm_and_si128(negative, base));
+}
+
+#endif
+
+#ifdef VARSWAP_VAR_DECODE_AVX2
+
+__m256i divSigned8(__m256i x, unsigned magic, int shift) {
+    const __m256i m = _mm256_set1_epi32(static_cast<int>(magic));
+    const __m256i lowLanes = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    __m256i sign = _mm256_srai_epi32(x, 31);
+    __m256i ax = _mm256_abs_epi32(x);
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(ax, m), shift);
+    __m256i odd = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(ax, 32), m), shift);
+    __m256i q = _mm256_or_si256(_mm256_and_si256(even, lowLanes), _mm256_slli_epi64(odd, 32));
+    return _mm256_sub_epi32(_mm256_xor_si256(q, sign), sign);
+}
+
+void decode8(ValueEncoding encoding, __m256i x, __m256i& var, __m256i& remainder) {
+    const __m256i ten = _mm256_set1_epi32(10);
+    const __m256i hundred = _mm256_set1_epi32(100);
+    if (encoding == ValueEncoding::TensComposite) {
+        var = divSigned8(x, kMagic10, kShift10);
+        remainder = _mm256_sub_epi32(x, _mm256_mullo_epi32(var, ten));
+        return;
+    }
+    if (encoding == ValueEncoding::HundredsComposite) {
+        var = divSigned8(x, kMagic100, kShift100);
+        remainder = _mm256_sub_epi32(x, _mm256_mullo_epi32(var, hundred));
+        return;
+    }
+    __m256i global = _mm256_or_si256(_mm256_cmpgt_epi32(x, _mm256_set1_epi32(99)),
+                                     _mm256_cmpgt_epi32(_mm256_set1_epi32(-99), x));
+    __m256i base = _mm256_blendv_epi8(ten, hundred, global);
+    var = _mm256_blendv_epi8(divSigned8(x, kMagic10, kShift10), divSigned8(x, kMagic100, kShift100), global);
+    remainder = _mm256_sub_epi32(x, _mm256_mullo_epi32(var, base));
+    remainder = _mm256_add_epi32(remainder, _mm256_and_si256(_mm256_srai_epi32(remainder, 31), base));
+}
+
+#endif
+
+// Rows per gather pass in decodeOccurrenceValues; keeps the staging
+// buffers on the stack.
+constexpr size_t kDecodeChunk = 256;
+constexpr int kEncodingCount = static_cast<int>(ValueEncoding::ProjectileComposite) + 1;
+
+} // namespace
+
+void decodeRawValues(ValueEncoding encoding, const int* raw, size_t count, int* vars, int* remainders) {
+    if (encoding == ValueEncoding::Direct) {
+        std::memmove(vars, raw, count * sizeof(int));
+        std::fill(remainders, remainders + count, 0);
+        return;
+    }
+    size_t i = 0;
+#ifdef VARSWAP_VAR_DECODE_AVX2
+    for (; i + 8 <= count; i += 8) {
+        __m256i var;
+        __m256i remainder;
+        decode8(encoding, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i)), var, remainder);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(vars + i), var);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(remainders + i), remainder);
+    }
+#endif
+#ifdef VARSWAP_VAR_DECODE_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128i var;
+        __m128i remainder;
+        decode4(encoding, _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i)), var, remainder);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(vars + i), var);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(remainders + i), remainder);
+    }
+#endif
+    for (; i < count; ++i) {
+        decodeScalar(encoding, raw[i], vars[i], remainders[i]);
+    }
+}
+
+void decodeOccurrenceValues(const FrameData& data, const Occurrence* occurrences, size_t count, int* vars,
+                            int* remainders) {
+    // Raw values are gathered per encoding, decoded as one run each, then
+    // scattered back to their rows.
+    int raw[kEncodingCount][kDecodeChunk];
+    std::uint32_t rows[kEncodingCount][kDecodeChunk];
+    int decodedVars[kDecodeChunk];
+    int decodedRemainders[kDecodeChunk];
+    for (size_t base = 0; base < count; base += kDecodeChunk) {
+        size_t end = std::min(count, base + kDecodeChunk);
+        size_t filled[kEncodingCount] = {};
+        for (size_t i = base; i < end; ++i) {
+            const int* value = resolveField(data, occurrences[i], OccurrenceField::Value);
+            if (!value) {
+                vars[i] = 0;
+                remainders[i] = 0;
+                continue;
+            }
+            int encoding = static_cast<int>(occurrences[i].encoding());
+            size_t slot = filled[encoding]++;
+            raw[encoding][slot] = *value;
+            rows[encoding][slot] = static_cast<std::uint32_t>(i);
+        }
+        for (int encoding = 0; encoding < kEncodingCount; ++encoding) {
+            size_t n = filled[encoding];
+            if (n == 0) {
+                continue;
+            }
+            decodeRawValues(static_cast<ValueEncoding>(encoding), raw[encoding], n, decodedVars, decodedRemainders);
+            for (size_t k = 0; k < n; ++k) {
+                vars[rows[encoding][k]] = decodedVars[k];
+                remainders[rows[encoding][k]] = decodedRemainders[k];
+            }
+        }
+    }
+}
+
+} // namespace varswap
@@ -0,0 +1,27 @@
+#ifndef VARSWAP_VAR_DECODE_H_GUARD
+#define VARSWAP_VAR_DECODE_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstddef>
+
+namespace varswap {
+
+// Batch form of the value decoders behind currentVar and compositeRemainder:
+// splits `count` raw values that share one encoding into var ids and
+// remainders, with the same results as the scalar std::div rules, including
+// the projectile base-100/base-10 switch and its non-negative delta. Uses
+// AVX2 or SSE2 when the build targets them. `vars` and `remainders` must each
+// hold `count` ints.
+void decodeRawValues(ValueEncoding encoding, const int* raw, size_t count, int* vars, int* remainders);
+
+// Decodes the Value field of `count` occurrences into parallel columns.
+// Rows whose field does not resolve get 0 for both, like currentVar and
+// compositeRemainder.
+void decodeOccurrenceValues(const FrameData& data, const Occurrence* occurrences, size_t count, int* vars,
+                            int* remainders);
+
+} // namespace varswap
+
+#endif /* VARSWAP_VAR_DECODE_H_GUARD */
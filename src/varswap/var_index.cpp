@@ -0,0 +1,95 @@
+#include "varswap/var_index.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace varswap {
+
+std::uint64_t VarIndex::keyFor(const FrameData& data, const Occurrence& occ) {
+    return packKey(occ.category, currentVar(data, occ), isGlobalProjectileOp(data, occ));
+}
+
+void VarIndex::build(const FrameData& data, const std::vector<Occurrence>& occurrences) {
+    clear();
+    m_keys.resize(occurrences.size());
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        std::uint64_t key = keyFor(data, occurrences[i]);
+        m_keys[i] = key;
+        // Ids arrive in increasing order, so every list stays sorted.
+        m_lists[key].push_back(static_cast<std::uint32_t>(i));
+    }
+}
+
+void VarIndex::assign(std::vector<std::uint64_t> keys) {
+    clear();
+    m_keys = std::move(keys);
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        m_lists[m_keys[i]].push_back(static_cast<std::uint32_t>(i));
+    }
+}
+
+void VarIndex::clear() {
+    m_lists.clear();
+    m_keys.clear();
+}
+
+void VarIndex::update(const FrameData& data, const std::vector<Occurrence>& occurrences, std::uint32_t id) {
+    if (id >= m_keys.size() || id >= occurrences.size()) {
+        return;
+    }
+    std::uint64_t key = keyFor(data, occurrences[id]);
+    std::uint64_t oldKey = m_keys[id];
+    if (key == oldKey) {
+        return;
+    }
+
+    auto oldList = m_lists.find(oldKey);
+    if (oldList != m_lists.end()) {
+        auto& ids = oldList->second;
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it != ids.end() && *it == id) {
+            ids.erase(it);
+        }
+        if (ids.empty()) {
+            m_lists.erase(oldList);
+        }
+    }
+
+    auto& ids = m_lists[key];
+    ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+    m_keys[id] = key;
+}
+
+const std::vector<std::uint32_t>& VarIndex::find(VarCategory category, int varId, bool global) const {
+    static const std::vector<std::uint32_t> kEmpty;
+    auto it = m_lists.find(packKey(category, varId, global));
+    return it != m_lists.end() ? it->second : kEmpty;
+}
+
+std::vector<std::uint32_t> VarIndex::findVar(int varId) const {
+    std::vector<std::uint32_t> result;
+    for (int category = 0; category < static_cast<int>(VarCategory::Count); ++category) {
+        for (bool global : {false, true}) {
+            const auto& ids = find(static_cast<VarCategory>(category), varId, global);
+            if (ids.empty()) {
+                continue;
+            }
+            size_t middle = result.size();
+            result.insert(result.end(), ids.begin(), ids.end());
+            std::inplace_merge(result.begin(), result.begin() + middle, result.end());
+        }
+    }
+    return result;
+}
+
+MemoryUsage VarIndex::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_keys);
+    usage.add_unordered_map(m_lists);
+    for (const auto& entry : m_lists) {
+        usage.add_vector(entry.second);
+    }
+    return usage;
+}
+
+} // namespace varswap
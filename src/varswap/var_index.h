@@ -0,0 +1,59 @@
+#ifndef VARSWAP_VAR_INDEX_H_GUARD
+#define VARSWAP_VAR_INDEX_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace varswap {
+
+// Inverted index from (category, var id, global flag) to the ids of the
+// occurrences using that var, where an id is the position in the occurrence
+// vector the index was built from. Id lists are kept sorted, so lookups
+// return occurrences in scan order. Built once per scan; value edits are
+// pushed in with update() instead of rebuilding.
+class VarIndex {
+public:
+    void build(const FrameData& data, const std::vector<Occurrence>& occurrences);
+    // Rebuilds from previously saved keys() without decoding any block.
+    void assign(std::vector<std::uint64_t> keys);
+    void clear();
+    bool empty() const { return m_keys.empty(); }
+
+    // Re-files one occurrence after its value changed. Costs the size of the
+    // old and new id lists, not the whole index.
+    void update(const FrameData& data, const std::vector<Occurrence>& occurrences, std::uint32_t id);
+
+    // Occurrences with exactly this key; empty if none.
+    const std::vector<std::uint32_t>& find(VarCategory category, int varId, bool global) const;
+    // Every occurrence whose current var is `varId`, whatever its category.
+    std::vector<std::uint32_t> findVar(int varId) const;
+    // Whether `id` was filed under this key.
+    bool matches(std::uint32_t id, VarCategory category, int varId, bool global) const {
+        return id < m_keys.size() && m_keys[id] == packKey(category, varId, global);
+    }
+
+    // Key per occurrence id, in the form assign() takes back.
+    const std::vector<std::uint64_t>& keys() const { return m_keys; }
+    // Whether a key was filed as a global projectile register.
+    static bool isGlobalKey(std::uint64_t key) { return (key >> 32) & 1; }
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    static std::uint64_t packKey(VarCategory category, int varId, bool global) {
+        return (static_cast<std::uint64_t>(category) << 33) | (static_cast<std::uint64_t>(global ? 1 : 0) << 32) |
+               static_cast<std::uint32_t>(varId);
+    }
+    static std::uint64_t keyFor(const FrameData& data, const Occurrence& occ);
+
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> m_lists;
+    std::vector<std::uint64_t> m_keys; // current key per occurrence id
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_VAR_INDEX_H_GUARD */
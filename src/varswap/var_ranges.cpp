@@ -0,0 +1,782 @@
+#include "varswap/var_ranges.h"
+
+#include "varswap/pattern_xref.h"
+#include "varswap/var_decode.h"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <tuple>
+
+namespace varswap {
+
+namespace {
+
+// Joins at one frame or pattern before its bounds start widening.
+constexpr int kWidenAfter = 3;
+
+constexpr int kCompareGreater = 0;
+constexpr int kCompareLess = 1;
+constexpr int kCompareEqual = 2;
+
+constexpr int kChangeSet = 0;
+constexpr int kChangeAdd = 1;
+// IF38 modes 10/11 change the owner's var, not this object's.
+constexpr int kChangeOwnerSet = 10;
+constexpr int kChangeOwnerAdd = 11;
+
+int addLow(int lhs, int rhs) {
+    if (lhs == INT_MIN || rhs == INT_MIN) {
+        return INT_MIN;
+    }
+    long long sum = static_cast<long long>(lhs) + rhs;
+    return static_cast<int>(std::max<long long>(INT_MIN, std::min<long long>(INT_MAX, sum)));
+}
+
+int addHigh(int lhs, int rhs) {
+    if (lhs == INT_MAX || rhs == INT_MAX) {
+        return INT_MAX;
+    }
+    long long sum = static_cast<long long>(lhs) + rhs;
+    return static_cast<int>(std::max<long long>(INT_MIN, std::min<long long>(INT_MAX, sum)));
+}
+
+ValueRange addRange(const ValueRange& lhs, const ValueRange& rhs) {
+    return {addLow(lhs.lo, rhs.lo), addHigh(lhs.hi, rhs.hi)};
+}
+
+ValueRange hull(const ValueRange& lhs, const ValueRange& rhs) {
+    return {std::min(lhs.lo, rhs.lo), std::max(lhs.hi, rhs.hi)};
+}
+
+// Bounds that moved since `before` jump to infinity.
+ValueRange widenRange(const ValueRange& before, const ValueRange& after) {
+    return {after.lo < before.lo ? INT_MIN : before.lo, after.hi > before.hi ? INT_MAX : before.hi};
+}
+
+bool isIdentity(const VarTransfer& transfer) {
+    return transfer.passes && !transfer.sets && transfer.add == ValueRange{0, 0};
+}
+
+VarTransfer joinTransfer(const VarTransfer& lhs, const VarTransfer& rhs) {
+    VarTransfer out;
+    out.passes = lhs.passes || rhs.passes;
+    out.add = (lhs.passes && rhs.passes) ? hull(lhs.add, rhs.add) : (lhs.passes ? lhs.add : rhs.add);
+    out.sets = lhs.sets || rhs.sets;
+    out.set = (lhs.sets && rhs.sets) ? hull(lhs.set, rhs.set) : (lhs.sets ? lhs.set : rhs.set);
+    return out;
+}
+
+VarTransfer widenTransfer(const VarTransfer& before, const VarTransfer& after) {
+    VarTransfer out = after;
+    if (before.passes && after.passes) {
+        out.add = widenRange(before.add, after.add);
+    }
+    if (before.sets && after.sets) {
+        out.set = widenRange(before.set, after.set);
+    }
+    return out;
+}
+
+// Range of a var after `transfer`, given its range before.
+ValueRange transferRange(const VarTransfer& transfer, const ValueRange& in) {
+    if (!transfer.passes) {
+        return transfer.set;
+    }
+    ValueRange out = addRange(in, transfer.add);
+    return transfer.sets ? hull(out, transfer.set) : out;
+}
+
+template <typename Value>
+auto findVar(const std::vector<std::pair<int, Value>>& entries, int var) {
+    return std::lower_bound(entries.begin(), entries.end(), var,
+                            [](const std::pair<int, Value>& entry, int v) { return entry.first < v; });
+}
+
+VarTransfer transferOf(const VarTransfers& transfers, int var) {
+    auto it = findVar(transfers, var);
+    return (it != transfers.end() && it->first == var) ? it->second : VarTransfer();
+}
+
+void setTransfer(VarTransfers& transfers, int var, const VarTransfer& transfer) {
+    auto it = findVar(transfers, var);
+    bool present = it != transfers.end() && it->first == var;
+    if (isIdentity(transfer)) {
+        if (present) {
+            transfers.erase(it);
+        }
+    } else if (present) {
+        transfers[it - transfers.begin()].second = transfer;
+    } else {
+        transfers.insert(transfers.begin() + (it - transfers.begin()), {var, transfer});
+    }
+}
+
+// Merges two sorted lists over the union of their vars; `combine` gets the
+// default for a var missing on one side.
+template <typename Value, typename Combine>
+std::vector<std::pair<int, Value>> mergeVars(const std::vector<std::pair<int, Value>>& lhs,
+                                             const std::vector<std::pair<int, Value>>& rhs, const Value& missing,
+                                             Combine combine) {
+    std::vector<std::pair<int, Value>> out;
+    out.reserve(std::max(lhs.size(), rhs.size()));
+    size_t i = 0;
+    size_t j = 0;
+    while (i < lhs.size() || j < rhs.size()) {
+        if (j == rhs.size() || (i < lhs.size() && lhs[i].first < rhs[j].first)) {
+            combine(out, lhs[i].first, lhs[i].second, missing);
+            ++i;
+        } else if (i == lhs.size() || rhs[j].first < lhs[i].first) {
+            combine(out, rhs[j].first, missing, rhs[j].second);
+            ++j;
+        } else {
+            combine(out, lhs[i].first, lhs[i].second, rhs[j].second);
+            ++i;
+            ++j;
+        }
+    }
+    return out;
+}
+
+VarTransfers joinTransfers(const VarTransfers& lhs, const VarTransfers& rhs) {
+    return mergeVars(lhs, rhs, VarTransfer(), [](VarTransfers& out, int var, const VarTransfer& a, const VarTransfer& b) {
+        VarTransfer joined = joinTransfer(a, b);
+        if (!isIdentity(joined)) {
+            out.emplace_back(var, joined);
+        }
+    });
+}
+
+VarTransfers widenTransfers(const VarTransfers& before, const VarTransfers& after) {
+    return mergeVars(before, after, VarTransfer(), [](VarTransfers& out, int var, const VarTransfer& a, const VarTransfer& b) {
+        VarTransfer widened = widenTransfer(a, b);
+        if (!isIdentity(widened)) {
+            out.emplace_back(var, widened);
+        }
+    });
+}
+
+ValueRange rangeOf(const RangeState& state, int var) {
+    auto it = findVar(state.known, var);
+    return (it != state.known.end() && it->first == var) ? it->second : ValueRange();
+}
+
+RangeState applyTransfers(const VarTransfers& transfers, const RangeState& in) {
+    RangeState out;
+    out.reached = in.reached;
+    VarTransfer identity;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < in.known.size() || j < transfers.size()) {
+        int var;
+        ValueRange before;
+        const VarTransfer* transfer = &identity;
+        if (j == transfers.size() || (i < in.known.size() && in.known[i].first < transfers[j].first)) {
+            var = in.known[i].first;
+            before = in.known[i++].second;
+        } else if (i == in.known.size() || transfers[j].first < in.known[i].first) {
+            var = transfers[j].first;
+            transfer = &transfers[j++].second;
+        } else {
+            var = in.known[i].first;
+            before = in.known[i++].second;
+            transfer = &transfers[j++].second;
+        }
+        ValueRange after = transferRange(*transfer, before);
+        if (!after.isAll()) {
+            out.known.emplace_back(var, after);
+        }
+    }
+    return out;
+}
+
+// Vars known on only one side may hold anything after the join.
+RangeState joinStates(const RangeState& lhs, const RangeState& rhs) {
+    if (!lhs.reached) {
+        return rhs;
+    }
+    if (!rhs.reached) {
+        return lhs;
+    }
+    RangeState out;
+    out.reached = true;
+    size_t j = 0;
+    for (const auto& entry : lhs.known) {
+        while (j < rhs.known.size() && rhs.known[j].first < entry.first) {
+            ++j;
+        }
+        if (j < rhs.known.size() && rhs.known[j].first == entry.first) {
+            out.known.emplace_back(entry.first, hull(entry.second, rhs.known[j].second));
+        }
+    }
+    return out;
+}
+
+RangeState widenState(const RangeState& before, const RangeState& after) {
+    if (!before.reached) {
+        return after;
+    }
+    RangeState out;
+    out.reached = after.reached;
+    for (const auto& entry : after.known) {
+        ValueRange widened = widenRange(rangeOf(before, entry.first), entry.second);
+        if (!widened.isAll()) {
+            out.known.emplace_back(entry.first, widened);
+        }
+    }
+    return out;
+}
+
+bool sameState(const RangeState& lhs, const RangeState& rhs) {
+    return lhs.reached == rhs.reached && lhs.known == rhs.known;
+}
+
+CheckVerdict judge(const ValueRange& range, int mode, int value) {
+    switch (mode) {
+        case kCompareGreater:
+            if (range.lo > value) {
+                return CheckVerdict::AlwaysTrue;
+            }
+            return range.hi <= value ? CheckVerdict::AlwaysFalse : CheckVerdict::Unknown;
+        case kCompareLess:
+            if (range.hi < value) {
+                return CheckVerdict::AlwaysTrue;
+            }
+            return range.lo >= value ? CheckVerdict::AlwaysFalse : CheckVerdict::Unknown;
+        case kCompareEqual:
+            if (range.lo == value && range.hi == value) {
+                return CheckVerdict::AlwaysTrue;
+            }
+            return (value < range.lo || value > range.hi) ? CheckVerdict::AlwaysFalse : CheckVerdict::Unknown;
+        default:
+            return CheckVerdict::Unknown;
+    }
+}
+
+enum class OpType : std::uint8_t {
+    Check,
+    Set,
+    Add,
+    Havoc,
+    FrameJump,
+    PatternJump
+};
+
+// One step of a frame, in the order the scanner lists blocks (IF, then EF).
+struct Op {
+    OpType type;
+    bool conditional;
+    bool isEffect;
+    std::uint16_t block;
+    int var;   // target frame or pattern for jumps
+    int value; // set value, added amount, or check index
+};
+
+struct FrameFlow {
+    std::vector<Op> ops;
+    int endFrame = -1;   // next frame when the frame ends, or -1
+    int endPattern = -1; // pattern an end frame jumps to, or -1
+};
+
+// Vars every path from a point overwrites with an unconditional set before
+// reading. Starts as everything and shrinks to a fixpoint, so it is either
+// a finite set or everything except `vars`.
+struct KillSet {
+    bool all = true;
+    std::vector<int> vars; // members, or exclusions when `all`; sorted
+
+    bool contains(int var) const { return all != std::binary_search(vars.begin(), vars.end(), var); }
+    void add(int var) { all ? erase(var) : insert(var); }
+    void remove(int var) { all ? insert(var) : erase(var); }
+    void intersect(const KillSet& other) {
+        std::vector<int> out;
+        if (all && other.all) {
+            std::set_union(vars.begin(), vars.end(), other.vars.begin(), other.vars.end(), std::back_inserter(out));
+        } else if (all) {
+            std::set_difference(other.vars.begin(), other.vars.end(), vars.begin(), vars.end(), std::back_inserter(out));
+        } else if (other.all) {
+            std::set_difference(vars.begin(), vars.end(), other.vars.begin(), other.vars.end(), std::back_inserter(out));
+        } else {
+            std::set_intersection(vars.begin(), vars.end(), other.vars.begin(), other.vars.end(), std::back_inserter(out));
+        }
+        all = all && other.all;
+        vars.swap(out);
+    }
+    bool operator==(const KillSet& other) const { return all == other.all && vars == other.vars; }
+    bool operator!=(const KillSet& other) const { return !(*this == other); }
+
+private:
+    void insert(int var) {
+        auto it = std::lower_bound(vars.begin(), vars.end(), var);
+        if (it == vars.end() || *it != var) {
+            vars.insert(it, var);
+        }
+    }
+    void erase(int var) {
+        auto it = std::lower_bound(vars.begin(), vars.end(), var);
+        if (it != vars.end() && *it == var) {
+            vars.erase(it);
+        }
+    }
+};
+
+KillSet nothingKilled() {
+    KillSet set;
+    set.all = false;
+    return set;
+}
+
+int decodeVar(const KindLayout& layout, const int* parameters) {
+    int raw = parameters[layout.slots[static_cast<int>(OccurrenceField::Value)]];
+    int var;
+    int remainder;
+    decodeRawValues(layout.encoding, &raw, 1, &var, &remainder);
+    return var;
+}
+
+int slotValue(const KindLayout& layout, const int* parameters, OccurrenceField field) {
+    return parameters[layout.slots[static_cast<int>(field)]];
+}
+
+// Appends the write a change block makes, if any.
+void addWriteOp(std::vector<Op>& ops, const KindLayout& layout, const int* parameters, bool isEffect, size_t block) {
+    if (layout.category != VarCategory::Extra || !hasSlot(layout, OccurrenceField::Value) ||
+        !hasSlot(layout, OccurrenceField::ChangeValue)) {
+        return;
+    }
+    int mode = hasSlot(layout, OccurrenceField::ChangeMode) ? slotValue(layout, parameters, OccurrenceField::ChangeMode)
+                                                           : kChangeSet;
+    if (mode == kChangeOwnerSet || mode == kChangeOwnerAdd) {
+        return;
+    }
+    Op op{OpType::Havoc, !isEffect, isEffect, static_cast<std::uint16_t>(block), decodeVar(layout, parameters),
+          slotValue(layout, parameters, OccurrenceField::ChangeValue)};
+    if (mode == kChangeSet) {
+        op.type = OpType::Set;
+    } else if (mode == kChangeAdd) {
+        op.type = OpType::Add;
+    }
+    ops.push_back(op);
+}
+
+void applyOp(VarTransfers& transfers, const Op& op) {
+    VarTransfer before = transferOf(transfers, op.var);
+    VarTransfer after;
+    switch (op.type) {
+        case OpType::Set:
+            after.passes = false;
+            after.sets = true;
+            after.set = {op.value, op.value};
+            break;
+        case OpType::Add:
+            after = before;
+            after.add = addRange(before.add, {op.value, op.value});
+            after.set = addRange(before.set, {op.value, op.value});
+            break;
+        case OpType::Havoc:
+            after.passes = false;
+            after.sets = true;
+            after.set = ValueRange();
+            break;
+        default:
+            return;
+    }
+    setTransfer(transfers, op.var, op.conditional ? joinTransfer(before, after) : after);
+}
+
+} // namespace
+
+const char* checkVerdictLabel(CheckVerdict verdict) {
+    switch (verdict) {
+        case CheckVerdict::AlwaysTrue:
+            return "always true";
+        case CheckVerdict::AlwaysFalse:
+            return "always false";
+        case CheckVerdict::Unknown:
+        default:
+            return "depends";
+    }
+}
+
+void VarRangeAnalysis::clear() {
+    m_summaries.clear();
+    m_entry.clear();
+    m_verdicts.clear();
+    m_ranges.clear();
+    m_propagationDirty = true;
+}
+
+void VarRangeAnalysis::build(const FrameData& data) {
+    clear();
+    m_summaries.resize(data.get_sequence_count());
+    for (int seqIndex = 0; seqIndex < static_cast<int>(m_summaries.size()); ++seqIndex) {
+        summarize(data, seqIndex, m_summaries[seqIndex]);
+    }
+}
+
+void VarRangeAnalysis::updateSequence(const FrameData& data, int seqIndex) {
+    if (static_cast<int>(m_summaries.size()) != data.get_sequence_count()) {
+        build(data);
+        return;
+    }
+    if (seqIndex < 0 || seqIndex >= static_cast<int>(m_summaries.size())) {
+        return;
+    }
+    summarize(data, seqIndex, m_summaries[seqIndex]);
+    m_propagationDirty = true;
+}
+
+void VarRangeAnalysis::summarize(const FrameData& data, int seqIndex, Summary& summary) const {
+    summary = Summary();
+    const Sequence* seq = data.peek_sequence(seqIndex);
+    if (!seq || seq->frames.empty()) {
+        return;
+    }
+    const int patternCount = static_cast<int>(m_summaries.size());
+    const int frameCount = static_cast<int>(std::min(seq->frames.size(), kMaxHandleIndex));
+
+    std::vector<FrameFlow> flows(frameCount);
+    for (int f = 0; f < frameCount; ++f) {
+        const auto& frame = seq->frames[f];
+        FrameFlow& flow = flows[f];
+        size_t ifCount = std::min(frame.IF.size(), kMaxHandleIndex);
+        for (size_t b = 0; b < ifCount; ++b) {
+            OccurrenceKind kind;
+            if (!classifyIf(frame.IF[b].type, kind)) {
+                continue;
+            }
+            const KindLayout& layout = kindLayout(kind);
+            const int* parameters = frame.IF[b].parameters;
+            auto block = static_cast<std::uint16_t>(b);
+            if (layout.category == VarCategory::Extra && hasSlot(layout, OccurrenceField::Value) &&
+                hasSlot(layout, OccurrenceField::CompareValue) && hasSlot(layout, OccurrenceField::CompareMode)) {
+                int var = decodeVar(layout, parameters);
+                int index = static_cast<int>(summary.checks.size());
+                summary.checks.push_back({static_cast<std::uint16_t>(f), block, var,
+                                          slotValue(layout, parameters, OccurrenceField::CompareMode),
+                                          slotValue(layout, parameters, OccurrenceField::CompareValue), false, {}});
+                flow.ops.push_back({OpType::Check, false, false, block, var, index});
+            }
+            addWriteOp(flow.ops, layout, parameters, false, b);
+            if (hasSlot(layout, OccurrenceField::JumpTarget)) {
+                int raw = slotValue(layout, parameters, OccurrenceField::JumpTarget);
+                if (layout.jumpTargetSupportsPattern && raw >= kPatternJumpOffset) {
+                    if (raw - kPatternJumpOffset < patternCount) {
+                        flow.ops.push_back({OpType::PatternJump, true, false, block, raw - kPatternJumpOffset, 0});
+                    }
+                } else if (raw >= 0 && raw < frameCount) {
+                    flow.ops.push_back({OpType::FrameJump, true, false, block, raw, 0});
+                }
+            }
+        }
+        size_t efCount = std::min(frame.EF.size(), kMaxHandleIndex);
+        for (size_t b = 0; b < efCount; ++b) {
+            int target;
+            if (efSpawnTarget(frame.EF[b], seqIndex, target)) {
+                if (target >= 0 && target < patternCount) {
+                    summary.spawns.push_back(target);
+                }
+                continue;
+            }
+            OccurrenceKind kind;
+            if (classifyEf(frame.EF[b].type, frame.EF[b].number, kind)) {
+                addWriteOp(flow.ops, kindLayout(kind), frame.EF[b].parameters, true, b);
+            }
+        }
+        switch (frame.AF.aniType) {
+            case 0:
+                if (frame.AF.jump >= 0 && frame.AF.jump < patternCount) {
+                    flow.endPattern = frame.AF.jump;
+                }
+                break;
+            case 2:
+                if (frame.AF.jump >= 0 && frame.AF.jump < frameCount) {
+                    flow.endFrame = frame.AF.jump;
+                }
+                break;
+            default:
+                if (f + 1 < frameCount) {
+                    flow.endFrame = f + 1;
+                }
+                break;
+        }
+    }
+    std::sort(summary.spawns.begin(), summary.spawns.end());
+    summary.spawns.erase(std::unique(summary.spawns.begin(), summary.spawns.end()), summary.spawns.end());
+
+    // Forward: what the pattern has done to each var on entry to each frame.
+    std::vector<VarTransfers> entry(frameCount);
+    std::vector<char> reached(frameCount, 0);
+    std::vector<int> joins(frameCount, 0);
+    std::set<int> pending;
+    auto flowTo = [&](int frame, const VarTransfers& transfers) {
+        if (!reached[frame]) {
+            reached[frame] = 1;
+            entry[frame] = transfers;
+            pending.insert(frame);
+            return;
+        }
+        VarTransfers joined = joinTransfers(entry[frame], transfers);
+        if (++joins[frame] > kWidenAfter) {
+            joined = widenTransfers(entry[frame], joined);
+        }
+        if (joined != entry[frame]) {
+            entry[frame].swap(joined);
+            pending.insert(frame);
+        }
+    };
+    auto exitTo = [&](int pattern, const VarTransfers& transfers) {
+        auto it = findVar(summary.exits, pattern);
+        if (it != summary.exits.end() && it->first == pattern) {
+            auto& exit = summary.exits[it - summary.exits.begin()].second;
+            exit = joinTransfers(exit, transfers);
+        } else {
+            summary.exits.insert(summary.exits.begin() + (it - summary.exits.begin()), {pattern, transfers});
+        }
+    };
+
+    reached[0] = 1;
+    pending.insert(0);
+    VarTransfers current;
+    while (!pending.empty()) {
+        int f = *pending.begin();
+        pending.erase(pending.begin());
+        current = entry[f];
+        for (const Op& op : flows[f].ops) {
+            switch (op.type) {
+                case OpType::Check:
+                    summary.checks[op.value].reached = true;
+                    summary.checks[op.value].before = current;
+                    break;
+                case OpType::FrameJump:
+                    flowTo(op.var, current);
+                    break;
+                case OpType::PatternJump:
+                    exitTo(op.var, current);
+                    break;
+                default:
+                    applyOp(current, op);
+                    break;
+            }
+        }
+        if (flows[f].endFrame >= 0) {
+            flowTo(flows[f].endFrame, current);
+        } else if (flows[f].endPattern >= 0) {
+            exitTo(flows[f].endPattern, current);
+        }
+    }
+
+    // Backward: vars each frame overwrites before reading on every path. A
+    // path leaving the pattern may read anything later.
+    std::vector<KillSet> killIn(frameCount);
+    auto walkFrame = [&](int f, std::vector<DeadWrite>* dead) {
+        const FrameFlow& flow = flows[f];
+        KillSet kill = flow.endFrame >= 0 ? killIn[flow.endFrame] : nothingKilled();
+        for (auto op = flow.ops.rbegin(); op != flow.ops.rend(); ++op) {
+            switch (op->type) {
+                case OpType::FrameJump:
+                    kill.intersect(killIn[op->var]);
+                    break;
+                case OpType::PatternJump:
+                    kill = nothingKilled();
+                    break;
+                case OpType::Check:
+                    kill.remove(op->var);
+                    break;
+                case OpType::Set:
+                    if (dead && kill.contains(op->var)) {
+                        dead->push_back({seqIndex, static_cast<std::uint16_t>(f), op->block, op->isEffect, op->var});
+                    }
+                    if (!op->conditional) {
+                        kill.add(op->var);
+                    }
+                    break;
+                case OpType::Add:
+                    if (dead && kill.contains(op->var)) {
+                        dead->push_back({seqIndex, static_cast<std::uint16_t>(f), op->block, op->isEffect, op->var});
+                    }
+                    kill.remove(op->var);
+                    break;
+                case OpType::Havoc:
+                    kill.remove(op->var);
+                    break;
+            }
+        }
+        return kill;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int f = frameCount - 1; f >= 0; --f) {
+            KillSet kill = walkFrame(f, nullptr);
+            if (kill != killIn[f]) {
+                killIn[f] = std::move(kill);
+                changed = true;
+            }
+        }
+    }
+    for (int f = 0; f < frameCount; ++f) {
+        if (reached[f]) {
+            walkFrame(f, &summary.deadWrites);
+        }
+    }
+    std::sort(summary.deadWrites.begin(), summary.deadWrites.end(), [](const DeadWrite& lhs, const DeadWrite& rhs) {
+        return std::tie(lhs.frameIndex, lhs.isEffect, lhs.blockIndex) < std::tie(rhs.frameIndex, rhs.isEffect, rhs.blockIndex);
+    });
+}
+
+void VarRangeAnalysis::propagate() {
+    const int n = static_cast<int>(m_summaries.size());
+    std::vector<char> isEntry(n, 0);
+    std::vector<int> incoming(n, 0);
+    for (int p = 0; p < n; ++p) {
+        for (const auto& exit : m_summaries[p].exits) {
+            ++incoming[exit.first];
+        }
+        for (int target : m_summaries[p].spawns) {
+            isEntry[target] = 1;
+        }
+    }
+
+    m_entry.assign(n, RangeState());
+    std::vector<int> joins(n, 0);
+    std::vector<char> queued(n, 0);
+    std::vector<int> queue;
+    auto seed = [&](int p) {
+        isEntry[p] = 1;
+        m_entry[p].reached = true;
+        m_entry[p].known.clear();
+        queued[p] = 1;
+        queue.push_back(p);
+    };
+    auto run = [&]() {
+        while (!queue.empty()) {
+            int p = queue.back();
+            queue.pop_back();
+            queued[p] = 0;
+            for (const auto& exit : m_summaries[p].exits) {
+                int q = exit.first;
+                if (isEntry[q]) {
+                    continue;
+                }
+                RangeState merged = joinStates(m_entry[q], applyTransfers(exit.second, m_entry[p]));
+                if (++joins[q] > kWidenAfter) {
+                    merged = widenState(m_entry[q], merged);
+                }
+                if (!sameState(merged, m_entry[q])) {
+                    m_entry[q] = std::move(merged);
+                    if (!queued[q]) {
+                        queued[q] = 1;
+                        queue.push_back(q);
+                    }
+                }
+            }
+        }
+    };
+
+    for (int p = 0; p < n; ++p) {
+        if (isEntry[p] || incoming[p] == 0) {
+            seed(p);
+        }
+    }
+    run();
+    // Jump cycles nothing enters: start each from an unknown state.
+    for (int p = 0; p < n; ++p) {
+        if (!m_entry[p].reached) {
+            seed(p);
+            run();
+        }
+    }
+
+    m_verdicts.assign(n, {});
+    m_ranges.assign(n, {});
+    for (int p = 0; p < n; ++p) {
+        const auto& checks = m_summaries[p].checks;
+        m_verdicts[p].assign(checks.size(), CheckVerdict::Unknown);
+        m_ranges[p].assign(checks.size(), ValueRange());
+        for (size_t c = 0; c < checks.size(); ++c) {
+            if (!checks[c].reached) {
+                continue;
+            }
+            ValueRange range = transferRange(transferOf(checks[c].before, checks[c].var), rangeOf(m_entry[p], checks[c].var));
+            m_ranges[p][c] = range;
+            m_verdicts[p][c] = judge(range, checks[c].compareMode, checks[c].compareValue);
+        }
+    }
+    m_propagationDirty = false;
+}
+
+std::vector<CheckFinding> VarRangeAnalysis::decidedChecks() {
+    if (m_propagationDirty) {
+        propagate();
+    }
+    std::vector<CheckFinding> result;
+    for (size_t p = 0; p < m_summaries.size(); ++p) {
+        const auto& checks = m_summaries[p].checks;
+        for (size_t c = 0; c < checks.size(); ++c) {
+            if (m_verdicts[p][c] == CheckVerdict::Unknown) {
+                continue;
+            }
+            result.push_back({static_cast<int>(p), checks[c].frameIndex, checks[c].blockIndex, checks[c].var,
+                              checks[c].compareMode, checks[c].compareValue, m_ranges[p][c], m_verdicts[p][c]});
+        }
+    }
+    return result;
+}
+
+CheckVerdict VarRangeAnalysis::verdictAt(int seqIndex, size_t frameIndex, size_t blockIndex) {
+    if (seqIndex < 0 || seqIndex >= static_cast<int>(m_summaries.size())) {
+        return CheckVerdict::Unknown;
+    }
+    if (m_propagationDirty) {
+        propagate();
+    }
+    const auto& checks = m_summaries[seqIndex].checks;
+    auto it = std::lower_bound(checks.begin(), checks.end(), std::make_pair(frameIndex, blockIndex),
+                               [](const Check& check, const std::pair<size_t, size_t>& key) {
+                                   return std::make_pair(size_t(check.frameIndex), size_t(check.blockIndex)) < key;
+                               });
+    if (it == checks.end() || it->frameIndex != frameIndex || it->blockIndex != blockIndex) {
+        return CheckVerdict::Unknown;
+    }
+    return m_verdicts[seqIndex][it - checks.begin()];
+}
+
+std::vector<DeadWrite> VarRangeAnalysis::deadWrites() const {
+    std::vector<DeadWrite> result;
+    for (const auto& summary : m_summaries) {
+        result.insert(result.end(), summary.deadWrites.begin(), summary.deadWrites.end());
+    }
+    return result;
+}
+
+MemoryUsage VarRangeAnalysis::memoryUsage() const {
+    MemoryUsage usage;
+    usage.add_vector(m_summaries);
+    for (const auto& summary : m_summaries) {
+        usage.add_vector(summary.exits);
+        for (const auto& exit : summary.exits) {
+            usage.add_vector(exit.second);
+        }
+        usage.add_vector(summary.spawns);
+        usage.add_vector(summary.checks);
+        for (const auto& check : summary.checks) {
+            usage.add_vector(check.before);
+        }
+        usage.add_vector(summary.deadWrites);
+    }
+    usage.add_vector(m_entry);
+    for (const auto& state : m_entry) {
+        usage.add_vector(state.known);
+    }
+    usage.add_vector(m_verdicts);
+    usage.add_vector(m_ranges);
+    for (const auto& verdicts : m_verdicts) {
+        usage.add_vector(verdicts);
+    }
+    for (const auto& ranges : m_ranges) {
+        usage.add_vector(ranges);
+    }
+    return usage;
+}
+
+} // namespace varswap
@@ -0,0 +1,142 @@
+#ifndef VARSWAP_VAR_RANGES_H_GUARD
+#define VARSWAP_VAR_RANGES_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+namespace varswap {
+
+// Closed interval of var values. INT_MIN and INT_MAX stand for unbounded
+// ends, so the default range is "any value".
+struct ValueRange {
+    int lo = INT_MIN;
+    int hi = INT_MAX;
+
+    bool isAll() const { return lo == INT_MIN && hi == INT_MAX; }
+    bool operator==(const ValueRange& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const ValueRange& other) const { return !(*this == other); }
+};
+
+enum class CheckVerdict : std::uint8_t {
+    Unknown,
+    AlwaysTrue,
+    AlwaysFalse
+};
+
+const char* checkVerdictLabel(CheckVerdict verdict);
+
+// What a stretch of sequence flow does to one var: the value after it is
+// `in + add` when some path keeps the var (passes), joined with `set` when
+// some path overwrites it (sets).
+struct VarTransfer {
+    bool passes = true;
+    bool sets = false;
+    ValueRange add{0, 0};
+    ValueRange set{0, 0};
+
+    bool operator==(const VarTransfer& other) const {
+        return passes == other.passes && sets == other.sets && (!passes || add == other.add) &&
+               (!sets || set == other.set);
+    }
+    bool operator!=(const VarTransfer& other) const { return !(*this == other); }
+};
+
+// Sorted by var; vars not listed pass through unchanged.
+using VarTransfers = std::vector<std::pair<int, VarTransfer>>;
+
+// Var ranges at one point. Sorted by var; vars not listed may hold any
+// value. `reached` is false until some path gets there.
+struct RangeState {
+    bool reached = false;
+    std::vector<std::pair<int, ValueRange>> known;
+};
+
+// An IF comparison (IF25) whose outcome is fixed by the range its var can
+// hold when the check runs.
+struct CheckFinding {
+    int seqIndex;
+    std::uint16_t frameIndex;
+    std::uint16_t blockIndex;
+    int var;
+    int compareMode;
+    int compareValue;
+    ValueRange range;
+    CheckVerdict verdict;
+};
+
+// A var write that every path through its pattern overwrites with an
+// unconditional set before anything reads the var again.
+struct DeadWrite {
+    int seqIndex;
+    std::uint16_t frameIndex;
+    std::uint16_t blockIndex;
+    bool isEffect;
+    int var;
+};
+
+// Interval analysis of Extra vars along sequence flow. Each pattern is
+// summarized once as a transfer function: for every var it touches, the
+// value leaving through each exit (end jump, IF pattern jump) is the entry
+// value plus an added range, a set range, or the hull of both, and each
+// IF25 check keeps the same kind of function for the point where it runs.
+// Frames are walked with their frame jumps and the summary is widened on
+// loops. The per-pattern functions are then chained over pattern jumps from
+// the entry patterns, where every var may hold any value. A pattern is an
+// entry when nothing jumps into it, when something spawns it, or when no
+// entry reaches it.
+//
+// IF31 and IF38 are conditional writes (IF31 sets, IF38 uses its change
+// mode; owner-var modes are skipped); EF6 #105 sets or adds unconditionally.
+// Branch conditions do not narrow ranges.
+//
+// updateSequence() re-summarizes only the edited pattern; the chaining step
+// works on summaries alone and is redone on the next query.
+class VarRangeAnalysis {
+public:
+    void build(const FrameData& data);
+    void updateSequence(const FrameData& data, int seqIndex);
+    void clear();
+    bool empty() const { return m_summaries.empty(); }
+
+    // Checks that are always true or always false, by pattern, frame, block.
+    std::vector<CheckFinding> decidedChecks();
+    CheckVerdict verdictAt(int seqIndex, size_t frameIndex, size_t blockIndex);
+    std::vector<DeadWrite> deadWrites() const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct Check {
+        std::uint16_t frameIndex;
+        std::uint16_t blockIndex;
+        int var;
+        int compareMode;
+        int compareValue;
+        bool reached;
+        VarTransfers before;
+    };
+    struct Summary {
+        std::vector<std::pair<int, VarTransfers>> exits; // by target pattern
+        std::vector<int> spawns; // sorted, unique
+        std::vector<Check> checks; // by frame, block
+        std::vector<DeadWrite> deadWrites;
+    };
+
+    void summarize(const FrameData& data, int seqIndex, Summary& summary) const;
+    void propagate();
+
+    std::vector<Summary> m_summaries;
+    // Valid while !m_propagationDirty.
+    std::vector<RangeState> m_entry;
+    std::vector<std::vector<CheckVerdict>> m_verdicts; // per pattern, parallel to checks
+    std::vector<std::vector<ValueRange>> m_ranges;
+    bool m_propagationDirty = true;
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_VAR_RANGES_H_GUARD */
@@ -0,0 +1,254 @@
+#include "varswap/var_remap.h"
+
+#include "varswap/bit_ops.h"
+#include "varswap/occurrence_schema.h"
+#include "varswap/var_decode.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <sstream>
+
+namespace varswap {
+
+namespace {
+
+constexpr int kEncodingCount = static_cast<int>(ValueEncoding::ProjectileComposite) + 1;
+
+bool parseNumber(const std::string& text, long long& out) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    out = std::strtoll(text.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+bool parseInt(const std::string& text, int& out) {
+    long long value = 0;
+    if (!parseNumber(text, value) || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+// Bit v in word v / 64.
+void setBit(std::vector<std::uint64_t>& bits, int v) {
+    bits[static_cast<size_t>(v) >> 6] |= std::uint64_t{1} << (v & 63);
+}
+
+bool testBit(const std::vector<std::uint64_t>& bits, int v) {
+    size_t word = static_cast<size_t>(v) >> 6;
+    return word < bits.size() && (bits[word] >> (v & 63)) & 1;
+}
+
+void appendBits(const std::vector<std::uint64_t>& bits, std::vector<int>& out) {
+    for (size_t word = 0; word < bits.size(); ++word) {
+        for (std::uint64_t w = bits[word]; w; w &= w - 1) {
+            out.push_back(static_cast<int>(word * 64) + countTrailingZeros(w));
+        }
+    }
+}
+
+long long targetOf(const VarRemap& remap, int var) {
+    if (remap.useTable) {
+        return remap.table[static_cast<size_t>(var - remap.source.min)];
+    }
+    return static_cast<long long>(var) * remap.scale + remap.offset;
+}
+
+} // namespace
+
+bool VarRemap::map(int var, int& out) const {
+    if (var < source.min || var > source.max) {
+        return false;
+    }
+    out = static_cast<int>(targetOf(*this, var));
+    return true;
+}
+
+bool parseVarRemap(const std::string& text, VarRemap& remap, std::string& error) {
+    std::istringstream in(text);
+    std::string category;
+    std::string range;
+    std::string transform;
+    std::string extra;
+    in >> category >> range >> transform;
+    if (transform.empty() || (in >> extra)) {
+        error = "expected \"<category> <min>..<max> (+<n> | -<n> | *<k>[+<n>] | =<v>,<v>,...)\"";
+        return false;
+    }
+
+    VarRemap parsed;
+    if (!parseCategoryName(category, parsed.category)) {
+        error = "unknown category " + category;
+        return false;
+    }
+    size_t dots = range.find("..");
+    if (dots == std::string::npos || !parseInt(range.substr(0, dots), parsed.source.min) ||
+        !parseInt(range.substr(dots + 2), parsed.source.max)) {
+        error = "expected <min>..<max>, got " + range;
+        return false;
+    }
+
+    char op = transform[0];
+    std::string rest = transform.substr(1);
+    if (op == '+' || op == '-') {
+        if (!parseInt(transform, parsed.offset)) {
+            error = "invalid shift " + transform;
+            return false;
+        }
+    } else if (op == '*') {
+        size_t sign = rest.find_first_of("+-", 1);
+        if (!parseInt(rest.substr(0, sign), parsed.scale) ||
+            (sign != std::string::npos && !parseInt(rest.substr(sign), parsed.offset))) {
+            error = "invalid affine transform " + transform;
+            return false;
+        }
+    } else if (op == '=') {
+        parsed.useTable = true;
+        std::istringstream entries(rest);
+        std::string entry;
+        while (std::getline(entries, entry, ',')) {
+            int target = 0;
+            if (!parseInt(entry, target)) {
+                error = "invalid table entry " + entry;
+                return false;
+            }
+            parsed.table.push_back(target);
+        }
+    } else {
+        error = "transform must start with +, -, * or =";
+        return false;
+    }
+    remap = std::move(parsed);
+    return true;
+}
+
+bool planVarRemap(const FrameData& data, const std::vector<Occurrence>& occurrences, const int* vars,
+                  const VarRemap& remap, RemapPlan& plan, std::string& error) {
+    plan = RemapPlan();
+    const VarRange& source = remap.source;
+    if (source.min < 0 || source.min > source.max || source.max > VarUsage::kMaxTrackedVar) {
+        error = "source range must lie in 0.." + std::to_string(VarUsage::kMaxTrackedVar);
+        return false;
+    }
+    size_t rangeSize = static_cast<size_t>(source.max - source.min) + 1;
+    if (remap.useTable && remap.table.size() != rangeSize) {
+        error = "table needs " + std::to_string(rangeSize) + " entries, got " + std::to_string(remap.table.size());
+        return false;
+    }
+    // Checked for the whole range up front, so a remap is valid or not
+    // regardless of which ids the document happens to use.
+    int maxTarget = 0;
+    for (int var = source.min; var <= source.max; ++var) {
+        long long target = targetOf(remap, var);
+        if (target < 0 || target > VarUsage::kMaxTrackedVar) {
+            error = "var " + std::to_string(var) + " maps to " + std::to_string(target) + ", outside 0.." +
+                    std::to_string(VarUsage::kMaxTrackedVar);
+            return false;
+        }
+        maxTarget = std::max(maxTarget, static_cast<int>(target));
+    }
+
+    // Selection: every row of the id space whose var is in range.
+    VarCategory space = varIdSpace(remap.category);
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        const Occurrence& occ = occurrences[i];
+        int to = 0;
+        if (varIdSpace(occ.category) != space || !remap.map(vars[i], to)) {
+            continue;
+        }
+        const int* value = resolveField(data, occ, OccurrenceField::Value);
+        if (!value) {
+            continue;
+        }
+        plan.ids.push_back(static_cast<std::uint32_t>(i));
+        plan.fromVars.push_back(vars[i]);
+        plan.toVars.push_back(to);
+        plan.rawValues.push_back(*value);
+    }
+
+    // Targets of the source ids in use; a target reached twice merges ids.
+    std::vector<std::uint64_t> usedSources((rangeSize + 63) / 64, 0);
+    std::vector<std::uint64_t> targets(static_cast<size_t>(maxTarget) / 64 + 1, 0);
+    std::vector<std::uint64_t> merged(targets.size(), 0);
+    for (size_t j = 0; j < plan.ids.size(); ++j) {
+        int sourceBit = plan.fromVars[j] - source.min;
+        if (testBit(usedSources, sourceBit)) {
+            continue;
+        }
+        setBit(usedSources, sourceBit);
+        if (testBit(targets, plan.toVars[j])) {
+            setBit(merged, plan.toVars[j]);
+        }
+        setBit(targets, plan.toVars[j]);
+    }
+    appendBits(merged, plan.merged);
+
+    // Rows outside the source range keep their id; any of them on a target
+    // id would end up sharing it with the moved rows.
+    std::vector<std::uint64_t> collisions(targets.size(), 0);
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        int var = vars[i];
+        if (var >= source.min && var <= source.max) {
+            continue;
+        }
+        if (var >= 0 && var <= maxTarget && testBit(targets, var) &&
+            varIdSpace(occurrences[i].category) == space) {
+            setBit(collisions, var);
+        }
+    }
+    appendBits(collisions, plan.collisions);
+
+    // Compose the new raw values, then decode old and new raw values as one
+    // batch per encoding: a row is only writable when the new value decodes
+    // to its target id with the old remainder.
+    std::vector<std::uint32_t> rows[kEncodingCount];
+    std::vector<int> before[kEncodingCount];
+    std::vector<int> after[kEncodingCount];
+    for (size_t j = 0; j < plan.ids.size(); ++j) {
+        ValueEncoding encoding = occurrences[plan.ids[j]].encoding();
+        int e = static_cast<int>(encoding);
+        rows[e].push_back(static_cast<std::uint32_t>(j));
+        before[e].push_back(plan.rawValues[j]);
+        after[e].push_back(composeVarValue(encoding, plan.rawValues[j], plan.toVars[j]));
+    }
+    std::vector<int> decodedVars;
+    std::vector<int> oldRemainders;
+    std::vector<int> newRemainders;
+    for (int e = 0; e < kEncodingCount; ++e) {
+        size_t n = rows[e].size();
+        if (n == 0) {
+            continue;
+        }
+        auto encoding = static_cast<ValueEncoding>(e);
+        decodedVars.resize(n);
+        oldRemainders.resize(n);
+        newRemainders.resize(n);
+        decodeRawValues(encoding, before[e].data(), n, decodedVars.data(), oldRemainders.data());
+        decodeRawValues(encoding, after[e].data(), n, decodedVars.data(), newRemainders.data());
+        for (size_t k = 0; k < n; ++k) {
+            size_t j = rows[e][k];
+            plan.rawValues[j] = after[e][k];
+            if (decodedVars[k] != plan.toVars[j] || newRemainders[k] != oldRemainders[k]) {
+                plan.unencodable.push_back(plan.ids[j]);
+            }
+        }
+    }
+    std::sort(plan.unencodable.begin(), plan.unencodable.end());
+    return true;
+}
+
+size_t applyRemapPlan(FrameData& data, const std::vector<Occurrence>& occurrences, const RemapPlan& plan) {
+    size_t written = 0;
+    for (size_t j = 0; j < plan.ids.size(); ++j) {
+        if (writeField(data, occurrences[plan.ids[j]], OccurrenceField::Value, plan.rawValues[j])) {
+            ++written;
+        }
+    }
+    return written;
+}
+
+} // namespace varswap
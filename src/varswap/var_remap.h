@@ -0,0 +1,66 @@
+#ifndef VARSWAP_VAR_REMAP_H_GUARD
+#define VARSWAP_VAR_REMAP_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+#include "varswap/var_usage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace varswap {
+
+// Moves the var ids in `source` of one category's id space. An affine remap
+// sends v to v * scale + offset; a table remap sends source.min + i to
+// table[i]. Ids outside `source` are left alone.
+struct VarRemap {
+    VarCategory category = VarCategory::Projectile;
+    VarRange source;
+    bool useTable = false;
+    int scale = 1;
+    int offset = 0;
+    std::vector<int> table;
+
+    // False when `var` is outside the source range.
+    bool map(int var, int& out) const;
+};
+
+// Parses "<category> <min>..<max> <transform>", where the transform is
+// "+<n>" or "-<n>" (shift), "*<k>[+<n>|-<n>]" (affine) or "=<v>,<v>,..."
+// (one target per source id), e.g. "projectile 10..29 +40".
+bool parseVarRemap(const std::string& text, VarRemap& remap, std::string& error);
+
+// Rows a remap rewrites and what it would run into.
+struct RemapPlan {
+    std::vector<std::uint32_t> ids; // occurrence ids, ascending
+    std::vector<int> fromVars;
+    std::vector<int> toVars;
+    std::vector<int> rawValues; // new raw Value per row
+    // Target ids that rows left alone already use.
+    std::vector<int> collisions;
+    // Target ids reached from more than one source id.
+    std::vector<int> merged;
+    // Rows whose encoding cannot hold their target id, e.g. a projectile
+    // register past 9 in a base-10 block.
+    std::vector<std::uint32_t> unencodable;
+
+    bool clean() const { return collisions.empty() && merged.empty() && unencodable.empty(); }
+};
+
+// Plans `remap` over the occurrence columns; `vars` is the decoded var of
+// every occurrence (see var_decode.h). Selection, mapping and the collision
+// check are single passes over the columns; new raw values are composed
+// with composeVarValue and decoded back in one batch per encoding to prove
+// they round-trip. False with `error` set when the remap itself is invalid,
+// e.g. a target outside 0..VarUsage::kMaxTrackedVar.
+bool planVarRemap(const FrameData& data, const std::vector<Occurrence>& occurrences, const int* vars,
+                  const VarRemap& remap, RemapPlan& plan, std::string& error);
+
+// Writes the planned raw values. Rows that went stale since planning are
+// skipped. Returns the number of rows written.
+size_t applyRemapPlan(FrameData& data, const std::vector<Occurrence>& occurrences, const RemapPlan& plan);
+
+} // namespace varswap
+
+#endif /* VARSWAP_VAR_REMAP_H_GUARD */
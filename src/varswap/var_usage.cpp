@@ -0,0 +1,167 @@
+#include "varswap/var_usage.h"
+
+#include "varswap/bit_ops.h"
+#include "varswap/var_decode.h"
+
+#include <algorithm>
+
+namespace varswap {
+
+namespace {
+
+constexpr size_t kWordBits = 64;
+constexpr int kCategoryCount = static_cast<int>(VarCategory::Count);
+
+void setBit(std::vector<std::uint64_t>& bits, int varId) {
+    size_t word = static_cast<size_t>(varId) / kWordBits;
+    if (word >= bits.size()) {
+        bits.resize(word + 1, 0);
+    }
+    bits[word] |= std::uint64_t(1) << (static_cast<size_t>(varId) % kWordBits);
+}
+
+std::uint64_t wordAt(const std::vector<std::uint64_t>& bits, size_t word) {
+    return word < bits.size() ? bits[word] : 0;
+}
+
+} // namespace
+
+bool kindReadsVar(OccurrenceKind kind) {
+    const KindLayout& layout = kindLayout(kind);
+    return !layout.isEffect && layout.slots[static_cast<int>(OccurrenceField::ChangeValue)] < 0;
+}
+
+bool kindWritesVar(OccurrenceKind kind) {
+    return !kindReadsVar(kind);
+}
+
+VarCategory varIdSpace(VarCategory category) {
+    return category == VarCategory::ProjectileNoChange ? VarCategory::Projectile : category;
+}
+
+void VarUsage::build(const std::vector<Occurrence>& occurrences, const int* vars) {
+    clear();
+    std::vector<std::uint64_t> read[kCategoryCount];
+    std::vector<std::uint64_t> write[kCategoryCount];
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        int varId = vars[i];
+        if (varId < 0 || varId > kMaxTrackedVar) {
+            continue;
+        }
+        const Occurrence& occ = occurrences[i];
+        int category = static_cast<int>(occ.category);
+        if (kindReadsVar(occ.kind)) {
+            setBit(read[category], varId);
+        }
+        if (kindWritesVar(occ.kind)) {
+            setBit(write[category], varId);
+        }
+    }
+
+    for (int c = 0; c < kCategoryCount; ++c) {
+        Sets& sets = m_sets[c];
+        size_t words = std::max(read[c].size(), write[c].size());
+        sets.readOnly.resize(words);
+        sets.writeOnly.resize(words);
+        sets.readWrite.resize(words);
+        for (size_t w = 0; w < words; ++w) {
+            std::uint64_t r = wordAt(read[c], w);
+            std::uint64_t wr = wordAt(write[c], w);
+            sets.readOnly[w] = r & ~wr;
+            sets.writeOnly[w] = wr & ~r;
+            sets.readWrite[w] = r & wr;
+        }
+    }
+    for (int c = 0; c < kCategoryCount; ++c) {
+        Sets& sets = m_sets[c];
+        for (int other = 0; other < kCategoryCount; ++other) {
+            if (varIdSpace(static_cast<VarCategory>(c)) != varIdSpace(static_cast<VarCategory>(other))) {
+                continue;
+            }
+            const std::vector<std::uint64_t>& r = read[other];
+            const std::vector<std::uint64_t>& wr = write[other];
+            sets.taken.resize(std::max({sets.taken.size(), r.size(), wr.size()}), 0);
+            for (size_t w = 0; w < sets.taken.size(); ++w) {
+                sets.taken[w] |= wordAt(r, w) | wordAt(wr, w);
+            }
+        }
+    }
+}
+
+void VarUsage::build(const FrameData& data, const std::vector<Occurrence>& occurrences) {
+    std::vector<int> vars(occurrences.size());
+    std::vector<int> remainders(occurrences.size());
+    decodeOccurrenceValues(data, occurrences.data(), occurrences.size(), vars.data(), remainders.data());
+    build(occurrences, vars.data());
+}
+
+void VarUsage::clear() {
+    for (Sets& sets : m_sets) {
+        sets = Sets();
+    }
+}
+
+const VarUsage::Sets& VarUsage::sets(VarCategory category) const {
+    int index = static_cast<int>(category);
+    return m_sets[index < kCategoryCount ? index : static_cast<int>(VarCategory::Unknown)];
+}
+
+bool VarUsage::isUsed(VarCategory category, int varId) const {
+    if (varId < 0 || varId > kMaxTrackedVar) {
+        return false;
+    }
+    const Sets& s = sets(category);
+    size_t word = static_cast<size_t>(varId) / kWordBits;
+    std::uint64_t bit = std::uint64_t(1) << (static_cast<size_t>(varId) % kWordBits);
+    return ((wordAt(s.readOnly, word) | wordAt(s.writeOnly, word) | wordAt(s.readWrite, word)) & bit) != 0;
+}
+
+size_t VarUsage::usedCount(VarCategory category) const {
+    const Sets& s = sets(category);
+    size_t count = 0;
+    for (size_t w = 0; w < s.readOnly.size(); ++w) {
+        count += popCount(s.readOnly[w] | s.writeOnly[w] | s.readWrite[w]);
+    }
+    return count;
+}
+
+std::vector<int> VarUsage::findFreeVars(VarCategory category, int count, VarRange range) const {
+    std::vector<int> result;
+    int lo = std::max(range.min, 0);
+    int hi = std::min(range.max, kMaxTrackedVar);
+    if (count <= 0 || lo > hi) {
+        return result;
+    }
+    const std::vector<std::uint64_t>& taken = sets(category).taken;
+    for (size_t word = static_cast<size_t>(lo) / kWordBits; word <= static_cast<size_t>(hi) / kWordBits; ++word) {
+        std::uint64_t free = ~wordAt(taken, word);
+        size_t firstBit = word * kWordBits;
+        if (firstBit < static_cast<size_t>(lo)) {
+            free &= ~std::uint64_t(0) << (static_cast<size_t>(lo) - firstBit);
+        }
+        if (firstBit + kWordBits - 1 > static_cast<size_t>(hi)) {
+            free &= ~std::uint64_t(0) >> (firstBit + kWordBits - 1 - static_cast<size_t>(hi));
+        }
+        while (free) {
+            result.push_back(static_cast<int>(firstBit + countTrailingZeros(free)));
+            if (static_cast<int>(result.size()) == count) {
+                return result;
+            }
+            free &= free - 1;
+        }
+    }
+    return result;
+}
+
+MemoryUsage VarUsage::memoryUsage() const {
+    MemoryUsage usage;
+    for (const Sets& sets : m_sets) {
+        usage.add_vector(sets.readOnly);
+        usage.add_vector(sets.writeOnly);
+        usage.add_vector(sets.readWrite);
+        usage.add_vector(sets.taken);
+    }
+    return usage;
+}
+
+} // namespace varswap
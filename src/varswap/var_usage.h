@@ -0,0 +1,67 @@
+#ifndef VARSWAP_VAR_USAGE_H_GUARD
+#define VARSWAP_VAR_USAGE_H_GUARD
+
+#include "framedata.h"
+#include "varswap/occurrence.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace varswap {
+
+// IF kinds read their var unless they carry a change slot (IF31, IF38);
+// those and every EF kind write it.
+bool kindReadsVar(OccurrenceKind kind);
+bool kindWritesVar(OccurrenceKind kind);
+
+// Categories that name the same ids: ProjectileNoChange is a projectile var
+// touched with a zero delta, so it maps to Projectile.
+VarCategory varIdSpace(VarCategory category);
+
+// Inclusive var id range searched for free ids.
+struct VarRange {
+    int min = 0;
+    int max = 99;
+};
+
+// Per-category bitsets of the var ids a document uses, bit v in word v / 64,
+// split by how the occurrences touch them. Negative ids and ids above
+// kMaxTrackedVar are not tracked.
+class VarUsage {
+public:
+    static constexpr int kMaxTrackedVar = (1 << 20) - 1;
+
+    // `vars` holds the decoded var id of every occurrence (see var_decode.h).
+    void build(const std::vector<Occurrence>& occurrences, const int* vars);
+    void build(const FrameData& data, const std::vector<Occurrence>& occurrences);
+    void clear();
+
+    const std::vector<std::uint64_t>& readOnly(VarCategory category) const { return sets(category).readOnly; }
+    const std::vector<std::uint64_t>& writeOnly(VarCategory category) const { return sets(category).writeOnly; }
+    const std::vector<std::uint64_t>& readWrite(VarCategory category) const { return sets(category).readWrite; }
+    bool isUsed(VarCategory category, int varId) const;
+    size_t usedCount(VarCategory category) const;
+
+    // Up to `count` ids in `range`, ascending, that no occurrence of this
+    // category uses. Projectile and ProjectileNoChange share one id space,
+    // so an id used by either is taken for both.
+    std::vector<int> findFreeVars(VarCategory category, int count, VarRange range = VarRange()) const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct Sets {
+        std::vector<std::uint64_t> readOnly;
+        std::vector<std::uint64_t> writeOnly;
+        std::vector<std::uint64_t> readWrite;
+        std::vector<std::uint64_t> taken; // used by this category or one sharing its ids
+    };
+
+    const Sets& sets(VarCategory category) const;
+
+    Sets m_sets[static_cast<int>(VarCategory::Count)];
+};
+
+} // namespace varswap
+
+#endif /* VARSWAP_VAR_USAGE_H_GUARD */
@@ -1,12 +1,24 @@
 #include "varswap/varswap_pane.h"
 
+#include "varswap/alloc_profile.h"
+#include "varswap/def_use.h"
+#include "varswap/param_index.h"
+#include "varswap/pattern_xref.h"
+#include "varswap/scan_sidecar.h"
+#include "varswap/var_decode.h"
+#include "varswap/var_ranges.h"
+#include "varswap/var_remap.h"
+#include "varswap/var_usage.h"
+
 #include <imgui.h>
 #include <imgui_stdlib.h>
 
 #include <algorithm>
 #include <cctype>
+#include <climits>
 #include <cstdio>
 #include <iomanip>
+#include <iterator>
 #include <map>
 #include <set>
 #include <sstream>
@@ -18,7 +30,7 @@ using namespace varswap;
 namespace {
 
 constexpr float kSummaryListWidth = 190.f;
-constexpr int kFrameJumpOffset = 10000;
+constexpr int kFreeVarSuggestions = 6;
 
 const ImVec4 kPendingColor(0.95f, 0.82f, 0.2f, 1.f);
 const ImVec4 kAppliedColor(0.2f, 0.75f, 0.2f, 1.f);
@@ -90,18 +102,39 @@ bool containsInsensitive(const std::string& haystack, const std::string& needleL
     return hayLower.find(needleLower) != std::string::npos;
 }
 
-std::string formatSequenceLabel(const Sequence& seq, int seqIndex) {
-    std::ostringstream oss;
-    oss << std::setw(3) << std::setfill('0') << seqIndex;
-    oss << std::setfill(' ');
+void appendSequenceLabel(std::string& out, const Sequence& seq, int seqIndex) {
+    char index[16];
+    std::snprintf(index, sizeof(index), "%03d", seqIndex);
+    out += index;
     if (!seq.name.empty()) {
-        oss << " " << seq.name;
+        out.push_back(' ');
+        out.append(seq.name.data(), seq.name.size());
     } else if (!seq.codeName.empty()) {
-        oss << " " << seq.codeName;
+        out.push_back(' ');
+        out.append(seq.codeName.data(), seq.codeName.size());
     } else {
-        oss << " (unnamed)";
+        out += " (unnamed)";
     }
-    return oss.str();
+}
+
+std::string formatSequenceLabel(const Sequence& seq, int seqIndex) {
+    std::string label;
+    appendSequenceLabel(label, seq, seqIndex);
+    return label;
+}
+
+std::string formatIdList(const std::vector<int>& ids, size_t limit = 24) {
+    std::string text;
+    for (size_t i = 0; i < ids.size() && i < limit; ++i) {
+        if (i) {
+            text += ", ";
+        }
+        text += std::to_string(ids[i]);
+    }
+    if (ids.size() > limit) {
+        text += ", ... (" + std::to_string(ids.size()) + " ids)";
+    }
+    return text;
 }
 
 } // namespace
@@ -115,9 +148,40 @@ VarSwapPane::VarSwapPane(FrameData* data)
 }
 
 void VarSwapPane::ForceRescan() {
+    editJournal.clear();
     refreshScan();
 }
 
+bool VarSwapPane::RescanWithSidecar(const std::string& sidecarPath, std::uint64_t contentHash) {
+    editJournal.clear();
+    if (frameData && frameData->m_loaded) {
+        ScanSidecar sidecar;
+        std::string error;
+        bool loaded;
+        {
+            AllocProfiler::Scope phase("sidecar");
+            loaded = readScanSidecar(sidecarPath, contentHash, *frameData, sidecar, error);
+        }
+        if (loaded) {
+            bool hadLabels = !sidecar.labels.empty();
+            adoptSidecar(sidecar);
+            if (!hadLabels && !occurrences.empty()) {
+                // Written by the command line tool; add the labels for next time.
+                writeScanSidecar(sidecarPath, makeSidecar(contentHash), error);
+            }
+            return true;
+        }
+    }
+    refreshScan();
+    if (frameData && frameData->m_loaded) {
+        // A sidecar that cannot be written (read-only folder, ...) only
+        // costs the next load a scan.
+        std::string error;
+        writeScanSidecar(sidecarPath, makeSidecar(contentHash), error);
+    }
+    return false;
+}
+
 void VarSwapPane::Draw() {
     if (!isVisible) {
         return;
@@ -149,6 +213,18 @@ void VarSwapPane::Draw() {
     if (ImGui::Button("Clear Pending")) {
         clearPendingEdits();
     }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(!canUndo());
+    if (ImGui::Button("Undo")) {
+        Undo();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(!canRedo());
+    if (ImGui::Button("Redo")) {
+        Redo();
+    }
+    ImGui::EndDisabled();
 
     ImGui::SameLine();
     ImGui::TextDisabled("%s", infoLabel);
@@ -175,6 +251,16 @@ void VarSwapPane::Draw() {
     ImGui::Checkbox("Projectile globals only", &projectileGlobalsOnly);
     ImGui::SameLine();
     ImGui::Checkbox("Pending List", &showPendingListWindow);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pattern Refs", &showPatternRefsWindow);
+    ImGui::SameLine();
+    ImGui::Checkbox("Spawn Balance", &showSpawnBalanceWindow);
+    ImGui::SameLine();
+    ImGui::Checkbox("Var Ranges", &showVarRangesWindow);
+    ImGui::SameLine();
+    ImGui::Checkbox("Param Search", &showParamSearchWindow);
+    ImGui::SameLine();
+    ImGui::Checkbox("Remap", &showRemapWindow);
 
     if (occurrences.empty()) {
         ImGui::Separator();
@@ -207,21 +293,59 @@ void VarSwapPane::Draw() {
     if (showPendingListWindow) {
         drawPendingListWindow();
     }
+    if (showPatternRefsWindow) {
+        drawPatternRefsWindow();
+    }
+    if (showSpawnBalanceWindow) {
+        drawSpawnBalanceWindow();
+    }
+    if (showVarRangesWindow) {
+        drawVarRangesWindow();
+    }
+    if (showParamSearchWindow) {
+        drawParamSearchWindow();
+    }
+    if (showRemapWindow) {
+        drawRemapWindow();
+    }
 }
 
 void VarSwapPane::refreshScan() {
     invalidateSummaryCache();
     if (!frameData || !frameData->m_loaded) {
         occurrences.clear();
+        varColumn.clear();
+        remainderColumn.clear();
         occurrenceMetadata.clear();
         rowStates.clear();
+        blockTable.clear();
+        paramIndex.clear();
+        varIndex.clear();
+        patternXref.clear();
+        spawnTree.clear();
+        varRanges.clear();
+        paramSearchHits.clear();
         summaryCache.clear();
         summaryCacheVisibleIndices.clear();
         std::snprintf(infoLabel, sizeof(infoLabel), "No file loaded");
         return;
     }
 
-    occurrences = collectOccurrences(*frameData);
+    {
+        AllocProfiler::Scope phase("scan");
+        occurrences = collectOccurrences(*frameData, scanThreads);
+        varIndex.build(*frameData, occurrences);
+    }
+    decodeValueColumns(0, occurrences.size());
+    varUsageDirty = true;
+    defUseDirty = true;
+    varRangesDirty = true;
+    patternXrefDirty = true;
+    spawnTreeDirty = true;
+    blockTable.clear();
+    blockTableDirty = true;
+    paramIndexDirty = true;
+    remapPlanDirty = true;
     ensureRowStateSize();
     rebuildOccurrenceMetadata();
     summaryCache.clear();
@@ -229,6 +353,295 @@ void VarSwapPane::refreshScan() {
     std::snprintf(infoLabel, sizeof(infoLabel), "%zu occurrence(s)", occurrences.size());
 }
 
+void VarSwapPane::adoptSidecar(ScanSidecar& sidecar) {
+    invalidateSummaryCache();
+    blockTable.clear();
+    blockTableDirty = true;
+    occurrences = std::move(sidecar.occurrences);
+    varColumn = std::move(sidecar.vars);
+    remainderColumn = std::move(sidecar.remainders);
+    varIndex.assign(std::move(sidecar.varKeys));
+    varUsageDirty = true;
+    defUseDirty = true;
+    varRangesDirty = true;
+    patternXrefDirty = true;
+    spawnTreeDirty = true;
+    paramIndexDirty = true;
+    remapPlanDirty = true;
+    ensureRowStateSize();
+    if (!restoreOccurrenceMetadata(sidecar.labels)) {
+        rebuildOccurrenceMetadata();
+    }
+    summaryCache.clear();
+    summaryCacheVisibleIndices.clear();
+    std::snprintf(infoLabel, sizeof(infoLabel), "%zu occurrence(s)", occurrences.size());
+}
+
+ScanSidecar VarSwapPane::makeSidecar(std::uint64_t contentHash) const {
+    ScanSidecar sidecar;
+    sidecar.contentHash = contentHash;
+    sidecar.occurrences = occurrences;
+    sidecar.vars = varColumn;
+    sidecar.remainders = remainderColumn;
+    sidecar.varKeys = varIndex.keys();
+    for (const OccurrenceMetadata& meta : occurrenceMetadata) {
+        for (std::string_view text : {meta.patternLabel, meta.nodeLabel, meta.searchLower}) {
+            sidecar.labels.append(text.data(), text.size());
+            sidecar.labels.push_back('\0');
+        }
+    }
+    return sidecar;
+}
+
+MemoryReport VarSwapPane::memoryReport() const {
+    MemoryReport report;
+    MemoryUsage occurrenceUsage;
+    MemoryUsage metadataUsage;
+    MemoryUsage rowStateUsage;
+    MemoryUsage summaryUsage;
+
+    occurrenceUsage.add_vector(occurrences);
+    occurrenceUsage.add_vector(varColumn);
+    occurrenceUsage.add_vector(remainderColumn);
+    metadataUsage.add_vector(occurrenceMetadata);
+    rowStateUsage.add_vector(rowStates);
+
+    int seqCount = frameData ? frameData->get_sequence_count() : 0;
+    report.sequences.resize(seqCount);
+    for (int i = 0; i < seqCount; ++i) {
+        report.sequences[i].index = i;
+        report.sequences[i].shared = frameData->is_sequence_shared(i);
+    }
+
+    // Handles are attributed to their sequence; their strings and row
+    // state go with them.
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        MemoryUsage meta;
+        MemoryUsage state;
+        if (i < occurrenceMetadata.size()) {
+            // Arena-backed: attributed by size, the chunks are counted below.
+            meta.add_inline(occurrenceMetadata[i].patternLabel.size() + 1);
+            meta.add_inline(occurrenceMetadata[i].nodeLabel.size() + 1);
+            meta.add_inline(occurrenceMetadata[i].searchLower.size() + 1);
+        }
+        if (i < rowStates.size()) {
+            state.add_string(rowStates[i].newValue);
+            state.add_string(rowStates[i].statusMessage);
+        }
+        rowStateUsage += state;
+        int seqIndex = occurrences[i].seqIndex;
+        if (seqIndex >= 0 && seqIndex < seqCount) {
+            report.sequences[seqIndex].usage += meta;
+            report.sequences[seqIndex].usage += state;
+        }
+    }
+
+    metadataUsage.add_blocks(metadataArena.chunkCount(), metadataArena.bytesReserved(), metadataArena.bytesUsed());
+
+    summaryUsage.add_vector(summaryCache);
+    summaryUsage.add_vector(summaryCacheVisibleIndices);
+    summaryUsage.add_blocks(summaryArena.chunkCount(), summaryArena.bytesReserved(), summaryArena.bytesUsed());
+    for (const auto& entry : summaryCache) {
+        summaryUsage.add_string(entry.label);
+    }
+
+    report.component("occurrences") = occurrenceUsage;
+    report.component("occurrence metadata") = metadataUsage;
+    report.component("row states") = rowStateUsage;
+    report.component("summary cache") = summaryUsage;
+    report.component("block table") = blockTable.memoryUsage();
+    report.component("param index") = paramIndex.memoryUsage();
+    report.component("var index") = varIndex.memoryUsage();
+    report.component("var usage") = varUsage.memoryUsage();
+    report.component("def-use graph") = defUse.memoryUsage();
+    report.component("pattern xref") = patternXref.memoryUsage();
+    report.component("spawn tree") = spawnTree.memoryUsage();
+    report.component("var ranges") = varRanges.memoryUsage();
+    report.component("edit journal") = editJournal.memoryUsage();
+    return report;
+}
+
+void VarSwapPane::RescanSequences(const std::vector<int>& seqIndices) {
+    rescanSequences(std::set<int>(seqIndices.begin(), seqIndices.end()));
+}
+
+void VarSwapPane::rescanSequences(const std::set<int>& seqIndices) {
+    if (!frameData || !frameData->m_loaded ||
+        rowStates.size() != occurrences.size() || occurrenceMetadata.size() != occurrences.size() ||
+        varColumn.size() != occurrences.size()) {
+        refreshScan();
+        return;
+    }
+
+    AllocProfiler::Scope phase("rescan");
+    invalidateSummaryCache();
+
+    // Collection order within a sequence: by frame, IF blocks before EF
+    // blocks, then by block index. Rows are matched on that key so a block
+    // keeps its row state when the rows around it come and go.
+    auto rowKey = [](const Occurrence& occ) {
+        return (static_cast<std::uint64_t>(occ.frameIndex) << 17) |
+               (static_cast<std::uint64_t>(occ.isEffect() ? 1 : 0) << 16) | occ.blockIndex;
+    };
+    auto bySeq = [](const Occurrence& lhs, const Occurrence& rhs) { return lhs.seqIndex < rhs.seqIndex; };
+
+    bool idsShifted = false;
+    std::vector<Occurrence> fresh;
+    std::vector<RowState> freshStates;
+    std::vector<std::uint32_t> updatedIds;
+    std::string scratch;
+    int seqCount = frameData->get_sequence_count();
+    for (int seqIndex : seqIndices) {
+        if (seqIndex < 0 || seqIndex >= seqCount) {
+            continue;
+        }
+        if (!blockTableDirty) {
+            blockTable.syncSequence(*frameData, seqIndex);
+        }
+        if (!patternXrefDirty) {
+            patternXref.updateSequence(*frameData, seqIndex);
+        }
+        if (!spawnTreeDirty) {
+            spawnTree.updateSequence(*frameData, seqIndex);
+        }
+        fresh.clear();
+        collectSequenceOccurrences(*frameData, seqIndex, fresh);
+
+        Occurrence probe{};
+        probe.seqIndex = seqIndex;
+        auto range = std::equal_range(occurrences.begin(), occurrences.end(), probe, bySeq);
+        size_t first = static_cast<size_t>(range.first - occurrences.begin());
+        size_t oldCount = static_cast<size_t>(range.second - range.first);
+
+        freshStates.clear();
+        freshStates.resize(fresh.size());
+        size_t oldRow = first;
+        for (size_t n = 0; n < fresh.size(); ++n) {
+            std::uint64_t key = rowKey(fresh[n]);
+            while (oldRow < first + oldCount && rowKey(occurrences[oldRow]) < key) {
+                ++oldRow;
+            }
+            if (oldRow < first + oldCount && rowKey(occurrences[oldRow]) == key) {
+                freshStates[n] = std::move(rowStates[oldRow++]);
+            }
+        }
+
+        if (fresh.size() == oldCount) {
+            std::copy(fresh.begin(), fresh.end(), occurrences.begin() + first);
+            std::move(freshStates.begin(), freshStates.end(), rowStates.begin() + first);
+        } else {
+            occurrences.erase(occurrences.begin() + first, occurrences.begin() + first + oldCount);
+            occurrences.insert(occurrences.begin() + first, fresh.begin(), fresh.end());
+            rowStates.erase(rowStates.begin() + first, rowStates.begin() + first + oldCount);
+            rowStates.insert(rowStates.begin() + first, std::make_move_iterator(freshStates.begin()),
+                             std::make_move_iterator(freshStates.end()));
+            occurrenceMetadata.erase(occurrenceMetadata.begin() + first,
+                                     occurrenceMetadata.begin() + first + oldCount);
+            occurrenceMetadata.insert(occurrenceMetadata.begin() + first, fresh.size(), OccurrenceMetadata{});
+            varColumn.erase(varColumn.begin() + first, varColumn.begin() + first + oldCount);
+            varColumn.insert(varColumn.begin() + first, fresh.size(), 0);
+            remainderColumn.erase(remainderColumn.begin() + first, remainderColumn.begin() + first + oldCount);
+            remainderColumn.insert(remainderColumn.begin() + first, fresh.size(), 0);
+            idsShifted = true;
+        }
+        decodeValueColumns(first, fresh.size());
+        for (size_t n = 0; n < fresh.size(); ++n) {
+            fillOccurrenceMetadata(first + n, scratch);
+            updatedIds.push_back(static_cast<std::uint32_t>(first + n));
+        }
+    }
+
+    // Spliced labels are appended to the arena; the strings they replaced
+    // stay until the next full rebuild, which runs once they dominate.
+    if (metadataArena.bytesUsed() > 2 * metadataBytesAtRebuild + 64 * 1024) {
+        rebuildOccurrenceMetadata();
+    }
+    varUsageDirty = true;
+    paramIndexDirty = true;
+    remapPlanDirty = true;
+    if (!defUseDirty) {
+        for (int seqIndex : seqIndices) {
+            defUse.updateSequence(*frameData, occurrences, varColumn.data(), seqIndex);
+        }
+    }
+    if (!varRangesDirty) {
+        for (int seqIndex : seqIndices) {
+            varRanges.updateSequence(*frameData, seqIndex);
+        }
+    }
+    if (idsShifted) {
+        varIndex.build(*frameData, occurrences);
+    } else {
+        for (std::uint32_t id : updatedIds) {
+            varIndex.update(*frameData, occurrences, id);
+        }
+    }
+    std::snprintf(infoLabel, sizeof(infoLabel), "%zu occurrence(s)", occurrences.size());
+}
+
+void VarSwapPane::decodeValueColumns(size_t first, size_t count) {
+    varColumn.resize(occurrences.size());
+    remainderColumn.resize(occurrences.size());
+    decodeOccurrenceValues(*frameData, occurrences.data() + first, count, varColumn.data() + first,
+                           remainderColumn.data() + first);
+}
+
+const VarUsage& VarSwapPane::currentVarUsage() {
+    if (varUsageDirty) {
+        varUsage.build(occurrences, varColumn.data());
+        varUsageDirty = false;
+    }
+    return varUsage;
+}
+
+DefUseGraph& VarSwapPane::currentDefUse() {
+    if (defUseDirty) {
+        defUse.build(*frameData, occurrences, varColumn.data());
+        defUseDirty = false;
+    }
+    return defUse;
+}
+
+const PatternXref& VarSwapPane::currentPatternXref() {
+    if (patternXrefDirty) {
+        patternXref.build(*frameData);
+        patternXrefDirty = false;
+    }
+    return patternXref;
+}
+
+SpawnTree& VarSwapPane::currentSpawnTree() {
+    if (spawnTreeDirty) {
+        spawnTree.build(*frameData);
+        spawnTreeDirty = false;
+    }
+    return spawnTree;
+}
+
+VarRangeAnalysis& VarSwapPane::currentVarRanges() {
+    if (varRangesDirty) {
+        varRanges.build(*frameData);
+        varRangesDirty = false;
+    }
+    return varRanges;
+}
+
+const BlockTable& VarSwapPane::currentBlockTable() {
+    if (blockTableDirty) {
+        blockTable.build(*frameData);
+        blockTableDirty = false;
+    }
+    return blockTable;
+}
+
+const ParamIndex& VarSwapPane::currentParamIndex() {
+    if (paramIndexDirty) {
+        paramIndex.build(currentBlockTable());
+        paramIndexDirty = false;
+    }
+    return paramIndex;
+}
+
 void VarSwapPane::ensureRowStateSize() {
     rowStates.assign(occurrences.size(), RowState{});
 }
@@ -270,7 +683,7 @@ bool VarSwapPane::matchesFilters(size_t index, const std::string& needleLower) {
     if (projectileGlobalsOnly && !meta.isGlobalProjectile) {
         return false;
     }
-    if (!needleLower.empty() && meta.searchLower.find(needleLower) == std::string::npos) {
+    if (!needleLower.empty() && meta.searchLower.find(needleLower) == std::string_view::npos) {
         return false;
     }
     return true;
@@ -364,19 +777,19 @@ void VarSwapPane::drawSummary(const std::vector<int>& visibleIndices) {
 }
 
 std::vector<VarSwapPane::SummaryEntry> VarSwapPane::buildSummaryEntries(const std::vector<int>& visibleIndices) {
-    std::unordered_map<std::uint64_t, SummaryEntry> summaryMap;
+    std::pmr::unordered_map<std::uint64_t, SummaryEntry> summaryMap(&summaryArena);
     summaryMap.reserve(visibleIndices.size());
 
     for (int row : visibleIndices) {
         const auto& occ = occurrences[row];
         const auto& meta = metaFor(static_cast<size_t>(row));
-        int varId = currentVar(occ);
+        int varId = varColumn[row];
         bool hasNumericVarId = categoryUsesNumericVarId(occ.category);
         int summaryVarId = hasNumericVarId ? varId : 0;
 
         bool keyIsGlobal = (occ.category == VarCategory::Projectile) && meta.isGlobalProjectile;
         std::uint64_t key = makeSummaryKey(summaryVarId, occ.category, keyIsGlobal);
-        auto& entry = summaryMap[key];
+        auto& entry = summaryMap.try_emplace(key, &summaryArena).first->second;
         entry.varId = summaryVarId;
         entry.hasNumericVarId = hasNumericVarId;
         entry.count++;
@@ -417,6 +830,9 @@ std::vector<VarSwapPane::SummaryEntry> VarSwapPane::buildSummaryEntries(const st
 
 std::vector<VarSwapPane::SummaryEntry>& VarSwapPane::getSummaryEntries(const std::vector<int>& visibleIndices) {
     if (summaryCacheDirty || summaryCacheVisibleIndices != visibleIndices) {
+        AllocProfiler::Scope phase("summary");
+        summaryCache.clear();
+        summaryArena.reset();
         summaryCache = buildSummaryEntries(visibleIndices);
         summaryCacheVisibleIndices = visibleIndices;
         summaryCacheDirty = false;
@@ -510,6 +926,19 @@ void VarSwapPane::drawVarDetailPanel(SummaryEntry* entry) {
         ImGui::TextColored(ImVec4(0.95f, 0.75f, 0.3f, 1.f), "%s", description.c_str());
     }
     ImGui::Text("Occurrences: %d", entry->count);
+    if (entry->hasNumericVarId) {
+        DefUseGraph& graph = currentDefUse();
+        if (!graph.isWritten(entry->category, entry->varId)) {
+            ImGui::TextColored(kPendingColor, "Read but never written in this file.");
+        } else if (!graph.isRead(entry->category, entry->varId)) {
+            ImGui::TextColored(kPendingColor, "Written but never read in this file.");
+        } else {
+            size_t unreached = graph.unreachedReaders(entry->category, entry->varId).size();
+            if (unreached > 0) {
+                ImGui::TextColored(kPendingColor, "%zu reading pattern(s) no writer can jump into.", unreached);
+            }
+        }
+    }
     if (entry->globalOpCount > 0) {
         ImGui::Text("Projectile globals: %d (+%d / -%d)", entry->globalOpCount, entry->globalIncreaseTotal, entry->globalDecreaseTotal);
     }
@@ -534,6 +963,23 @@ void VarSwapPane::drawGlobalReplaceControls(const SummaryEntry* entry) {
     ImGui::SetNextItemWidth(-1);
     ImGui::InputText("##GlobalReplaceInput", &globalReplaceInput, ImGuiInputTextFlags_CharsDecimal);
 
+    std::vector<int> freeVars = currentVarUsage().findFreeVars(entry->category, kFreeVarSuggestions);
+    if (freeVars.empty()) {
+        ImGui::TextDisabled("No free %s ids in 0..99.", categoryLabel(entry->category));
+    } else {
+        ImGui::TextDisabled("Free:");
+        ImGui::PushID("free_vars");
+        for (int varId : freeVars) {
+            ImGui::SameLine();
+            ImGui::PushID(varId);
+            if (ImGui::SmallButton(std::to_string(varId).c_str())) {
+                globalReplaceInput = std::to_string(varId);
+            }
+            ImGui::PopID();
+        }
+        ImGui::PopID();
+    }
+
     bool canApply = entry && !globalReplaceInput.empty();
     ImGui::BeginDisabled(!canApply);
     if (ImGui::Button("Apply to Entire File")) {
@@ -594,7 +1040,7 @@ VarSwapPane::SummaryEntry* VarSwapPane::findSummaryEntryByKey(std::uint64_t key)
     return nullptr;
 }
 
-const std::vector<std::pair<int, int>>& VarSwapPane::ensureSortedPatterns(SummaryEntry& entry) {
+const std::pmr::vector<std::pair<int, int>>& VarSwapPane::ensureSortedPatterns(SummaryEntry& entry) {
     if (!entry.patternsDirty) {
         return entry.sortedPatterns;
     }
@@ -610,39 +1056,93 @@ const std::vector<std::pair<int, int>>& VarSwapPane::ensureSortedPatterns(Summar
 }
 
 void VarSwapPane::rebuildOccurrenceMetadata() {
+    AllocProfiler::Scope phase("metadata");
     occurrenceMetadata.clear();
+    metadataArena.reset();
     occurrenceMetadata.resize(occurrences.size());
+    std::string scratch;
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        fillOccurrenceMetadata(i, scratch);
+    }
+    metadataBytesAtRebuild = metadataArena.bytesUsed();
+}
+
+// Points the metadata at one arena copy of a sidecar's label blob instead of
+// formatting every label again. False when the blob does not cover every
+// occurrence; the global fields come from the var index keys and columns.
+bool VarSwapPane::restoreOccurrenceMetadata(const std::string& labels) {
+    AllocProfiler::Scope phase("metadata");
+    if (labels.empty() && !occurrences.empty()) {
+        return false;
+    }
+    occurrenceMetadata.clear();
+    metadataArena.reset();
+    occurrenceMetadata.resize(occurrences.size());
+    std::string_view blob = metadataArena.copy(labels);
+    const auto& keys = varIndex.keys();
+    size_t pos = 0;
+    auto next = [&blob, &pos](std::string_view& out) {
+        size_t end = blob.find('\0', pos);
+        if (end == std::string_view::npos) {
+            return false;
+        }
+        out = blob.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    };
     for (size_t i = 0; i < occurrences.size(); ++i) {
-        const auto& occ = occurrences[i];
         auto& meta = occurrenceMetadata[i];
-        meta.patternLabel = buildPatternLabel(occ);
-        meta.nodeLabel = buildNodeLabel(occ);
-            int varId = currentVar(occ);
+        if (!next(meta.patternLabel) || !next(meta.nodeLabel) || !next(meta.searchLower)) {
+            return false;
+        }
+        meta.isGlobalProjectile = i < keys.size() && VarIndex::isGlobalKey(keys[i]);
+        if (meta.isGlobalProjectile) {
+            meta.globalVar = varColumn[i];
+            meta.globalDelta = remainderColumn[i];
+            meta.globalDecrement = occurrences[i].kind == OccurrenceKind::EfType6No101;
+        }
+    }
+    metadataBytesAtRebuild = metadataArena.bytesUsed();
+    return pos == blob.size();
+}
+
+void VarSwapPane::fillOccurrenceMetadata(size_t index, std::string& scratch) {
+        const auto& occ = occurrences[index];
+        auto& meta = occurrenceMetadata[index];
+        scratch.clear();
+        appendPatternLabel(scratch, occ);
+        meta.patternLabel = metadataArena.copy(scratch);
+        scratch.clear();
+        appendNodeLabel(scratch, occ);
+        meta.nodeLabel = metadataArena.copy(scratch);
+            int varId = varColumn[index];
             bool modifiesGlobalRegister = isProjectileGlobalOp(occ);
             meta.isGlobalProjectile = modifiesGlobalRegister;
             meta.globalDecrement = meta.isGlobalProjectile && (occ.kind == OccurrenceKind::EfType6No101);
             if (meta.isGlobalProjectile) {
                 meta.globalVar = varId;
-                meta.globalDelta = compositeRemainder(occ);
+                meta.globalDelta = remainderColumn[index];
             } else {
                 meta.globalVar = 0;
                 meta.globalDelta = 0;
                 meta.globalDecrement = false;
             }
 
-            std::string searchBlob = meta.patternLabel;
-            searchBlob.push_back(' ');
-            searchBlob += meta.nodeLabel;
-            searchBlob.push_back(' ');
-            searchBlob += std::to_string(varId);
+            scratch.assign(meta.patternLabel);
+            scratch.push_back(' ');
+            scratch += meta.nodeLabel;
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), " %d", varId);
+            scratch += buf;
             if (meta.isGlobalProjectile) {
-                char buf[64];
                 std::snprintf(buf, sizeof(buf), "global v%d %c%02d", meta.globalVar, meta.globalDecrement ? '-' : '+', meta.globalDelta);
-                searchBlob.push_back(' ');
-                searchBlob += buf;
+                scratch.push_back(' ');
+                scratch += buf;
             }
-            meta.searchLower = toLower(searchBlob);
-    }
+            std::transform(scratch.begin(), scratch.end(), scratch.begin(), [](unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            meta.searchLower = metadataArena.copy(scratch);
 }
 
 const VarSwapPane::OccurrenceMetadata& VarSwapPane::metaFor(size_t index) const {
@@ -662,7 +1162,7 @@ void VarSwapPane::sortOccurrenceIndices(std::vector<int>& indices, const ImGuiTa
         const auto& lhs = occurrences[lhsIndex];
         const auto& rhs = occurrences[rhsIndex];
 
-        auto compareStrings = [](const std::string& a, const std::string& b) {
+        auto compareStrings = [](std::string_view a, std::string_view b) {
             if (a == b) {
                 return 0;
             }
@@ -674,7 +1174,7 @@ void VarSwapPane::sortOccurrenceIndices(std::vector<int>& indices, const ImGuiTa
             int delta = 0;
             switch (spec.ColumnUserID) {
                 case OccColumnVar:
-                    delta = currentVar(lhs) - currentVar(rhs);
+                    delta = varColumn[lhsIndex] - varColumn[rhsIndex];
                     break;
                 case OccColumnCategory:
                     delta = static_cast<int>(lhs.category) - static_cast<int>(rhs.category);
@@ -692,8 +1192,8 @@ void VarSwapPane::sortOccurrenceIndices(std::vector<int>& indices, const ImGuiTa
                     delta = 0;
                     break;
                 case OccColumnRaw: {
-                    int lhsVal = lhs.valuePtr ? *lhs.valuePtr : 0;
-                    int rhsVal = rhs.valuePtr ? *rhs.valuePtr : 0;
+                    int lhsVal = rawValue(*frameData, lhs);
+                    int rhsVal = rawValue(*frameData, rhs);
                     delta = lhsVal - rhsVal;
                     break;
                 }
@@ -748,14 +1248,14 @@ void VarSwapPane::drawTable(const std::vector<int>& visibleIndices) {
                 int index = sortedIndices[row];
                 auto& occ = occurrences[index];
                 RowState& state = rowStates[index];
-                int varId = currentVar(occ);
-                int rawValue = occ.valuePtr ? *occ.valuePtr : 0;
+                int varId = varColumn[index];
+                int raw = rawValue(*frameData, occ);
                 const auto& meta = metaFor(index);
                 bool highlight = false;
                 if (selectedEntry) {
                     if (occ.category == selectedEntry->category) {
                         if (selectedEntry->hasNumericVarId) {
-                            if (currentVar(occ) == selectedEntry->varId) {
+                            if (varId == selectedEntry->varId) {
                                 if (selectedEntry->category == VarCategory::Projectile) {
                                     if (selectedEntry->isProjectileGlobal == meta.isGlobalProjectile) {
                                         highlight = true;
@@ -793,13 +1293,13 @@ void VarSwapPane::drawTable(const std::vector<int>& visibleIndices) {
                 ImGui::TextUnformatted(categoryLabel(occ.category));
 
                 ImGui::TableSetColumnIndex(3);
-                ImGui::TextUnformatted(meta.patternLabel.c_str());
+                ImGui::TextUnformatted(meta.patternLabel.data(), meta.patternLabel.data() + meta.patternLabel.size());
 
                 ImGui::TableSetColumnIndex(4);
                 ImGui::Text("%d", occ.frameIndex);
 
                 ImGui::TableSetColumnIndex(5);
-                ImGui::TextUnformatted(meta.nodeLabel.c_str());
+                ImGui::TextUnformatted(meta.nodeLabel.data(), meta.nodeLabel.data() + meta.nodeLabel.size());
                 if (meta.isGlobalProjectile) {
                     ImGui::SameLine(0.f, ImGui::GetStyle().ItemInnerSpacing.x);
                     ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.95f, 0.8f, 0.3f, 1.f));
@@ -811,13 +1311,13 @@ void VarSwapPane::drawTable(const std::vector<int>& visibleIndices) {
                 drawParameterControls(index, occ, state);
 
                 ImGui::TableSetColumnIndex(7);
-                if (occ.encoding == ValueEncoding::TensComposite) {
-                    ImGui::Text("%d (d=%d)", rawValue, compositeRemainder(occ));
-                } else if (occ.encoding == ValueEncoding::HundredsComposite) {
+                if (occ.encoding() == ValueEncoding::TensComposite) {
+                    ImGui::Text("%d (d=%d)", raw, remainderColumn[index]);
+                } else if (occ.encoding() == ValueEncoding::HundredsComposite) {
                     char sign = (occ.kind == OccurrenceKind::EfType6No101) ? '-' : '+';
-                    ImGui::Text("%d (%c%02d)", rawValue, sign, compositeRemainder(occ));
+                    ImGui::Text("%d (%c%02d)", raw, sign, remainderColumn[index]);
                 } else {
-                    ImGui::Text("%d", rawValue);
+                    ImGui::Text("%d", raw);
                 }
 
                 ImGui::TableSetColumnIndex(8);
@@ -852,6 +1352,309 @@ void VarSwapPane::drawTable(const std::vector<int>& visibleIndices) {
     }
 }
 
+void VarSwapPane::drawPatternRefsWindow() {
+    ImGui::SetNextWindowSize(ImVec2(460.f, 360.f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Pattern References", &showPatternRefsWindow)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SetNextItemWidth(-1);
+    drawPatternCombo("##PatternRefsTarget", &patternRefsTarget);
+    const auto& refs = currentPatternXref().referencesTo(patternRefsTarget);
+    if (refs.empty()) {
+        ImGui::TextDisabled("Nothing jumps to or spawns this pattern.");
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("%zu reference(s)", refs.size());
+    ImGui::Separator();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("PatternRefsTable", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Pattern");
+        ImGui::TableSetupColumn("Frame", ImGuiTableColumnFlags_WidthFixed, 50.f);
+        ImGui::TableSetupColumn("Source");
+        ImGui::TableSetupColumn("Slot", ImGuiTableColumnFlags_WidthFixed, 40.f);
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(refs.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const PatternRef& ref = refs[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(sequenceDisplayName(ref.seqIndex).c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%d", ref.frameIndex);
+                ImGui::TableSetColumnIndex(2);
+                if (ref.blockIndex >= 0) {
+                    ImGui::Text("%s #%d", patternRefSourceLabel(ref.source), ref.blockIndex);
+                } else {
+                    ImGui::TextUnformatted(patternRefSourceLabel(ref.source));
+                }
+                ImGui::TableSetColumnIndex(3);
+                if (ref.slot >= 0) {
+                    ImGui::Text("%d", ref.slot);
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+void VarSwapPane::drawSpawnBalanceWindow() {
+    ImGui::SetNextWindowSize(ImVec2(520.f, 360.f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Spawn Balance", &showSpawnBalanceWindow)) {
+        ImGui::End();
+        return;
+    }
+
+    SpawnTree& tree = currentSpawnTree();
+    auto imbalances = tree.imbalances();
+    if (imbalances.empty()) {
+        ImGui::TextDisabled("Every spawn tree leaves the global projectile registers balanced.");
+        ImGui::End();
+        return;
+    }
+    ImGui::TextWrapped("%zu spawn tree register(s) whose EF6 #100/#101 changes do not cancel out.", imbalances.size());
+    ImGui::Separator();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("SpawnBalanceTable", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Root");
+        ImGui::TableSetupColumn("Register", ImGuiTableColumnFlags_WidthFixed, 60.f);
+        ImGui::TableSetupColumn("Net", ImGuiTableColumnFlags_WidthFixed, 60.f);
+        ImGui::TableSetupColumn("Spawn path");
+        ImGui::TableHeadersRow();
+        std::string path;
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(imbalances.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const SpawnImbalance& entry = imbalances[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(sequenceDisplayName(entry.root).c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("V%d", entry.var);
+                ImGui::TableSetColumnIndex(2);
+                if (entry.unbounded) {
+                    ImGui::TextColored(kPendingColor, "%+d/loop", entry.net);
+                } else {
+                    ImGui::Text("%+d", entry.net);
+                }
+                ImGui::TableSetColumnIndex(3);
+                path.clear();
+                for (int seqIndex : tree.imbalancePath(entry.root, entry.var)) {
+                    if (!path.empty()) {
+                        path += " > ";
+                    }
+                    path += std::to_string(seqIndex);
+                }
+                ImGui::TextUnformatted(path.c_str());
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+void VarSwapPane::drawVarRangesWindow() {
+    ImGui::SetNextWindowSize(ImVec2(560.f, 420.f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Var Ranges", &showVarRangesWindow)) {
+        ImGui::End();
+        return;
+    }
+
+    VarRangeAnalysis& analysis = currentVarRanges();
+    auto checks = analysis.decidedChecks();
+    auto deadWrites = analysis.deadWrites();
+    auto formatBound = [](int value) { return value == INT_MIN ? std::string("-inf") : value == INT_MAX ? std::string("inf") : std::to_string(value); };
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+
+    ImGui::Text("Comparisons with a fixed outcome: %zu", checks.size());
+    if (!checks.empty() && ImGui::BeginTable("VarRangeChecks", 5, flags, ImVec2(0.f, ImGui::GetContentRegionAvail().y * 0.55f))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Pattern");
+        ImGui::TableSetupColumn("Frame", ImGuiTableColumnFlags_WidthFixed, 50.f);
+        ImGui::TableSetupColumn("Check");
+        ImGui::TableSetupColumn("Range");
+        ImGui::TableSetupColumn("Outcome");
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(checks.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const CheckFinding& check = checks[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(sequenceDisplayName(check.seqIndex).c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%d", check.frameIndex);
+                ImGui::TableSetColumnIndex(2);
+                const char* op = check.compareMode == 0 ? ">" : check.compareMode == 1 ? "<" : "==";
+                ImGui::Text("IF #%d: V%s %s %d", check.blockIndex, formatVarLabel(check.var).c_str(), op, check.compareValue);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("[%s, %s]", formatBound(check.range.lo).c_str(), formatBound(check.range.hi).c_str());
+                ImGui::TableSetColumnIndex(4);
+                ImGui::TextColored(kPendingColor, "%s", checkVerdictLabel(check.verdict));
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Writes overwritten before any read: %zu", deadWrites.size());
+    if (!deadWrites.empty() && ImGui::BeginTable("VarRangeDeadWrites", 3, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Pattern");
+        ImGui::TableSetupColumn("Frame", ImGuiTableColumnFlags_WidthFixed, 50.f);
+        ImGui::TableSetupColumn("Write");
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(deadWrites.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const DeadWrite& write = deadWrites[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(sequenceDisplayName(write.seqIndex).c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%d", write.frameIndex);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%s #%d: V%s", write.isEffect ? "EF" : "IF", write.blockIndex, formatVarLabel(write.var).c_str());
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+void VarSwapPane::drawParamSearchWindow() {
+    ImGui::SetNextWindowSize(ImVec2(480.f, 380.f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Parameter Search", &showParamSearchWindow)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SetNextItemWidth(-1);
+    bool changed = ImGui::InputTextWithHint("##ParamQuery", "ef 3 p2=450, ef 6#105 p0=10..29, if 40 p1=12",
+                                            &paramSearchText);
+    // Hits hold block indices, so a rescan that dirties the index re-runs them.
+    if (changed || (paramIndexDirty && !paramSearchText.empty() && paramSearchError.empty())) {
+        paramSearchHits.clear();
+        paramSearchError.clear();
+        if (!paramSearchText.empty() && parseParamQuery(paramSearchText, paramSearchQuery, paramSearchError)) {
+            paramSearchHits = currentParamIndex().find(paramSearchQuery);
+        }
+    }
+    if (paramSearchText.empty()) {
+        ImGui::TextDisabled("Matches any IF or EF parameter, tracked or not.");
+        ImGui::End();
+        return;
+    }
+    if (!paramSearchError.empty()) {
+        ImGui::TextColored(kErrorColor, "%s", paramSearchError.c_str());
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("%zu block(s)", paramSearchHits.size());
+    ImGui::Separator();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("ParamSearchTable", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Pattern");
+        ImGui::TableSetupColumn("Frame", ImGuiTableColumnFlags_WidthFixed, 50.f);
+        ImGui::TableSetupColumn("Block", ImGuiTableColumnFlags_WidthFixed, 90.f);
+        ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthFixed, 70.f);
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(paramSearchHits.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const ParamHit& hit = paramSearchHits[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(sequenceDisplayName(hit.seqIndex).c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%d", hit.frameIndex);
+                ImGui::TableSetColumnIndex(2);
+                if (paramSearchQuery.isEffect) {
+                    ImGui::Text("EF #%d (%d)", hit.blockIndex, hit.number);
+                } else {
+                    ImGui::Text("IF #%d", hit.blockIndex);
+                }
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%d", hit.value);
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+void VarSwapPane::drawRemapWindow() {
+    ImGui::SetNextWindowSize(ImVec2(480.f, 240.f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Var Remap", &showRemapWindow)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SetNextItemWidth(-1);
+    bool changed = ImGui::InputTextWithHint("##RemapRule", "projectile 10..29 +40, extra 5..7 =9,8,7, dash 0..3 *2+10",
+                                            &remapText);
+    // The plan holds occurrence ids, so any rescan re-plans it.
+    if (changed || remapPlanDirty) {
+        remapPlan = RemapPlan();
+        remapError.clear();
+        remapPlanDirty = false;
+        if (changed) {
+            remapStatus.clear();
+        }
+        VarRemap remap;
+        if (!remapText.empty() && parseVarRemap(remapText, remap, remapError)) {
+            planVarRemap(*frameData, occurrences, varColumn.data(), remap, remapPlan, remapError);
+        }
+    }
+    if (remapText.empty()) {
+        ImGui::TextDisabled("Moves every id of a category in min..max; other ids stay.");
+    } else if (!remapError.empty()) {
+        ImGui::TextColored(kErrorColor, "%s", remapError.c_str());
+    } else {
+        ImGui::Text("%zu occurrence(s) to remap", remapPlan.ids.size());
+        if (!remapPlan.unencodable.empty()) {
+            ImGui::TextColored(kErrorColor, "%zu occurrence(s) cannot hold their new id.",
+                               remapPlan.unencodable.size());
+        }
+        if (!remapPlan.merged.empty()) {
+            ImGui::TextColored(kPendingColor, "Reached from several ids: %s",
+                               formatIdList(remapPlan.merged).c_str());
+        }
+        if (!remapPlan.collisions.empty()) {
+            ImGui::TextColored(kPendingColor, "Already used: %s", formatIdList(remapPlan.collisions).c_str());
+        }
+        if (!remapPlan.clean()) {
+            ImGui::Checkbox("Allow collisions", &remapAllowCollisions);
+        }
+        bool blocked = remapPlan.ids.empty() || !remapPlan.unencodable.empty() ||
+                       (!remapPlan.clean() && !remapAllowCollisions);
+        ImGui::BeginDisabled(blocked);
+        if (ImGui::Button("Apply Remap")) {
+            applyRemap();
+        }
+        ImGui::EndDisabled();
+    }
+    if (!remapStatus.empty()) {
+        ImGui::TextDisabled("%s", remapStatus.c_str());
+    }
+    ImGui::End();
+}
+
 void VarSwapPane::drawPendingListWindow() {
     if (!ImGui::Begin("Pending Actions", &showPendingListWindow)) {
         ImGui::End();
@@ -872,7 +1675,8 @@ void VarSwapPane::drawPendingListWindow() {
         const auto& meta = metaFor(i);
         std::string desc = describePendingAction(i);
         ImGui::PushStyleColor(ImGuiCol_Text, kPendingColor);
-        ImGui::Text("%03d | %s | %s", occ.seqIndex, meta.patternLabel.c_str(), categoryLabel(occ.category));
+        ImGui::Text("%03d | %.*s | %s", occ.seqIndex, static_cast<int>(meta.patternLabel.size()), meta.patternLabel.data(),
+                    categoryLabel(occ.category));
         ImGui::PopStyleColor();
         ImGui::TextDisabled("%s", desc.c_str());
         ImGui::Separator();
@@ -915,13 +1719,13 @@ std::string VarSwapPane::describePendingAction(size_t index) const {
 
     bool recordedValueChange = false;
     if (!state.newValue.empty()) {
-        int before = currentVar(occ);
+        int before = currentVar(*frameData, occ);
         int afterValue = parseInt(state.newValue, before);
         appendChange("Value", toString(before), toString(afterValue));
         recordedValueChange = true;
     }
     if (state.amountPending) {
-        int before = currentVar(occ);
+        int before = currentVar(*frameData, occ);
         appendChange(recordedValueChange ? "Amount" : "Value", toString(before), toString(state.amountValue));
         recordedValueChange = true;
     }
@@ -929,24 +1733,24 @@ std::string VarSwapPane::describePendingAction(size_t index) const {
         int before = currentDeltaValue(occ);
         appendChange("Delta", toString(before), toString(state.deltaValue));
     }
-    if (state.compareValuePending && occ.compareValuePtr) {
-        appendChange("Compare value", toString(*occ.compareValuePtr), toString(state.compareValue));
+    if (state.compareValuePending && occ.hasField(OccurrenceField::CompareValue)) {
+        appendChange("Compare value", toString(readField(*frameData, occ, OccurrenceField::CompareValue)), toString(state.compareValue));
     }
-    if (state.compareModePending && occ.compareModePtr) {
-        appendChange("Compare mode", toString(*occ.compareModePtr), toString(state.compareMode));
+    if (state.compareModePending && occ.hasField(OccurrenceField::CompareMode)) {
+        appendChange("Compare mode", toString(readField(*frameData, occ, OccurrenceField::CompareMode)), toString(state.compareMode));
     }
-    if (state.changeValuePending && occ.changeValuePtr) {
-        appendChange("Change value", toString(*occ.changeValuePtr), toString(state.changeValue));
+    if (state.changeValuePending && occ.hasField(OccurrenceField::ChangeValue)) {
+        appendChange("Change value", toString(readField(*frameData, occ, OccurrenceField::ChangeValue)), toString(state.changeValue));
     }
-    if (state.changeModePending && occ.changeModePtr) {
-        appendChange("Change mode", toString(*occ.changeModePtr), toString(state.changeMode));
+    if (state.changeModePending && occ.hasField(OccurrenceField::ChangeMode)) {
+        appendChange("Change mode", toString(readField(*frameData, occ, OccurrenceField::ChangeMode)), toString(state.changeMode));
     }
     if (state.jumpTargetPending) {
         int beforeValue = 0;
         bool beforeIsFrame = true;
         decodeJumpTarget(occ, beforeValue, beforeIsFrame);
         std::string before = beforeIsFrame ? ("Frame " + toString(beforeValue)) : ("Pattern " + toString(beforeValue));
-        std::string after = (state.jumpTargetIsFrame || !occ.jumpTargetSupportsPattern)
+        std::string after = (state.jumpTargetIsFrame || !occ.jumpTargetSupportsPattern())
             ? ("Frame " + toString(state.jumpTargetValue))
             : ("Pattern " + toString(state.jumpTargetValue));
         appendChange("Jump", before, after);
@@ -963,8 +1767,16 @@ void VarSwapPane::applyPendingChanges() {
         return;
     }
 
+    AllocProfiler::Scope phase("apply");
+
     bool appliedAny = false;
     std::set<int> touchedPatterns;
+    bool journaled = usesEditJournal();
+    if (journaled) {
+        editJournal.beginGroup();
+    } else {
+        editJournal.clear();
+    }
     for (size_t i = 0; i < occurrences.size(); ++i) {
         if (i >= rowStates.size()) {
             break;
@@ -978,11 +1790,14 @@ void VarSwapPane::applyPendingChanges() {
         bool success = true;
         std::string errorMessage;
         bool modifiedRow = false;
+        ParamSnapshot before;
 
         auto captureUndo = [&]() {
-            if (!touchedPatterns.count(occ.seqIndex)) {
+            if (journaled && !before.taken) {
+                EditJournal::snapshot(*frameData, occ, before);
+            }
+            if (touchedPatterns.insert(occ.seqIndex).second && !journaled) {
                 saveUndoState(occ.seqIndex);
-                touchedPatterns.insert(occ.seqIndex);
             }
         };
 
@@ -995,12 +1810,12 @@ void VarSwapPane::applyPendingChanges() {
                 errorMessage = "Invalid";
             }
             if (success) {
-                if (!occ.valuePtr) {
+                if (!resolveField(*frameData, occ, OccurrenceField::Value)) {
                     success = false;
-                    errorMessage = "Read-only";
+                    errorMessage = isStale(*frameData, occ) ? "Stale" : "Read-only";
                 } else {
                     captureUndo();
-                    applyVarChange(occ, newValue);
+                    applyVarChange(*frameData, occ, newValue);
                     state.newValue.clear();
                     modifiedRow = true;
                 }
@@ -1020,9 +1835,9 @@ void VarSwapPane::applyPendingChanges() {
         }
 
         if (success && state.amountPending) {
-            if (supportsAmountEdit(occ) && occ.valuePtr) {
+            if (supportsAmountEdit(occ) && resolveField(*frameData, occ, OccurrenceField::Value)) {
                 captureUndo();
-                applyVarChange(occ, state.amountValue);
+                applyVarChange(*frameData, occ, state.amountValue);
                 state.amountPending = false;
                 modifiedRow = true;
             } else {
@@ -1032,14 +1847,11 @@ void VarSwapPane::applyPendingChanges() {
         }
 
         if (success && state.compareValuePending) {
-            if (occ.compareValuePtr) {
+            if (resolveField(*frameData, occ, OccurrenceField::CompareValue)) {
                 captureUndo();
-                *occ.compareValuePtr = state.compareValue;
+                writeField(*frameData, occ, OccurrenceField::CompareValue, state.compareValue);
                 state.compareValuePending = false;
                 modifiedRow = true;
-                if (occ.sequence) {
-                    occ.sequence->modified = true;
-                }
             } else {
                 success = false;
                 errorMessage = "Compare unsupported";
@@ -1047,14 +1859,11 @@ void VarSwapPane::applyPendingChanges() {
         }
 
         if (success && state.compareModePending) {
-            if (occ.compareModePtr) {
+            if (resolveField(*frameData, occ, OccurrenceField::CompareMode)) {
                 captureUndo();
-                *occ.compareModePtr = state.compareMode;
+                writeField(*frameData, occ, OccurrenceField::CompareMode, state.compareMode);
                 state.compareModePending = false;
                 modifiedRow = true;
-                if (occ.sequence) {
-                    occ.sequence->modified = true;
-                }
             } else {
                 success = false;
                 errorMessage = "Mode unsupported";
@@ -1062,14 +1871,11 @@ void VarSwapPane::applyPendingChanges() {
         }
 
         if (success && state.changeValuePending) {
-            if (occ.changeValuePtr) {
+            if (resolveField(*frameData, occ, OccurrenceField::ChangeValue)) {
                 captureUndo();
-                *occ.changeValuePtr = state.changeValue;
+                writeField(*frameData, occ, OccurrenceField::ChangeValue, state.changeValue);
                 state.changeValuePending = false;
                 modifiedRow = true;
-                if (occ.sequence) {
-                    occ.sequence->modified = true;
-                }
             } else {
                 success = false;
                 errorMessage = "Value unsupported";
@@ -1077,14 +1883,11 @@ void VarSwapPane::applyPendingChanges() {
         }
 
         if (success && state.changeModePending) {
-            if (occ.changeModePtr) {
+            if (resolveField(*frameData, occ, OccurrenceField::ChangeMode)) {
                 captureUndo();
-                *occ.changeModePtr = state.changeMode;
+                writeField(*frameData, occ, OccurrenceField::ChangeMode, state.changeMode);
                 state.changeModePending = false;
                 modifiedRow = true;
-                if (occ.sequence) {
-                    occ.sequence->modified = true;
-                }
             } else {
                 success = false;
                 errorMessage = "Mode unsupported";
@@ -1094,7 +1897,7 @@ void VarSwapPane::applyPendingChanges() {
         if (success && state.jumpTargetPending) {
             if (supportsJumpEdit(occ)) {
                 captureUndo();
-                applyJumpTarget(occ, state.jumpTargetValue, state.jumpTargetIsFrame || !occ.jumpTargetSupportsPattern);
+                applyJumpTarget(occ, state.jumpTargetValue, state.jumpTargetIsFrame || !occ.jumpTargetSupportsPattern());
                 state.jumpTargetPending = false;
                 modifiedRow = true;
             } else {
@@ -1103,6 +1906,9 @@ void VarSwapPane::applyPendingChanges() {
             }
         }
 
+        if (modifiedRow && journaled) {
+            editJournal.recordBlock(*frameData, occ, before);
+        }
         if (success && modifiedRow) {
             appliedAny = true;
         }
@@ -1122,13 +1928,80 @@ void VarSwapPane::applyPendingChanges() {
             state.statusMessage = errorMessage;
         }
     }
+    if (journaled) {
+        editJournal.commitGroup();
+    }
 
     if (appliedAny) {
+        // Labels, categories and the indexes of edited rows may have changed;
+        // re-read just those sequences. Row status survives the splice.
+        rescanSequences(touchedPatterns);
         markModified();
-        invalidateSummaryCache();
     }
 }
 
+void VarSwapPane::applyRemap() {
+    if (!frameData || remapPlan.ids.empty()) {
+        return;
+    }
+
+    AllocProfiler::Scope phase("remap");
+
+    // Snapshot every block first so the whole remap is one undo step.
+    bool journaled = usesEditJournal();
+    std::set<int> touchedPatterns;
+    std::vector<ParamSnapshot> before(journaled ? remapPlan.ids.size() : 0);
+    for (size_t j = 0; j < remapPlan.ids.size(); ++j) {
+        const Occurrence& occ = occurrences[remapPlan.ids[j]];
+        if (journaled) {
+            EditJournal::snapshot(*frameData, occ, before[j]);
+        }
+        if (touchedPatterns.insert(occ.seqIndex).second && !journaled) {
+            saveUndoState(occ.seqIndex);
+        }
+    }
+    size_t written = applyRemapPlan(*frameData, occurrences, remapPlan);
+    if (journaled) {
+        editJournal.beginGroup();
+        for (size_t j = 0; j < remapPlan.ids.size(); ++j) {
+            editJournal.recordBlock(*frameData, occurrences[remapPlan.ids[j]], before[j]);
+        }
+        editJournal.commitGroup();
+    } else {
+        editJournal.clear();
+    }
+
+    remapStatus = std::to_string(written) + " occurrence(s) remapped.";
+    if (written > 0) {
+        rescanSequences(touchedPatterns);
+        markModified();
+    }
+}
+
+bool VarSwapPane::Undo() {
+    return stepJournal(false);
+}
+
+bool VarSwapPane::Redo() {
+    return stepJournal(true);
+}
+
+bool VarSwapPane::stepJournal(bool redo) {
+    if (!frameData || !frameData->m_loaded) {
+        return false;
+    }
+    std::vector<int> touched;
+    std::string error;
+    bool stepped = redo ? editJournal.redo(*frameData, touched, error) : editJournal.undo(*frameData, touched, error);
+    if (!stepped) {
+        globalReplaceStatus = error;
+        return false;
+    }
+    rescanSequences(std::set<int>(touched.begin(), touched.end()));
+    markModified();
+    return true;
+}
+
 void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& state) {
     bool drewSomething = false;
     ImGui::PushID(rowId);
@@ -1174,9 +2047,9 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
         ImGui::TextUnformatted(deltaLabel);
     }
 
-    if (supportsAmountEdit(occ) && occ.valuePtr) {
+    if (supportsAmountEdit(occ) && occ.hasField(OccurrenceField::Value)) {
         inlineNext();
-        int currentAmount = state.amountPending ? state.amountValue : currentVar(occ);
+        int currentAmount = state.amountPending ? state.amountValue : currentVar(*frameData, occ);
         ImGui::SetNextItemWidth(80.f);
         int editAmount = currentAmount;
         if (ImGui::InputInt("##amount", &editAmount, 0, 0)) {
@@ -1191,7 +2064,7 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
 
     if (supportsComparisonEdit(occ)) {
         inlineNext();
-        int compareValue = state.compareValuePending ? state.compareValue : (occ.compareValuePtr ? *occ.compareValuePtr : 0);
+        int compareValue = state.compareValuePending ? state.compareValue : readField(*frameData, occ, OccurrenceField::CompareValue);
         ImGui::SetNextItemWidth(80.f);
         int editCompare = compareValue;
         if (ImGui::InputInt("##cmpValue", &editCompare, 0, 0)) {
@@ -1201,7 +2074,7 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
             state.statusMessage.clear();
         }
         ImGui::SameLine(0.f, style.ItemInnerSpacing.x);
-        int currentMode = state.compareModePending ? state.compareMode : (occ.compareModePtr ? *occ.compareModePtr : 0);
+        int currentMode = state.compareModePending ? state.compareMode : readField(*frameData, occ, OccurrenceField::CompareMode);
         currentMode = std::clamp(currentMode, 0, 2);
         const char* preview = kCompareModeLabels[currentMode];
         const float comboWidth = ImGui::CalcTextSize("Greater (>)").x + style.FramePadding.x * 4.f + style.ItemInnerSpacing.x * 2.f + 10.f;
@@ -1221,13 +2094,22 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
             }
             ImGui::EndCombo();
         }
+        if (showVarRangesWindow) {
+            CheckVerdict verdict = currentVarRanges().verdictAt(occ.seqIndex, occ.frameIndex, occ.blockIndex);
+            if (verdict != CheckVerdict::Unknown) {
+                ImGui::SameLine(0.f, style.ItemInnerSpacing.x);
+                ImGui::TextColored(kPendingColor, "%s", checkVerdictLabel(verdict));
+            }
+        }
     }
 
-    if (occ.changeValuePtr || occ.changeModePtr) {
+    bool hasChangeValue = occ.hasField(OccurrenceField::ChangeValue);
+    bool hasChangeMode = occ.hasField(OccurrenceField::ChangeMode);
+    if (hasChangeValue || hasChangeMode) {
         inlineNext();
 
-        if (occ.changeValuePtr) {
-            int currentValue = state.changeValuePending ? state.changeValue : *occ.changeValuePtr;
+        if (hasChangeValue) {
+            int currentValue = state.changeValuePending ? state.changeValue : readField(*frameData, occ, OccurrenceField::ChangeValue);
             ImGui::SetNextItemWidth(80.f);
             int editValue = currentValue;
             if (ImGui::InputInt("##chgValue", &editValue, 0, 0)) {
@@ -1238,12 +2120,12 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
             }
         }
 
-        if (occ.changeModePtr) {
-            if (occ.changeValuePtr) {
+        if (hasChangeMode) {
+            if (hasChangeValue) {
                 ImGui::SameLine(0.f, style.ItemInnerSpacing.x);
             }
 
-            int currentModeValue = state.changeModePending ? state.changeMode : *occ.changeModePtr;
+            int currentModeValue = state.changeModePending ? state.changeMode : readField(*frameData, occ, OccurrenceField::ChangeMode);
             if (occ.kind == OccurrenceKind::IfType38) {
                 const float comboWidth = [&]() {
                     float maxLabel = 0.f;
@@ -1324,7 +2206,7 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
         int editValue = state.jumpTargetPending ? state.jumpTargetValue : currentTarget;
 
         const float controlHeight = ImGui::GetFrameHeight();
-        if (occ.jumpTargetSupportsPattern) {
+        if (occ.jumpTargetSupportsPattern()) {
             bool toggle = editIsFrame;
             if (ImGui::Checkbox("Frame", &toggle)) {
                 state.jumpTargetPending = true;
@@ -1340,7 +2222,7 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
             ImGui::SameLine(0.f, style.ItemInnerSpacing.x);
         }
 
-        if (!editIsFrame && occ.jumpTargetSupportsPattern) {
+        if (!editIsFrame && occ.jumpTargetSupportsPattern()) {
             int patternValue = editValue;
             std::string preview = sequenceDisplayName(patternValue);
             const char* popupId = "##patternPopup";
@@ -1384,7 +2266,7 @@ void VarSwapPane::drawParameterControls(int rowId, Occurrence& occ, RowState& st
             if (ImGui::InputInt("##jumpValue", &numericValue, 0, 0)) {
                 numericValue = std::max(0, numericValue);
                 state.jumpTargetPending = true;
-                state.jumpTargetIsFrame = editIsFrame || !occ.jumpTargetSupportsPattern;
+                state.jumpTargetIsFrame = editIsFrame || !occ.jumpTargetSupportsPattern();
                 state.jumpTargetValue = numericValue;
                 state.status = RowState::Status::None;
                 state.statusMessage.clear();
@@ -1419,25 +2301,20 @@ void VarSwapPane::applyGlobalReplace(const SummaryEntry& entry, int toVar) {
         rowStates.resize(occurrences.size());
     }
 
-    bool requireProjectile = (entry.category == VarCategory::Projectile);
-    bool requireGlobalProjectile = requireProjectile && entry.isProjectileGlobal;
-    bool requireLocalProjectile = requireProjectile && !entry.isProjectileGlobal;
+    // Projectile entries are split by global flag; other categories take both.
+    std::vector<std::uint32_t> matches;
+    if (entry.category == VarCategory::Projectile) {
+        matches = varIndex.find(entry.category, entry.varId, entry.isProjectileGlobal);
+    } else {
+        const auto& local = varIndex.find(entry.category, entry.varId, false);
+        const auto& global = varIndex.find(entry.category, entry.varId, true);
+        matches.reserve(local.size() + global.size());
+        std::merge(local.begin(), local.end(), global.begin(), global.end(), std::back_inserter(matches));
+    }
 
     int queued = 0;
-    size_t count = std::min(occurrences.size(), rowStates.size());
-    for (size_t i = 0; i < count; ++i) {
-        auto& occ = occurrences[i];
-        if (occ.category != entry.category) {
-            continue;
-        }
-        if (currentVar(occ) != entry.varId || !occ.valuePtr) {
-            continue;
-        }
-        const auto& meta = metaFor(i);
-        if (requireGlobalProjectile && !meta.isGlobalProjectile) {
-            continue;
-        }
-        if (requireLocalProjectile && meta.isGlobalProjectile) {
+    for (std::uint32_t i : matches) {
+        if (i >= occurrences.size() || !resolveField(*frameData, occurrences[i], OccurrenceField::Value)) {
             continue;
         }
         auto& state = rowStates[i];
@@ -1485,7 +2362,7 @@ bool VarSwapPane::hasPendingEdits() const {
 }
 
 bool VarSwapPane::supportsDeltaEdit(const Occurrence& occ) const {
-    if (!occ.valuePtr) {
+    if (!occ.hasField(OccurrenceField::Value)) {
         return false;
     }
     switch (occ.kind) {
@@ -1507,66 +2384,56 @@ bool VarSwapPane::supportsAmountEdit(const Occurrence& occ) const {
 }
 
 int VarSwapPane::currentDeltaValue(const Occurrence& occ) const {
-    if (!occ.valuePtr) {
+    if (!resolveField(*frameData, occ, OccurrenceField::Value)) {
         return 0;
     }
     int maxDelta = deltaBaseFor(occ) - 1;
-    return std::clamp(compositeRemainder(occ), 0, maxDelta);
+    return std::clamp(compositeRemainder(*frameData, occ), 0, maxDelta);
 }
 
-void VarSwapPane::applyDeltaValue(Occurrence& occ, int newDelta) const {
-    if (!occ.valuePtr) {
+void VarSwapPane::applyDeltaValue(const Occurrence& occ, int newDelta) const {
+    const int* value = resolveField(*frameData, occ, OccurrenceField::Value);
+    if (!value) {
         return;
     }
     int base = deltaBaseFor(occ);
-    auto parts = std::div(*occ.valuePtr, base);
+    auto parts = std::div(*value, base);
     newDelta = std::clamp(newDelta, 0, base - 1);
-    *occ.valuePtr = parts.quot * base + newDelta;
-    if (occ.sequence) {
-        occ.sequence->modified = true;
-    }
+    writeField(*frameData, occ, OccurrenceField::Value, parts.quot * base + newDelta);
 }
 
 bool VarSwapPane::supportsComparisonEdit(const Occurrence& occ) const {
-    return occ.compareValuePtr && occ.compareModePtr;
+    return occ.hasField(OccurrenceField::CompareValue) && occ.hasField(OccurrenceField::CompareMode);
 }
 
 bool VarSwapPane::supportsJumpEdit(const Occurrence& occ) const {
-    return occ.jumpTargetPtr != nullptr;
+    return occ.hasField(OccurrenceField::JumpTarget);
 }
 
 int VarSwapPane::deltaBaseFor(const Occurrence& occ) const {
-    if (occ.encoding == ValueEncoding::HundredsComposite) {
+    if (occ.encoding() == ValueEncoding::HundredsComposite) {
         return 100;
     }
-    if (occ.encoding == ValueEncoding::ProjectileComposite && occ.valuePtr) {
-        return (std::abs(*occ.valuePtr) >= 100) ? 100 : 10;
+    if (occ.encoding() == ValueEncoding::ProjectileComposite) {
+        return (std::abs(rawValue(*frameData, occ)) >= 100) ? 100 : 10;
     }
     return 10;
 }
 
 bool VarSwapPane::isProjectileGlobalOp(const Occurrence& occ) const {
-    if (!occ.valuePtr) {
-        return false;
-    }
-    if (occ.kind != OccurrenceKind::EfType6No100 && occ.kind != OccurrenceKind::EfType6No101) {
-        return false;
-    }
-    if (occ.encoding != ValueEncoding::ProjectileComposite) {
-        return false;
-    }
-    return std::abs(*occ.valuePtr) >= 100;
+    return isGlobalProjectileOp(*frameData, occ);
 }
 
 void VarSwapPane::decodeJumpTarget(const Occurrence& occ, int& valueOut, bool& isFrameOut) const {
     valueOut = 0;
     isFrameOut = true;
-    if (!occ.jumpTargetPtr) {
+    const int* jumpTarget = resolveField(*frameData, occ, OccurrenceField::JumpTarget);
+    if (!jumpTarget) {
         return;
     }
-    int raw = *occ.jumpTargetPtr;
-    if (occ.jumpTargetSupportsPattern && raw >= kFrameJumpOffset) {
-        valueOut = std::max(0, raw - kFrameJumpOffset);
+    int raw = *jumpTarget;
+    if (occ.jumpTargetSupportsPattern() && raw >= kPatternJumpOffset) {
+        valueOut = std::max(0, raw - kPatternJumpOffset);
         isFrameOut = false;
     } else {
         valueOut = std::max(0, raw);
@@ -1574,26 +2441,19 @@ void VarSwapPane::decodeJumpTarget(const Occurrence& occ, int& valueOut, bool& i
     }
 }
 
-void VarSwapPane::applyJumpTarget(Occurrence& occ, int target, bool asFrame) const {
-    if (!occ.jumpTargetPtr) {
-        return;
-    }
+void VarSwapPane::applyJumpTarget(const Occurrence& occ, int target, bool asFrame) const {
     target = std::max(0, target);
-    if (occ.jumpTargetSupportsPattern && !asFrame) {
-        *occ.jumpTargetPtr = target + kFrameJumpOffset;
-    } else {
-        *occ.jumpTargetPtr = target;
-    }
-    if (occ.sequence) {
-        occ.sequence->modified = true;
+    if (occ.jumpTargetSupportsPattern() && !asFrame) {
+        target += kPatternJumpOffset;
     }
+    writeField(*frameData, occ, OccurrenceField::JumpTarget, target);
 }
 
 std::string VarSwapPane::sequenceDisplayName(int seqIndex) const {
     if (!frameData || seqIndex < 0 || seqIndex >= frameData->get_sequence_count()) {
         return std::to_string(seqIndex);
     }
-    Sequence* seq = frameData->get_sequence(seqIndex);
+    const Sequence* seq = frameData->peek_sequence(seqIndex);
     if (!seq) {
         return std::to_string(seqIndex);
     }
@@ -1628,26 +2488,25 @@ bool VarSwapPane::drawPatternCombo(const char* label, int* value) const {
     return changed;
 }
 
-std::string VarSwapPane::buildPatternLabel(const Occurrence& occ) {
-    if (occ.sequence) {
-        return formatSequenceLabel(*occ.sequence, occ.seqIndex);
+void VarSwapPane::appendPatternLabel(std::string& out, const Occurrence& occ) const {
+    if (const Sequence* seq = frameData->peek_sequence(occ.seqIndex)) {
+        appendSequenceLabel(out, *seq, occ.seqIndex);
+        return;
     }
-    return std::to_string(occ.seqIndex);
+    out += std::to_string(occ.seqIndex);
 }
 
-std::string VarSwapPane::buildNodeLabel(const Occurrence& occ) {
-    std::ostringstream oss;
-    oss << kindLabel(occ.kind);
-    if (occ.ifBlock) {
-        oss << " [IF #" << occ.blockIndex << "]";
-    } else if (occ.efBlock) {
-        oss << " [EF #" << occ.blockIndex;
-        if (occ.efBlock) {
-            oss << ", no " << occ.efBlock->number;
-        }
-        oss << "]";
+void VarSwapPane::appendNodeLabel(std::string& out, const Occurrence& occ) const {
+    char buf[48];
+    out += kindLabel(occ.kind);
+    if (!occ.isEffect()) {
+        std::snprintf(buf, sizeof(buf), " [IF #%d]", occ.blockIndex);
+    } else if (const Frame_EF* effect = resolveEf(*frameData, occ)) {
+        std::snprintf(buf, sizeof(buf), " [EF #%d, no %d]", occ.blockIndex, effect->number);
+    } else {
+        std::snprintf(buf, sizeof(buf), " [EF #%d]", occ.blockIndex);
     }
-    return oss.str();
+    out += buf;
 }
 
 bool VarSwapPane::isProjectileGlobal(int varId) const {
@@ -2,15 +2,30 @@
 #define VARSWAP_PANE_H_GUARD
 
 #include "framedata.h"
+#include "varswap/block_table.h"
+#include "varswap/def_use.h"
+#include "varswap/edit_journal.h"
 #include "varswap/occurrence.h"
+#include "varswap/param_index.h"
+#include "varswap/pattern_xref.h"
+#include "varswap/scan_sidecar.h"
+#include "varswap/spawn_tree.h"
+#include "varswap/var_index.h"
+#include "varswap/var_ranges.h"
+#include "varswap/var_remap.h"
+#include "varswap/var_usage.h"
+#include "monotonic_arena.hpp"
 
 #include <imgui.h>
 
 #include <cstdint>
 #include <functional>
 #include <limits>
+#include <memory_resource>
 #include <numeric>
+#include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -19,10 +34,35 @@ public:
     explicit VarSwapPane(FrameData* frameData);
     void Draw();
     void ForceRescan();
+    // Like ForceRescan, but first tries the scan sidecar at `sidecarPath`
+    // written for `contentHash`; on a miss it scans and rewrites the sidecar.
+    // True when the sidecar was used.
+    bool RescanWithSidecar(const std::string& sidecarPath, std::uint64_t contentHash);
+    // Re-reads only the given sequences after outside edits, keeping the row
+    // state of every other row.
+    void RescanSequences(const std::vector<int>& seqIndices);
+    // Workers for full scans; 0 (the default) uses one per hardware thread.
+    // The result does not depend on the count.
+    void setScanThreads(unsigned threads) { scanThreads = threads; }
     bool hasPendingEdits() const;
+    // Steps through the history of applied edits; this is the undo stack
+    // the workbench's Ctrl+Z / Ctrl+Y drive. Loading a document clears it;
+    // an edit made outside the pane clears it when a step runs into it.
+    bool Undo();
+    bool Redo();
+    bool canUndo() const { return editJournal.canUndo(); }
+    bool canRedo() const { return editJournal.canRedo(); }
+    void setUndoMemoryLimit(size_t bytes) { editJournal.setMemoryLimit(bytes); }
+    size_t undoMemoryLimit() const { return editJournal.memoryLimit(); }
+    // Heap usage of the scan results, per-row UI state and caches.
+    MemoryReport memoryReport() const;
 
     bool isVisible = true;
     std::function<void()> onModified;
+    // For hosts that keep their own whole-pattern undo. Setting it opts out
+    // of the edit journal: the pane calls it once per pattern before an
+    // apply or remap edits it, records nothing itself, and Undo/Redo have
+    // nothing to step. The host's stack is then the only undo path.
     std::function<void(int)> onSaveUndo;
 
 private:
@@ -65,12 +105,16 @@ private:
     };
 
     struct SummaryEntry {
+        SummaryEntry() = default;
+        explicit SummaryEntry(std::pmr::memory_resource* resource)
+            : patternCounts(resource), sortedPatterns(resource) {}
+
         int varId = 0;
         int count = 0;
         varswap::VarCategory category = varswap::VarCategory::Unknown;
         bool hasNumericVarId = true;
-        std::unordered_map<int, int> patternCounts;
-        std::vector<std::pair<int, int>> sortedPatterns;
+        std::pmr::unordered_map<int, int> patternCounts;
+        std::pmr::vector<std::pair<int, int>> sortedPatterns;
         bool patternsDirty = true;
         std::string label;
         int globalOpCount = 0;
@@ -80,10 +124,11 @@ private:
         std::uint64_t cacheKey = 0;
     };
 
+    // Strings point into metadataArena and live until the next rebuild.
     struct OccurrenceMetadata {
-        std::string patternLabel;
-        std::string nodeLabel;
-        std::string searchLower;
+        std::string_view patternLabel;
+        std::string_view nodeLabel;
+        std::string_view searchLower;
         bool isGlobalProjectile = false;
         int globalVar = 0;
         int globalDelta = 0;
@@ -91,8 +136,42 @@ private:
     };
 
     FrameData* frameData;
+    unsigned scanThreads = 0;
+    // Columnar copy of every IF/EF block behind Parameter Search. Built on
+    // the first search after a (re)scan; rescans then patch it per sequence.
+    varswap::BlockTable blockTable;
+    bool blockTableDirty = true;
+    // Rebuilt from blockTable on the first search after any (re)scan.
+    varswap::ParamIndex paramIndex;
+    bool paramIndexDirty = true;
+    // Filed by current var; kept in step with value edits made by apply.
+    varswap::VarIndex varIndex;
+    // Built from varColumn on first use after a (re)scan.
+    varswap::VarUsage varUsage;
+    bool varUsageDirty = true;
+    // Built on first use; rescans then patch it per sequence.
+    varswap::DefUseGraph defUse;
+    bool defUseDirty = true;
+    // Who jumps to or spawns each pattern. Built on first use; rescans then
+    // patch it per sequence.
+    varswap::PatternXref patternXref;
+    bool patternXrefDirty = true;
+    // Spawn graph with memoized register nets; built and patched likewise.
+    varswap::SpawnTree spawnTree;
+    bool spawnTreeDirty = true;
+    // Built on first use; rescans then re-summarize only their sequences.
+    varswap::VarRangeAnalysis varRanges;
+    bool varRangesDirty = true;
+    // One group of parameter deltas per Apply Pending.
+    varswap::EditJournal editJournal;
     std::vector<varswap::Occurrence> occurrences;
+    // Decoded Value field per occurrence, refreshed with every (re)scan so
+    // sorting, filtering and summaries never decode in their inner loops.
+    std::vector<int> varColumn;
+    std::vector<int> remainderColumn;
     std::vector<OccurrenceMetadata> occurrenceMetadata;
+    MonotonicArena metadataArena;
+    size_t metadataBytesAtRebuild = 0;
     std::vector<RowState> rowStates;
     bool categoryVisibility[static_cast<int>(varswap::VarCategory::Count)];
     std::string searchText;
@@ -108,13 +187,42 @@ private:
     std::string globalReplaceStatus;
     int lastGlobalSelection = std::numeric_limits<int>::min();
     varswap::VarCategory lastGlobalSelectionCategory = varswap::VarCategory::Count;
+    // Backs the summary cache's per-entry maps; reset on every rebuild.
+    MonotonicArena summaryArena;
     std::vector<SummaryEntry> summaryCache;
     std::vector<int> summaryCacheVisibleIndices;
     bool summaryCacheDirty = true;
     bool showPendingListWindow = false;
+    bool showPatternRefsWindow = false;
+    int patternRefsTarget = 0;
+    bool showSpawnBalanceWindow = false;
+    bool showVarRangesWindow = false;
+    bool showParamSearchWindow = false;
+    std::string paramSearchText;
+    std::string paramSearchError;
+    varswap::ParamQuery paramSearchQuery;
+    std::vector<varswap::ParamHit> paramSearchHits;
+    bool showRemapWindow = false;
+    std::string remapText;
+    std::string remapError;
+    std::string remapStatus;
+    bool remapAllowCollisions = false;
+    varswap::RemapPlan remapPlan;
+    bool remapPlanDirty = true;
 
     void refreshScan();
+    void adoptSidecar(varswap::ScanSidecar& sidecar);
+    varswap::ScanSidecar makeSidecar(std::uint64_t contentHash) const;
+    void rescanSequences(const std::set<int>& seqIndices);
     void ensureRowStateSize();
+    const varswap::VarUsage& currentVarUsage();
+    varswap::DefUseGraph& currentDefUse();
+    const varswap::PatternXref& currentPatternXref();
+    varswap::SpawnTree& currentSpawnTree();
+    varswap::VarRangeAnalysis& currentVarRanges();
+    const varswap::BlockTable& currentBlockTable();
+    const varswap::ParamIndex& currentParamIndex();
+    void decodeValueColumns(size_t first, size_t count);
     void drawEmptyState();
     void drawSummary(const std::vector<int>& visibleIndices);
     void drawVarDetailPanel(SummaryEntry* entry);
@@ -122,6 +230,11 @@ private:
     void drawGlobalReplaceControls(const SummaryEntry* entry);
     void drawTable(const std::vector<int>& visibleIndices);
     void drawPendingListWindow();
+    void drawPatternRefsWindow();
+    void drawSpawnBalanceWindow();
+    void drawVarRangesWindow();
+    void drawParamSearchWindow();
+    void drawRemapWindow();
     void drawParameterControls(int rowId, varswap::Occurrence& occ, RowState& state);
     void sortSummaryEntries(std::vector<int>& order, const std::vector<SummaryEntry>& entries, const ImGuiTableSortSpecs* sortSpecs);
     void sortOccurrenceIndices(std::vector<int>& indices, const ImGuiTableSortSpecs* sortSpecs);
@@ -129,30 +242,35 @@ private:
     std::vector<SummaryEntry>& getSummaryEntries(const std::vector<int>& visibleIndices);
     void invalidateSummaryCache();
     SummaryEntry* findSummaryEntryByKey(std::uint64_t key);
-    const std::vector<std::pair<int, int>>& ensureSortedPatterns(SummaryEntry& entry);
+    const std::pmr::vector<std::pair<int, int>>& ensureSortedPatterns(SummaryEntry& entry);
     std::vector<int> buildVisibleIndexList();
     bool matchesFilters(size_t index, const std::string& needleLower);
     void rebuildOccurrenceMetadata();
+    bool restoreOccurrenceMetadata(const std::string& labels);
+    void fillOccurrenceMetadata(size_t index, std::string& scratch);
     const OccurrenceMetadata& metaFor(size_t index) const;
     void applyPendingChanges();
+    void applyRemap();
+    bool stepJournal(bool redo);
     void applyGlobalReplace(const SummaryEntry& entry, int toVar);
     void clearPendingEdits();
-    static std::string buildPatternLabel(const varswap::Occurrence& occ);
-    static std::string buildNodeLabel(const varswap::Occurrence& occ);
+    void appendPatternLabel(std::string& out, const varswap::Occurrence& occ) const;
+    void appendNodeLabel(std::string& out, const varswap::Occurrence& occ) const;
     std::string describePendingAction(size_t index) const;
     bool isProjectileGlobal(int varId) const;
     std::string describeProjectileVar(int varId) const;
     bool supportsDeltaEdit(const varswap::Occurrence& occ) const;
     int currentDeltaValue(const varswap::Occurrence& occ) const;
-    void applyDeltaValue(varswap::Occurrence& occ, int newDelta) const;
+    void applyDeltaValue(const varswap::Occurrence& occ, int newDelta) const;
     bool supportsComparisonEdit(const varswap::Occurrence& occ) const;
     bool supportsJumpEdit(const varswap::Occurrence& occ) const;
-    void applyJumpTarget(varswap::Occurrence& occ, int target, bool asFrame) const;
+    void applyJumpTarget(const varswap::Occurrence& occ, int target, bool asFrame) const;
     void decodeJumpTarget(const varswap::Occurrence& occ, int& valueOut, bool& isFrameOut) const;
     std::string sequenceDisplayName(int seqIndex) const;
     bool drawPatternCombo(const char* label, int* value) const;
 
     void markModified();
+    bool usesEditJournal() const { return !onSaveUndo; }
     void saveUndoState(int patternIndex);
         int deltaBaseFor(const varswap::Occurrence& occ) const;
         bool isProjectileGlobalOp(const varswap::Occurrence& occ) const;
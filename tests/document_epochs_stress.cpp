@@ -0,0 +1,188 @@
+// Readers pin and check published versions while the editing thread keeps
+// editing, publishing and retiring. Every version's checksum is recorded
+// before it is published, so a reader that sees a torn, mismatched or freed
+// version fails. Run it under ThreadSanitizer or AddressSanitizer to also
+// catch races and use-after-free that happen to checksum correctly.
+
+#include "framedata.h"
+#include "varswap/document_epochs.h"
+#include "varswap/occurrence.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using varswap::DocumentEpochs;
+
+namespace {
+
+constexpr int kFrames = 4;
+constexpr int kPublishes = 10000;
+
+std::atomic<int> gFailures{0};
+
+void fail(const char* what, std::uint64_t epoch) {
+    if (gFailures.fetch_add(1) < 10) {
+        std::fprintf(stderr, "FAIL epoch %llu: %s\n", static_cast<unsigned long long>(epoch), what);
+    }
+}
+
+// Each frame carries one IF whose parameter 1 is the sequence's stamp.
+void stampSequence(Sequence& seq, int stamp) {
+    for (Frame& frame : seq.frames) {
+        frame.IF[0].parameters[1] = stamp;
+    }
+}
+
+template <typename Document>
+std::uint64_t checksum(const Document& doc, bool& consistent) {
+    std::uint64_t sum = 0;
+    consistent = true;
+    for (int s = 0; s < doc.get_sequence_count(); ++s) {
+        const Sequence* seq = doc.get_sequence(s);
+        if (!seq || seq->frames.empty()) {
+            consistent = false;
+            return 0;
+        }
+        int stamp = seq->frames[0].IF[0].parameters[1];
+        for (const Frame& frame : seq->frames) {
+            consistent = consistent && frame.IF[0].parameters[1] == stamp;
+        }
+        sum += static_cast<std::uint64_t>(stamp) * (s + 1) + seq->frames.size();
+    }
+    return sum;
+}
+
+std::uint64_t documentChecksum(const FrameData& data) {
+    FrameData::Snapshot view = data.snapshot();
+    bool consistent = true;
+    return checksum(view, consistent);
+}
+
+} // namespace
+
+int main() {
+    FrameData data;
+    data.initEmpty();
+    const int sequenceCount = data.get_sequence_count();
+    for (int s = 0; s < sequenceCount; ++s) {
+        Sequence* seq = data.get_sequence(s);
+        seq->frames.resize(kFrames);
+        for (Frame& frame : seq->frames) {
+            frame.IF.push_back(Frame_IF{});
+            frame.IF[0].type = 25;
+        }
+    }
+
+    DocumentEpochs epochs;
+    if (epochs.pin().valid()) {
+        fail("pin before the first publish", 0);
+    }
+
+    // expected[e] is written before epoch e is published.
+    std::unique_ptr<std::atomic<std::uint64_t>[]> expected(new std::atomic<std::uint64_t>[kPublishes + 2]);
+    expected[1].store(documentChecksum(data));
+    epochs.publish(data);
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> reads{0};
+    unsigned readerCount = std::max(4u, std::thread::hardware_concurrency());
+    std::vector<std::thread> readers;
+    for (unsigned r = 0; r < readerCount; ++r) {
+        readers.emplace_back([&] {
+            std::uint64_t lastEpoch = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                DocumentEpochs::Pin pin = epochs.pin();
+                if (!pin.valid()) {
+                    continue;
+                }
+                std::uint64_t epoch = pin.epoch();
+                if (epoch < lastEpoch) {
+                    fail("epoch went backwards", epoch);
+                }
+                lastEpoch = epoch;
+
+                bool consistent = true;
+                std::uint64_t sum = checksum(pin.snapshot(), consistent);
+                if (!consistent) {
+                    fail("torn sequence", epoch);
+                } else if (sum != expected[epoch].load()) {
+                    fail("checksum differs from the published one", epoch);
+                }
+                // Scanning a pinned version must not depend on the editor.
+                std::vector<varswap::Occurrence> occurrences = varswap::collectOccurrences(pin.snapshot());
+                if (occurrences.size() < static_cast<size_t>(sequenceCount)) {
+                    fail("scan lost occurrences", epoch);
+                }
+                if (checksum(pin.snapshot(), consistent) != sum) {
+                    fail("version changed while pinned", epoch);
+                }
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    size_t maxRetired = 0;
+    for (int i = 1; i <= kPublishes; ++i) {
+        int s = (i * 37) % sequenceCount;
+        Sequence* seq = data.get_sequence(s);
+        stampSequence(*seq, i);
+        // Structural edits every so often, so retired versions differ in shape.
+        if (i % 7 == 0) {
+            if (seq->frames.size() > 1 && (i / 7) % 2 == 0) {
+                seq->frames.pop_back();
+            } else {
+                seq->frames.push_back(seq->frames.back());
+            }
+            data.mark_structure_changed(s);
+        }
+        expected[i + 1].store(documentChecksum(data));
+        if (epochs.publish(data) != static_cast<std::uint64_t>(i + 1)) {
+            fail("publish returned an unexpected epoch", i + 1);
+        }
+        maxRetired = std::max(maxRetired, epochs.retiredCount());
+    }
+
+    stop = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    if (epochs.reclaim() != 0) {
+        fail("versions left retired with no reader", epochs.currentEpoch());
+    }
+
+    // Every reader slot taken: further pins fail instead of blocking.
+    std::vector<DocumentEpochs::Pin> pins;
+    for (int i = 0; i < DocumentEpochs::kMaxReaders; ++i) {
+        pins.push_back(epochs.pin());
+        if (!pins.back().valid()) {
+            fail("reader slot unavailable", epochs.currentEpoch());
+        }
+    }
+    if (epochs.pin().valid()) {
+        fail("pin past kMaxReaders", epochs.currentEpoch());
+    }
+    // A pinned version survives later publishes until it is released.
+    std::uint64_t pinnedEpoch = pins[0].epoch();
+    stampSequence(*data.get_sequence(0), -1);
+    epochs.publish(data);
+    if (epochs.retiredCount() != 1 || pins[0].epoch() != pinnedEpoch) {
+        fail("pinned version was reclaimed", pinnedEpoch);
+    }
+    pins.clear();
+    if (epochs.reclaim() != 0) {
+        fail("released version not reclaimed", pinnedEpoch);
+    }
+
+    std::printf("document epochs: %d publishes, %u readers, %llu pinned reads, at most %zu retired\n", kPublishes,
+                readerCount, static_cast<unsigned long long>(reads.load()), maxRetired);
+    if (gFailures.load() != 0) {
+        std::fprintf(stderr, "%d failure(s)\n", gFailures.load());
+        return 1;
+    }
+    return 0;
+}
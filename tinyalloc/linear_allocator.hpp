@@ -4,25 +4,35 @@
 #include "tinyalloc.h"
 #include <stdlib.h> //size_t, malloc, free
 #include <new>
+#include <type_traits>
 
+// Allocates from a tinyalloc heap. A default-constructed allocator binds to
+// the default heap at construction time (the thread's heap if one is set),
+// so containers built on a loader thread stay on that thread's heap.
 template <class T>
 struct LinearAllocator
 {
 	typedef T value_type;
-	LinearAllocator() noexcept {} //default ctor not required by C++ Standard Library
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	LinearAllocator() noexcept : heap(ta_default_heap()) {}
+	explicit LinearAllocator(ta_heap *h) noexcept : heap(h) {}
 
 	// A converting copy constructor:
-	template<class U> LinearAllocator(const LinearAllocator<U>&) noexcept {}
-	template<class U> bool operator==(const LinearAllocator<U>&) const noexcept
+	template<class U> LinearAllocator(const LinearAllocator<U>& other) noexcept : heap(other.heap) {}
+	template<class U> bool operator==(const LinearAllocator<U>& other) const noexcept
 	{
-		return true;
+		return heap == other.heap;
 	}
-	template<class U> bool operator!=(const LinearAllocator<U>&) const noexcept
+	template<class U> bool operator!=(const LinearAllocator<U>& other) const noexcept
 	{
-		return false;
+		return heap != other.heap;
 	}
 	T* allocate(const size_t n) const;
 	void deallocate(T* const p, size_t) const noexcept;
+
+	ta_heap *heap;
 };
 
 template <class T>
@@ -36,7 +46,7 @@ T* LinearAllocator<T>::allocate(const size_t n) const
 	{
 		throw std::bad_array_new_length();
 	}
-	void* const pv = ta_alloc(n * sizeof(T));
+	void* const pv = heap ? ta_heap_alloc(heap, n * sizeof(T)) : nullptr;
 	if (!pv) { throw std::bad_alloc(); }
 	return static_cast<T*>(pv);
 }
@@ -44,7 +54,10 @@ T* LinearAllocator<T>::allocate(const size_t n) const
 template<class T>
 void LinearAllocator<T>::deallocate(T * const p, size_t) const noexcept
 {
-	ta_free(p);
+	if (heap)
+	{
+		ta_heap_free(heap, p);
+	}
 }
 
 #endif /* STDALLOCATOR_HPP_GUARD */
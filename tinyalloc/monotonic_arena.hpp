@@ -0,0 +1,136 @@
+#ifndef MONOTONIC_ARENA_HPP_GUARD
+#define MONOTONIC_ARENA_HPP_GUARD
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+
+// Chunked bump allocator for short-lived data that dies all at once.
+// deallocate() is a no-op; reset() rewinds to the first chunk in O(1) and
+// keeps every chunk for reuse, so a steady-state rebuild allocates nothing
+// upstream. Usable directly or as a std::pmr::memory_resource.
+class MonotonicArena : public std::pmr::memory_resource
+{
+public:
+	explicit MonotonicArena(size_t chunkSize = 64 * 1024,
+	                        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) noexcept
+		: m_upstream(upstream), m_chunkSize(chunkSize < 256 ? 256 : chunkSize) {}
+	~MonotonicArena() { release(); }
+
+	MonotonicArena(const MonotonicArena&) = delete;
+	MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+	// Invalidates everything handed out so far.
+	void reset() noexcept
+	{
+		m_current = m_head;
+		m_ptr = m_head ? m_head->data() : nullptr;
+		m_end = m_head ? m_head->end() : nullptr;
+		m_used = 0;
+	}
+
+	// reset() and return every chunk upstream.
+	void release() noexcept
+	{
+		Chunk *chunk = m_head;
+		while (chunk)
+		{
+			Chunk *next = chunk->next;
+			m_upstream->deallocate(chunk, chunk->size, alignof(Chunk));
+			chunk = next;
+		}
+		m_head = m_current = nullptr;
+		m_ptr = m_end = nullptr;
+		m_used = 0;
+		m_reserved = 0;
+		m_chunks = 0;
+	}
+
+	// Null-terminated copy that lives until the next reset().
+	std::string_view copy(std::string_view text)
+	{
+		char *dst = static_cast<char*>(allocate(text.size() + 1, 1));
+		if (!text.empty())
+			std::memcpy(dst, text.data(), text.size());
+		dst[text.size()] = '\0';
+		return std::string_view(dst, text.size());
+	}
+
+	size_t bytesUsed() const noexcept { return m_used; }
+	size_t bytesReserved() const noexcept { return m_reserved; }
+	size_t chunkCount() const noexcept { return m_chunks; }
+
+private:
+	struct Chunk
+	{
+		Chunk *next;
+		size_t size; // including this header
+		unsigned char *data() { return reinterpret_cast<unsigned char*>(this + 1); }
+		unsigned char *end() { return reinterpret_cast<unsigned char*>(this) + size; }
+	};
+
+	void *do_allocate(size_t bytes, size_t alignment) override
+	{
+		if (void *p = bump(bytes, alignment))
+			return p;
+		// Reuse the chunks kept by reset() before asking upstream.
+		while (m_current && m_current->next)
+		{
+			m_current = m_current->next;
+			m_ptr = m_current->data();
+			m_end = m_current->end();
+			if (void *p = bump(bytes, alignment))
+				return p;
+		}
+		size_t size = sizeof(Chunk) + bytes + alignment;
+		if (size < m_chunkSize)
+			size = m_chunkSize;
+		Chunk *chunk = static_cast<Chunk*>(m_upstream->allocate(size, alignof(Chunk)));
+		chunk->next = nullptr;
+		chunk->size = size;
+		if (m_current)
+			m_current->next = chunk;
+		else
+			m_head = chunk;
+		m_current = chunk;
+		m_ptr = chunk->data();
+		m_end = chunk->end();
+		m_reserved += size;
+		m_chunks++;
+		return bump(bytes, alignment);
+	}
+
+	void do_deallocate(void*, size_t, size_t) override {}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	void *bump(size_t bytes, size_t alignment) noexcept
+	{
+		if (!m_ptr)
+			return nullptr;
+		uintptr_t p = reinterpret_cast<uintptr_t>(m_ptr);
+		uintptr_t aligned = (p + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		if (aligned + bytes > reinterpret_cast<uintptr_t>(m_end))
+			return nullptr;
+		m_ptr = reinterpret_cast<unsigned char*>(aligned + bytes);
+		m_used += bytes;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	std::pmr::memory_resource *m_upstream;
+	size_t m_chunkSize;
+	Chunk *m_head = nullptr;
+	Chunk *m_current = nullptr;
+	unsigned char *m_ptr = nullptr;
+	unsigned char *m_end = nullptr;
+	size_t m_used = 0;
+	size_t m_reserved = 0;
+	size_t m_chunks = 0;
+};
+
+#endif /* MONOTONIC_ARENA_HPP_GUARD */
@@ -0,0 +1,276 @@
+#ifndef SLAB_POOL_HPP_GUARD
+#define SLAB_POOL_HPP_GUARD
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+// Fixed-size block pool meant to be owned by one sequence: its
+// Frame_EF/Frame_IF arrays, hitbox map nodes and frame vectors end up next
+// to each other instead of scattered over the global heap. Requests up to
+// kPooledMax bytes are rounded to a size class and recycled through a
+// per-class free list; larger ones go straight upstream. Slabs start small
+// and double, so a pool for a two-frame sequence stays small.
+//
+// For a whole document, give every sequence's pool the same MonotonicArena
+// as upstream: the slabs are then carved back to back from large chunks,
+// and teardown is one arena release instead of a free per block. Not
+// thread-safe; one pool per sequence being built or edited. That is also
+// why FrameData's own sequences stay on std::allocator: a snapshot can
+// drop the last reference to a sequence on a reader thread. See
+// bench/slab_pool_bench.cpp for the load and teardown numbers.
+class SlabPool
+{
+public:
+	static constexpr size_t kGranule = 16;
+	static constexpr size_t kFineMax = 512;    // 16-byte classes up to here
+	static constexpr size_t kPooledMax = 8192; // power-of-two classes up to here
+	static constexpr size_t kFineClasses = kFineMax / kGranule;
+	static constexpr size_t kNumClasses = kFineClasses + 4; // 1K, 2K, 4K, 8K
+
+	explicit SlabPool(size_t firstSlab = 1024, size_t maxSlab = 16 * 1024,
+	                  std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) noexcept
+		: m_upstream(upstream), m_nextSlab(firstSlab < 256 ? 256 : firstSlab),
+		  m_maxSlab(maxSlab < m_nextSlab ? m_nextSlab : maxSlab) {}
+	~SlabPool() { release(); }
+
+	SlabPool(const SlabPool&) = delete;
+	SlabPool& operator=(const SlabPool&) = delete;
+
+	void *allocate(size_t bytes)
+	{
+		if (bytes == 0)
+			bytes = 1;
+		if (bytes > kPooledMax)
+			return allocateLarge(bytes);
+		size_t classBytes = 0;
+		size_t cls = sizeClass(bytes, &classBytes);
+		m_live += classBytes;
+		if (FreeNode *node = m_free[cls])
+		{
+			m_free[cls] = node->next;
+			return node;
+		}
+		if (static_cast<size_t>(m_end - m_ptr) < classBytes)
+			addSlab(classBytes);
+		void *p = m_ptr;
+		m_ptr += classBytes;
+		return p;
+	}
+
+	// `bytes` must be the size passed to allocate().
+	void deallocate(void *p, size_t bytes) noexcept
+	{
+		if (!p)
+			return;
+		if (bytes == 0)
+			bytes = 1;
+		if (bytes > kPooledMax)
+		{
+			deallocateLarge(p);
+			return;
+		}
+		size_t classBytes = 0;
+		size_t cls = sizeClass(bytes, &classBytes);
+		m_live -= classBytes;
+		FreeNode *node = static_cast<FreeNode*>(p);
+		node->next = m_free[cls];
+		m_free[cls] = node;
+	}
+
+	// Returns every slab and large block upstream. Containers still using
+	// the pool must already be destroyed.
+	void release() noexcept
+	{
+		Slab *slab = m_slabs;
+		while (slab)
+		{
+			Slab *next = slab->next;
+			m_upstream->deallocate(slab, slab->size, alignof(std::max_align_t));
+			slab = next;
+		}
+		Large *large = m_large;
+		while (large)
+		{
+			Large *next = large->next;
+			m_upstream->deallocate(large, large->size, alignof(std::max_align_t));
+			large = next;
+		}
+		m_slabs = nullptr;
+		m_large = nullptr;
+		m_ptr = m_end = nullptr;
+		for (size_t i = 0; i < kNumClasses; i++)
+			m_free[i] = nullptr;
+		m_live = 0;
+		m_reserved = 0;
+		m_slabCount = 0;
+	}
+
+	size_t bytesLive() const noexcept { return m_live; }
+	size_t bytesReserved() const noexcept { return m_reserved; }
+	size_t slabCount() const noexcept { return m_slabCount; }
+
+	// Pool that default-constructed SlabAllocators bind to on this thread.
+	static SlabPool *current() noexcept { return threadSlot(); }
+
+	// Makes `pool` the thread's current pool until the scope ends.
+	class Scope
+	{
+	public:
+		explicit Scope(SlabPool *pool) noexcept : m_previous(threadSlot()) { threadSlot() = pool; }
+		~Scope() { threadSlot() = m_previous; }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		SlabPool *m_previous;
+	};
+
+private:
+	struct FreeNode { FreeNode *next; };
+	struct Slab { Slab *next; size_t size; };
+	struct Large { Large *prev; Large *next; size_t size; size_t pad; };
+	static constexpr size_t kSlabHeader = (sizeof(Slab) + kGranule - 1) & ~(kGranule - 1);
+	static_assert(sizeof(Large) % kGranule == 0, "large header must keep blocks aligned");
+
+	static SlabPool *&threadSlot() noexcept
+	{
+		static thread_local SlabPool *pool = nullptr;
+		return pool;
+	}
+
+	static size_t sizeClass(size_t bytes, size_t *classBytes) noexcept
+	{
+		if (bytes <= kFineMax)
+		{
+			size_t cls = (bytes - 1) / kGranule;
+			*classBytes = (cls + 1) * kGranule;
+			return cls;
+		}
+		size_t cls = kFineClasses;
+		size_t size = kFineMax * 2;
+		while (size < bytes)
+		{
+			size *= 2;
+			cls++;
+		}
+		*classBytes = size;
+		return cls;
+	}
+
+	void addSlab(size_t minBytes)
+	{
+		size_t size = m_nextSlab;
+		while (size < kSlabHeader + minBytes)
+			size *= 2;
+		Slab *slab = static_cast<Slab*>(m_upstream->allocate(size, alignof(std::max_align_t)));
+		slab->next = m_slabs;
+		slab->size = size;
+		m_slabs = slab;
+		// The tail of the previous slab is abandoned; it is at most one
+		// size class and goes back upstream with the rest on release().
+		m_ptr = reinterpret_cast<unsigned char*>(slab) + kSlabHeader;
+		m_end = reinterpret_cast<unsigned char*>(slab) + size;
+		m_reserved += size;
+		m_slabCount++;
+		if (m_nextSlab < m_maxSlab)
+			m_nextSlab *= 2;
+	}
+
+	void *allocateLarge(size_t bytes)
+	{
+		size_t size = sizeof(Large) + bytes;
+		Large *large = static_cast<Large*>(m_upstream->allocate(size, alignof(std::max_align_t)));
+		large->prev = nullptr;
+		large->next = m_large;
+		large->size = size;
+		if (m_large)
+			m_large->prev = large;
+		m_large = large;
+		m_live += bytes;
+		m_reserved += size;
+		return large + 1;
+	}
+
+	void deallocateLarge(void *p) noexcept
+	{
+		Large *large = static_cast<Large*>(p) - 1;
+		if (large->prev)
+			large->prev->next = large->next;
+		else
+			m_large = large->next;
+		if (large->next)
+			large->next->prev = large->prev;
+		m_live -= large->size - sizeof(Large);
+		m_reserved -= large->size;
+		m_upstream->deallocate(large, large->size, alignof(std::max_align_t));
+	}
+
+	std::pmr::memory_resource *m_upstream;
+	size_t m_nextSlab;
+	size_t m_maxSlab;
+	FreeNode *m_free[kNumClasses] = {};
+	Slab *m_slabs = nullptr;
+	Large *m_large = nullptr;
+	unsigned char *m_ptr = nullptr;
+	unsigned char *m_end = nullptr;
+	size_t m_live = 0;
+	size_t m_reserved = 0;
+	size_t m_slabCount = 0;
+};
+
+// Plugs SlabPool into the Allocator template hook of Sequence_T/Frame_T,
+// e.g. Sequence_T<SlabAllocator>. Like LinearAllocator, a default-constructed
+// allocator binds to the thread's current pool (SlabPool::Scope), so build a
+// sequence inside the scope of its own pool. Copy construction rebinds to
+// the current pool rather than sharing the source's. Without a pool it falls
+// back to operator new.
+template <class T>
+struct SlabAllocator
+{
+	static_assert(alignof(T) <= SlabPool::kGranule, "SlabPool only guarantees 16-byte alignment");
+
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	SlabAllocator() noexcept : pool(SlabPool::current()) {}
+	explicit SlabAllocator(SlabPool *p) noexcept : pool(p) {}
+
+	template<class U> SlabAllocator(const SlabAllocator<U>& other) noexcept : pool(other.pool) {}
+	template<class U> bool operator==(const SlabAllocator<U>& other) const noexcept
+	{
+		return pool == other.pool;
+	}
+	template<class U> bool operator!=(const SlabAllocator<U>& other) const noexcept
+	{
+		return pool != other.pool;
+	}
+
+	SlabAllocator select_on_container_copy_construction() const noexcept { return SlabAllocator(); }
+
+	T* allocate(const size_t n) const
+	{
+		if (n > static_cast<size_t>(-1) / sizeof(T))
+			throw std::bad_array_new_length();
+		if (!pool)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		return static_cast<T*>(pool->allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T * const p, size_t n) const noexcept
+	{
+		if (!pool)
+		{
+			::operator delete(p);
+			return;
+		}
+		pool->deallocate(p, n * sizeof(T));
+	}
+
+	SlabPool *pool;
+};
+
+#endif /* SLAB_POOL_HPP_GUARD */
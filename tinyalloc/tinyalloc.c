@@ -11,28 +11,125 @@ extern void print_i(size_t);
 #define print_i(X)
 #endif
 
+/**
+ * Requests up to TA_SMALL_MAX bytes are served from size-class bins:
+ * sixteen classes spaced by the alignment, then four classes per
+ * power of two. Bins are LIFO lists of same-sized blocks, so small
+ * alloc/free are O(1) and never coalesce. Larger requests use the
+ * address-sorted free list with splitting and compaction.
+ */
+#ifndef TA_SMALL_MAX
+#define TA_SMALL_MAX 4096
+#endif
+#define TA_LINEAR_CLASSES 16
+#define TA_NUM_BINS 64
+#define TA_LARGE_BIN TA_NUM_BINS
+
 typedef struct Block Block;
 
 struct Block {
-    void *addr;
+    void *addr;    // start of the region, header included
     Block *next;
-    size_t size;
+    Block *prev;   // used list only
+    size_t size;   // region size, header included
+    uint32_t bin;  // size class, TA_LARGE_BIN for large blocks
+    uint32_t used;
 };
 
-typedef struct {
+struct ta_heap {
     const void *virtual_adress;
-    Block *free;   // first free block
+    Block *free;   // first free large block
     Block *used;   // first used block
     Block *fresh;  // first available blank block
     size_t top;    // top free addr
-} Heap;
+    Block *bins[TA_NUM_BINS]; // free small blocks per size class
+    const void *limit;
+    size_t split_thresh;
+    size_t alignment;
+    size_t max_blocks;
+    // Every region starts with a pointer to its Block, padded to the
+    // alignment, so ta_free finds the block without walking the used list.
+    size_t header;
+};
+
+typedef struct ta_heap Heap;
+
+#if defined(_MSC_VER)
+#define TA_THREAD_LOCAL __declspec(thread)
+#else
+#define TA_THREAD_LOCAL _Thread_local
+#endif
 
 static int init_times = 0;
-static Heap *heap = NULL;
-static const void *heap_limit = NULL;
-static size_t heap_split_thresh;
-static size_t heap_alignment;
-static size_t heap_max_blocks;
+static Heap *global_heap = NULL;
+static TA_THREAD_LOCAL Heap *thread_heap = NULL;
+static ta_profile_hook profile_hook = NULL;
+
+static Block *first_block(Heap *heap) {
+    return (Block *)(heap + 1);
+}
+
+static size_t align_up(Heap *heap, size_t num) {
+    return (num + heap->alignment - 1) & -heap->alignment;
+}
+
+/**
+ * Returns the bin for a request of `num` bytes and stores the class
+ * size, or returns TA_LARGE_BIN when the request is not small.
+ */
+static uint32_t size_class(Heap *heap, size_t num, size_t *class_size) {
+    size_t linear_max = heap->alignment * TA_LINEAR_CLASSES;
+    if (num == 0) {
+        num = 1;
+    }
+    if (num <= linear_max) {
+        uint32_t bin = (uint32_t)((num + heap->alignment - 1) / heap->alignment - 1);
+        *class_size  = (size_t)(bin + 1) * heap->alignment;
+        return bin;
+    }
+    uint32_t bin = TA_LINEAR_CLASSES;
+    size_t base  = linear_max;
+    while (base < TA_SMALL_MAX && bin < TA_NUM_BINS) {
+        size_t step = base / 4;
+        for (size_t k = 1; k <= 4 && bin < TA_NUM_BINS; k++, bin++) {
+            size_t size = base + k * step;
+            if (num <= size) {
+                *class_size = align_up(heap, size);
+                return bin;
+            }
+        }
+        base *= 2;
+    }
+    return TA_LARGE_BIN;
+}
+
+static void *user_addr(Heap *heap, Block *block) {
+    return (void *)((size_t)block->addr + heap->header);
+}
+
+static void mark_used(Heap *heap, Block *block) {
+    *(Block **)block->addr = block;
+    block->used = 1;
+    block->prev = NULL;
+    block->next = heap->used;
+    if (heap->used != NULL) {
+        heap->used->prev = block;
+    }
+    heap->used = block;
+}
+
+static void unlink_used(Heap *heap, Block *block) {
+    if (block->prev != NULL) {
+        block->prev->next = block->next;
+    } else {
+        heap->used = block->next;
+    }
+    if (block->next != NULL) {
+        block->next->prev = block->prev;
+    }
+    block->prev = NULL;
+    block->used = 0;
+}
 
 /**
  * If compaction is enabled, inserts block
@@ -40,7 +137,8 @@ static size_t heap_max_blocks;
  * If disabled, add block has new head of
  * the free list.
  */
-static void insert_block(Block *block) {
+static void insert_block(Heap *heap, Block *block) {
+    block->bin = TA_LARGE_BIN;
 #ifndef TA_DISABLE_COMPACT
     Block *ptr  = heap->free;
     Block *prev = NULL;
@@ -70,7 +168,7 @@ static void insert_block(Block *block) {
 }
 
 #ifndef TA_DISABLE_COMPACT
-static void release_blocks(Block *scan, Block *to) {
+static void release_blocks(Heap *heap, Block *scan, Block *to) {
     Block *scan_next;
     while (scan != to) {
         print_s("release");
@@ -84,7 +182,7 @@ static void release_blocks(Block *scan, Block *to) {
     }
 }
 
-static void compact() {
+static void compact(Heap *heap) {
     Block *ptr = heap->free;
     Block *prev;
     Block *scan;
@@ -106,7 +204,7 @@ static void compact() {
             ptr->size   = new_size;
             Block *next = prev->next;
             // make merged blocks available
-            release_blocks(ptr->next, prev->next);
+            release_blocks(heap, ptr->next, prev->next);
             // relink
             ptr->next = next;
         }
@@ -115,72 +213,148 @@ static void compact() {
 }
 #endif
 
-bool ta_init(const void *base, const void *limit, const size_t heap_blocks, const size_t split_thresh, const size_t alignment, bool existing) {
-    assert(init_times == 0);
+static void reset_heap(Heap *heap) {
+    heap->free  = NULL;
+    heap->used  = NULL;
+    heap->fresh = first_block(heap);
+    heap->top   = align_up(heap, (size_t)(heap->fresh + heap->max_blocks));
+    for (size_t i = 0; i < TA_NUM_BINS; i++) {
+        heap->bins[i] = NULL;
+    }
+
+    Block *block = first_block(heap);
+    size_t i     = heap->max_blocks - 1;
+    while (i--) {
+        block->next = block + 1;
+        block++;
+    }
+    block->next = NULL;
+}
+
+ta_heap *ta_heap_init(const void *base, const void *limit, const size_t heap_blocks, const size_t split_thresh, const size_t alignment, bool existing) {
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    assert(heap_blocks != 0);
 
-    heap = (Heap *)(base);
-    heap_limit = limit;
-    heap_split_thresh = split_thresh;
-    heap_alignment = alignment;
-    heap_max_blocks = heap_blocks;
+    Heap *heap = (Heap *)(base);
+    heap->limit        = limit;
+    heap->split_thresh = split_thresh;
+    heap->alignment    = alignment;
+    heap->max_blocks   = heap_blocks;
+    heap->header       = align_up(heap, sizeof(Block *));
     if(!existing)
     {
-        heap->free   = NULL;
-        heap->used   = NULL;
-        heap->fresh  = (Block *)(heap + 1);
-        heap->top    = (size_t)(heap->fresh + heap_blocks);
         heap->virtual_adress = base;
+        reset_heap(heap);
+    }
+    return heap;
+}
 
-        Block *block = (Block *)(heap + 1);
-        size_t i     = heap_max_blocks - 1;
-        while (i--) {
-            block->next = block + 1;
-            block++;
+void ta_heap_reset(ta_heap *heap) {
+    if (profile_hook != NULL) {
+        for (Block *block = heap->used; block != NULL; block = block->next) {
+            profile_hook(block->size - heap->header, false);
         }
-        block->next = NULL;
     }
+    reset_heap(heap);
+}
 
+bool ta_init(const void *base, const void *limit, const size_t heap_blocks, const size_t split_thresh, const size_t alignment, bool existing) {
+    assert(init_times == 0);
+
+    global_heap = ta_heap_init(base, limit, heap_blocks, split_thresh, alignment, existing);
     init_times++;
     return true;
 }
 
-bool ta_free(void *free) {
-    Block *block = heap->used;
-    Block *prev  = NULL;
-    while (block != NULL) {
-        if (free == block->addr) {
-            if (prev) {
-                prev->next = block->next;
-            } else {
-                heap->used = block->next;
-            }
-            insert_block(block);
+void ta_set_thread_heap(ta_heap *heap) {
+    thread_heap = heap;
+}
+
+ta_heap *ta_default_heap() {
+    return thread_heap != NULL ? thread_heap : global_heap;
+}
+
+void ta_set_profile_hook(ta_profile_hook hook) {
+    profile_hook = hook;
+}
+
+/**
+ * Maps a user pointer back to its block. Pointers that were not
+ * returned by ta_alloc/ta_calloc, or were already freed, yield NULL.
+ */
+static Block *find_block(Heap *heap, void *ptr) {
+    size_t addr = (size_t)ptr;
+    size_t data_start = (size_t)(first_block(heap) + heap->max_blocks);
+    if (addr < data_start + heap->header || addr > heap->top || (addr & (heap->alignment - 1)) != 0) {
+        return NULL;
+    }
+    Block *block = *(Block **)(addr - heap->header);
+    Block *first = first_block(heap);
+    if ((size_t)block < (size_t)first || (size_t)block >= (size_t)(first + heap->max_blocks) ||
+        ((size_t)block - (size_t)first) % sizeof(Block) != 0) {
+        return NULL;
+    }
+    if (!block->used || user_addr(heap, block) != ptr) {
+        return NULL;
+    }
+    return block;
+}
+
+bool ta_heap_free(ta_heap *heap, void *free) {
+    Block *block = find_block(heap, free);
+    if (block == NULL) {
+        return false;
+    }
+    unlink_used(heap, block);
+    if (profile_hook != NULL) {
+        profile_hook(block->size - heap->header, false);
+    }
+    if (block->bin != TA_LARGE_BIN) {
+        block->next = heap->bins[block->bin];
+        heap->bins[block->bin] = block;
+        return true;
+    }
+    insert_block(heap, block);
 #ifndef TA_DISABLE_COMPACT
-            compact();
+    compact(heap);
 #endif
-            return true;
-        }
-        prev  = block;
-        block = block->next;
+    return true;
+}
+
+/**
+ * Takes a fresh block descriptor for a new region of `size` bytes
+ * carved from the top of the heap.
+ */
+static Block *alloc_top(Heap *heap, size_t size) {
+    size_t top     = heap->top;
+    size_t new_top = top + size;
+    if (heap->fresh == NULL || new_top > (size_t)heap->limit) {
+        return NULL;
     }
-    return false;
+    Block *ptr  = heap->fresh;
+    heap->fresh = ptr->next;
+    ptr->addr   = (void *)top;
+    ptr->size   = size;
+    heap->top   = new_top;
+    return ptr;
 }
 
-static Block *alloc_block(size_t num) {
+/**
+ * First fit over the large free list. Takes the block at the top of
+ * the heap and resizes it if that is the first fit.
+ */
+static Block *alloc_large(Heap *heap, size_t num) {
     Block *ptr  = heap->free;
     Block *prev = NULL;
     size_t top  = heap->top;
-    num         = (num + heap_alignment - 1) & -heap_alignment;
     while (ptr != NULL) {
-        const int is_top = ((size_t)ptr->addr + ptr->size >= top) && ((size_t)ptr->addr + num <= (size_t)heap_limit);
+        const int is_top = ((size_t)ptr->addr + ptr->size >= top) && ((size_t)ptr->addr + num <= (size_t)heap->limit);
         if (is_top || ptr->size >= num) {
             if (prev != NULL) {
                 prev->next = ptr->next;
             } else {
                 heap->free = ptr->next;
             }
-            ptr->next  = heap->used;
-            heap->used = ptr;
             if (is_top) {
                 print_s("resize top block");
                 ptr->size = num;
@@ -188,7 +362,7 @@ static Block *alloc_block(size_t num) {
 #ifndef TA_DISABLE_SPLIT
             } else if (heap->fresh != NULL) {
                 size_t excess = ptr->size - num;
-                if (excess >= heap_split_thresh) {
+                if (excess >= heap->split_thresh) {
                     ptr->size    = num;
                     Block *split = heap->fresh;
                     heap->fresh  = split->next;
@@ -196,9 +370,9 @@ static Block *alloc_block(size_t num) {
                     print_s("split");
                     print_i((size_t)split->addr);
                     split->size = excess;
-                    insert_block(split);
+                    insert_block(heap, split);
 #ifndef TA_DISABLE_COMPACT
-                    compact();
+                    compact(heap);
 #endif
                 }
 #endif
@@ -210,24 +384,41 @@ static Block *alloc_block(size_t num) {
     }
     // no matching free blocks
     // see if any other blocks available
-    size_t new_top = top + num;
-    if (heap->fresh != NULL && new_top <= (size_t)heap_limit) {
-        ptr         = heap->fresh;
-        heap->fresh = ptr->next;
-        ptr->addr   = (void *)top;
-        ptr->next   = heap->used;
-        ptr->size   = num;
-        heap->used  = ptr;
-        heap->top   = new_top;
-        return ptr;
+    return alloc_top(heap, num);
+}
+
+static Block *alloc_block(Heap *heap, size_t num) {
+    size_t class_size = 0;
+    uint32_t bin      = size_class(heap, num, &class_size);
+    Block *ptr        = NULL;
+    if (bin != TA_LARGE_BIN) {
+        ptr = heap->bins[bin];
+        if (ptr != NULL) {
+            heap->bins[bin] = ptr->next;
+        } else {
+            ptr = alloc_top(heap, heap->header + class_size);
+            if (ptr == NULL) {
+                // top exhausted, fall back to space freed by large blocks
+                ptr = alloc_large(heap, heap->header + class_size);
+            }
+        }
+    } else {
+        ptr = alloc_large(heap, heap->header + align_up(heap, num));
     }
-    return NULL;
+    if (ptr != NULL) {
+        ptr->bin = bin;
+        mark_used(heap, ptr);
+        if (profile_hook != NULL) {
+            profile_hook(ptr->size - heap->header, true);
+        }
+    }
+    return ptr;
 }
 
-void *ta_alloc(size_t num) {
-    Block *block = alloc_block(num);
+void *ta_heap_alloc(ta_heap *heap, size_t num) {
+    Block *block = alloc_block(heap, num);
     if (block != NULL) {
-        return block->addr;
+        return user_addr(heap, block);
     }
     return NULL;
 }
@@ -245,17 +436,17 @@ static void memclear(void *ptr, size_t num) {
     }
 }
 
-void *ta_calloc(size_t num, size_t size) {
+void *ta_heap_calloc(ta_heap *heap, size_t num, size_t size) {
     num *= size;
-    Block *block = alloc_block(num);
+    Block *block = alloc_block(heap, num);
     if (block != NULL) {
-        memclear(block->addr, num);
-        return block->addr;
+        memclear(user_addr(heap, block), num);
+        return user_addr(heap, block);
     }
     return NULL;
 }
 
-static size_t count_blocks(Block *ptr) {
+static size_t count_blocks(const Block *ptr) {
     size_t num = 0;
     while (ptr != NULL) {
         num++;
@@ -264,18 +455,57 @@ static size_t count_blocks(Block *ptr) {
     return num;
 }
 
+size_t ta_heap_num_free(const ta_heap *heap) {
+    size_t num = count_blocks(heap->free);
+    for (size_t i = 0; i < TA_NUM_BINS; i++) {
+        num += count_blocks(heap->bins[i]);
+    }
+    return num;
+}
+
+size_t ta_heap_num_used(const ta_heap *heap) {
+    return count_blocks(heap->used);
+}
+
+size_t ta_heap_num_fresh(const ta_heap *heap) {
+    return count_blocks(heap->fresh);
+}
+
+bool ta_heap_check(const ta_heap *heap) {
+    for (size_t i = 0; i < TA_NUM_BINS; i++) {
+        for (const Block *ptr = heap->bins[i]; ptr != NULL; ptr = ptr->next) {
+            if (ptr->used || ptr->bin != i) {
+                return false;
+            }
+        }
+    }
+    return heap->max_blocks == ta_heap_num_free(heap) + ta_heap_num_used(heap) + ta_heap_num_fresh(heap);
+}
+
+void *ta_alloc(size_t num) {
+    return ta_heap_alloc(ta_default_heap(), num);
+}
+
+void *ta_calloc(size_t num, size_t size) {
+    return ta_heap_calloc(ta_default_heap(), num, size);
+}
+
+bool ta_free(void *ptr) {
+    return ta_heap_free(ta_default_heap(), ptr);
+}
+
 size_t ta_num_free() {
-    return count_blocks(heap->free);
+    return ta_heap_num_free(ta_default_heap());
 }
 
 size_t ta_num_used() {
-    return count_blocks(heap->used);
+    return ta_heap_num_used(ta_default_heap());
 }
 
 size_t ta_num_fresh() {
-    return count_blocks(heap->fresh);
+    return ta_heap_num_fresh(ta_default_heap());
 }
 
 bool ta_check() {
-    return heap_max_blocks == ta_num_free() + ta_num_used() + ta_num_fresh();
+    return ta_heap_check(ta_default_heap());
 }
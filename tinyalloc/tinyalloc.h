@@ -5,6 +5,25 @@ extern "C" {
 #include <stdbool.h>
 #include <stddef.h>
 
+// A heap lives at the start of the memory range it manages. Each heap is
+// single-threaded; use one per thread or per document instead of locking.
+typedef struct ta_heap ta_heap;
+
+ta_heap *ta_heap_init(const void *base, const void *limit, const size_t heap_blocks, const size_t split_thresh, const size_t alignment, bool existing);
+void *ta_heap_alloc(ta_heap *heap, size_t num);
+void *ta_heap_calloc(ta_heap *heap, size_t num, size_t size);
+bool ta_heap_free(ta_heap *heap, void *ptr);
+// Drops every allocation at once, keeping the heap's configuration.
+void ta_heap_reset(ta_heap *heap);
+
+size_t ta_heap_num_free(const ta_heap *heap);
+size_t ta_heap_num_used(const ta_heap *heap);
+size_t ta_heap_num_fresh(const ta_heap *heap);
+bool ta_heap_check(const ta_heap *heap);
+
+// The functions below act on the default heap: the calling thread's heap
+// if one was set with ta_set_thread_heap, otherwise the one from ta_init.
+
 //Returns true if used for the first time.
 bool ta_init(const void *base, const void *limit, const size_t heap_blocks, const size_t split_thresh, const size_t alignment, bool existing);
 void *ta_alloc(size_t num);
@@ -16,6 +35,16 @@ size_t ta_num_used();
 size_t ta_num_fresh();
 bool ta_check();
 
+// Pass NULL to fall back to the global heap again.
+void ta_set_thread_heap(ta_heap *heap);
+ta_heap *ta_default_heap();
+
+// Called with the usable size of every block handed out or returned by any
+// heap, including blocks dropped by ta_heap_reset. Install it before the
+// heaps are used from other threads; NULL removes it.
+typedef void (*ta_profile_hook)(size_t bytes, bool allocated);
+void ta_set_profile_hook(ta_profile_hook hook);
+
 #ifdef __cplusplus
 }
 #endif
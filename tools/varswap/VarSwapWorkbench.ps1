@@ -214,24 +214,23 @@ function Apply-Replacements {
         [string]$TargetFile,
         [array]$Mappings
     )
-    $results = @()
-    foreach ($mapping in $Mappings) {
-        $args = @(
-            "replace","--file", $TargetFile,
-            "--from", $mapping.From,
-            "--to", $mapping.To,
-            "--in-place"
-        )
-        $invocation = Invoke-VarTool -Executable $Executable -Arguments $args
-        Write-Host $invocation.StdOut
-        if ($invocation.StdErr) {
-            Write-Host $invocation.StdErr -ForegroundColor Yellow
-        }
-        if ($invocation.ExitCode -ne 0) {
-            throw "Replacement for var $($mapping.From) failed with exit code $($invocation.ExitCode)."
-        }
-        $results += $mapping
+    # One run applies every mapping against the original values, so swaps
+    # such as 3 -> 7 and 7 -> 3 need no temporary var.
+    $map = ($Mappings | ForEach-Object { "$($_.From):$($_.To)" }) -join ","
+    $args = @(
+        "replace","--file", $TargetFile,
+        "--map", $map,
+        "--in-place"
+    )
+    $invocation = Invoke-VarTool -Executable $Executable -Arguments $args
+    Write-Host $invocation.StdOut
+    if ($invocation.StdErr) {
+        Write-Host $invocation.StdErr -ForegroundColor Yellow
+    }
+    if ($invocation.ExitCode -ne 0) {
+        throw "Replacement failed with exit code $($invocation.ExitCode)."
     }
+    $results = @($Mappings)
     return $results
 }
 
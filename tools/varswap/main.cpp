@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
@@ -11,22 +13,71 @@
 #include <vector>
 
 #include "framedata.h"
+#include "varswap/alloc_profile.h"
+#include "varswap/def_use.h"
 #include "varswap/occurrence.h"
+#include "varswap/occurrence_schema.h"
+#include "varswap/param_index.h"
+#include "varswap/pattern_xref.h"
+#include "varswap/scan_sidecar.h"
+#include "varswap/spawn_tree.h"
+#include "varswap/var_decode.h"
+#include "varswap/var_index.h"
+#include "varswap/var_ranges.h"
+#include "varswap/var_remap.h"
+#include "varswap/var_usage.h"
+
+#ifndef VARSWAP_NO_ALLOC_HOOKS
+#include "varswap/alloc_hooks.inl"
+#endif
 
 namespace fs = std::filesystem;
 
+using varswap::AllocProfiler;
+using varswap::BlockTable;
+using varswap::DefUseGraph;
 using varswap::Occurrence;
 using varswap::OccurrenceKind;
+using varswap::ParamHit;
+using varswap::ParamIndex;
+using varswap::ParamQuery;
+using varswap::PatternRef;
+using varswap::PatternXref;
+using varswap::RegisterDelta;
+using varswap::SpawnImbalance;
+using varswap::SpawnTree;
 using varswap::VarCategory;
 using varswap::ValueEncoding;
+using varswap::VarIndex;
+using varswap::VarRange;
+using varswap::VarRangeAnalysis;
+using varswap::VarRemap;
+using varswap::VarUsage;
 using varswap::applyVarChange;
+using varswap::varIdSpace;
 using varswap::collectOccurrences;
 using varswap::compositeRemainder;
 using varswap::currentVar;
+using varswap::rawValue;
+using varswap::resolveEf;
 using varswap::kindCode;
 using varswap::kindLabel;
 using varswap::categoryLabel;
 
+// Prints the per-phase allocation profile when main returns, whichever
+// command path it returns from.
+struct ProfileReportOnExit {
+    ~ProfileReportOnExit() {
+        AllocProfiler& profiler = AllocProfiler::instance();
+        if (!profiler.enabled()) {
+            return;
+        }
+        profiler.setEnabled(false);
+        std::cout << "\nAllocation profile:\n";
+        profiler.print(std::cout);
+    }
+};
+
 struct LogEntry {
     int fromVar;
     int toVar;
@@ -52,6 +103,81 @@ bool parseInt(const std::string& text, int& out) {
     }
 }
 
+// One replace mapping. Without a category it applies to every category;
+// with one, to every category sharing its var id space.
+struct VarMapping {
+    std::optional<VarCategory> category;
+    int fromVar;
+    int toVar;
+    int applied = 0;
+};
+
+std::string trimmed(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Parses comma-separated "from:to" or "category:from:to" entries.
+bool parseMappingList(const std::string& text, std::vector<VarMapping>& out, std::string& error) {
+    std::istringstream entries(text);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        entry = trimmed(entry);
+        if (entry.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::istringstream parts(entry);
+        std::string field;
+        while (std::getline(parts, field, ':')) {
+            fields.push_back(trimmed(field));
+        }
+        VarMapping mapping{};
+        size_t first = 0;
+        if (fields.size() == 3) {
+            VarCategory category;
+            if (!varswap::parseCategoryName(fields[0], category)) {
+                error = "unknown category in " + entry;
+                return false;
+            }
+            mapping.category = category;
+            first = 1;
+        }
+        if ((fields.size() != 2 && fields.size() != 3) || !parseInt(fields[first], mapping.fromVar) ||
+            !parseInt(fields[first + 1], mapping.toVar)) {
+            error = "expected [category:]from:to, got " + entry;
+            return false;
+        }
+        out.push_back(mapping);
+    }
+    return true;
+}
+
+// A mapping file holds the same entries, one or more per line; '#' starts a
+// comment.
+bool loadMappingFile(const fs::path& path, std::vector<VarMapping>& out, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path.string();
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        if (!parseMappingList(line, out, error)) {
+            error = path.string() + ":" + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
 std::string sequenceLabel(const Sequence& seq, int seqIndex) {
     std::ostringstream oss;
     oss << std::setw(3) << std::setfill('0') << seqIndex;
@@ -66,46 +192,123 @@ std::string sequenceLabel(const Sequence& seq, int seqIndex) {
     return oss.str();
 }
 
-std::string nodeLabel(const Occurrence& occ) {
+std::string nodeLabel(const FrameData& data, const Occurrence& occ) {
     std::ostringstream oss;
     oss << kindLabel(occ.kind);
-    if (occ.ifBlock) {
+    if (!occ.isEffect()) {
         oss << " [IF #" << occ.blockIndex << "]";
-    } else if (occ.efBlock) {
-        oss << " [EF #" << occ.blockIndex << ", no " << occ.efBlock->number << "]";
+    } else if (const Frame_EF* effect = resolveEf(data, occ)) {
+        oss << " [EF #" << occ.blockIndex << ", no " << effect->number << "]";
     }
     return oss.str();
 }
 
-void describeOccurrence(const Occurrence& occ, std::ostream& os) {
-    const Sequence& seq = *occ.sequence;
+void describeOccurrence(const FrameData& data, const Occurrence& occ, std::ostream& os) {
+    const Sequence& seq = *data.peek_sequence(occ.seqIndex);
     os << "- Pattern " << sequenceLabel(seq, occ.seqIndex)
        << ", Frame " << occ.frameIndex
        << ", " << kindLabel(occ.kind)
        << " [" << categoryLabel(occ.category) << "]";
 
-    if (occ.ifBlock) {
+    if (!occ.isEffect()) {
         os << " [IF #" << occ.blockIndex << "]";
-    } else if (occ.efBlock) {
+    } else if (const Frame_EF* effect = resolveEf(data, occ)) {
         os << " [EF #" << occ.blockIndex;
-        os << ", no " << occ.efBlock->number << "]";
+        os << ", no " << effect->number << "]";
     }
 
-    os << ", var " << currentVar(occ)
-       << ", raw " << (occ.valuePtr ? *occ.valuePtr : 0);
+    os << ", var " << currentVar(data, occ)
+       << ", raw " << rawValue(data, occ);
 
-    if (occ.encoding == ValueEncoding::TensComposite && occ.valuePtr) {
-        os << " (value digit " << compositeRemainder(occ) << ")";
+    if (occ.encoding() == ValueEncoding::TensComposite) {
+        os << " (value digit " << compositeRemainder(data, occ) << ")";
     }
 
     os << '\n';
 }
 
 
+std::string formatBytes(size_t bytes) {
+    std::ostringstream oss;
+    if (bytes >= 1024 * 1024) {
+        oss << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MiB";
+    } else if (bytes >= 1024) {
+        oss << std::fixed << std::setprecision(1) << bytes / 1024.0 << " KiB";
+    } else {
+        oss << bytes << " B";
+    }
+    return oss.str();
+}
+
+void printMemoryUsageRow(const std::string& label, const MemoryUsage& usage, std::ostream& os) {
+    os << "  " << std::left << std::setw(22) << label << std::right
+       << std::setw(12) << formatBytes(usage.bytes)
+       << std::setw(12) << formatBytes(usage.bytes - usage.used)
+       << std::setw(12) << formatBytes(usage.overhead)
+       << std::setw(10) << usage.allocations << '\n';
+}
+
+void printMemoryReport(const FrameData& data, const MemoryReport& report, int top, std::ostream& os) {
+    os << "  " << std::left << std::setw(22) << "Component" << std::right
+       << std::setw(12) << "Reserved"
+       << std::setw(12) << "Slack"
+       << std::setw(12) << "Overhead"
+       << std::setw(10) << "Allocs" << '\n';
+    for (const auto& component : report.components) {
+        printMemoryUsageRow(component.name, component.usage, os);
+    }
+    MemoryUsage total = report.total();
+    printMemoryUsageRow("total", total, os);
+    os << "  Estimated heap footprint: " << formatBytes(total.total()) << '\n';
+
+    if (top <= 0 || report.sequences.empty()) {
+        return;
+    }
+    std::vector<const MemoryReport::SequenceUsage*> order;
+    order.reserve(report.sequences.size());
+    for (const auto& entry : report.sequences) {
+        order.push_back(&entry);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto* a, const auto* b) {
+        return a->usage.total() > b->usage.total();
+    });
+    if (static_cast<int>(order.size()) > top) {
+        order.resize(top);
+    }
+    os << "\nLargest patterns:\n";
+    for (const auto* entry : order) {
+        const Sequence* seq = data.peek_sequence(entry->index);
+        std::string label = seq ? sequenceLabel(*seq, entry->index) : std::to_string(entry->index);
+        if (entry->shared) {
+            label += " (shared)";
+        }
+        printMemoryUsageRow(label, entry->usage, os);
+    }
+}
+
 void printUsage() {
     std::cout << "Usage:\n"
               << "  ha6_var_tool scan --file <path> [--var <id>]\n"
-              << "  ha6_var_tool replace --file <path> --from <id> --to <id> [--out <path> | --in-place] [--dry-run] [--log <path>] [--no-log]\n";
+              << "  ha6_var_tool replace --file <path> (--from <id> --to <id> | --map <[category:]from:to,...> | --map-file <path>)\n"
+              << "                       [--category <name>] [--out <path> | --in-place] [--dry-run] [--log <path>] [--no-log]\n"
+              << "    Mappings apply to the original values in one pass, so 3:7,7:3 swaps; --category scopes\n"
+              << "    entries that name no category. A projectile scope also covers projectile-nochange rows.\n"
+              << "  ha6_var_tool remap --file <path> --rule \"<category> <min>..<max> (+<n> | -<n> | *<k>[+<n>] | =<v>,<v>,...)\"\n"
+              << "                     [--allow-collisions] [--out <path> | --in-place] [--dry-run] [--log <path>] [--no-log]\n"
+              << "    Moves every id of the category in min..max, e.g. \"projectile 10..29 +40\". Refuses targets that\n"
+              << "    other ids already use unless --allow-collisions is given.\n"
+              << "  ha6_var_tool stats --file <path> [--memory] [--top <n>]\n"
+              << "  ha6_var_tool free --file <path> --category <name> [--count <n>] [--min <id>] [--max <id>]\n"
+              << "  ha6_var_tool defuse --file <path> [--category <name>] [--var <id> --pattern <index>]\n"
+              << "  ha6_var_tool refs --file <path> --pattern <index>\n"
+              << "  ha6_var_tool spawns --file <path> [--pattern <index>]\n"
+              << "  ha6_var_tool ranges --file <path>\n"
+              << "  ha6_var_tool params --file <path> --query \"<if|ef> <type>[#<number>] p<slot>=<value>[..<value>]\"\n"
+              << "Any command accepts --profile to print allocation counts per phase\n"
+              << "--threads <n> to scan with n workers (0 = all cores, default 1)\n"
+              << "--schema <path> to add or override tracked kinds from a schema file\n"
+              << "--cache to write the <file>.varswap-index scan sidecar next to the input after a scan\n"
+              << "and --no-cache to ignore an existing sidecar.\n";
 }
 
 fs::path defaultOutputPath(const fs::path& input) {
@@ -187,15 +390,43 @@ int main(int argc, char** argv) {
     std::optional<int> toVar;
     std::optional<fs::path> outPath;
     std::optional<fs::path> logPath;
+    std::optional<fs::path> schemaPath;
     bool inPlace = false;
     bool dryRun = false;
     bool disableLog = false;
+    bool memoryStats = false;
+    bool profile = false;
+    bool useSidecar = true;
+    bool writeSidecar = false;
+    int scanThreads = 1;
+    int topSequences = 10;
+    std::optional<VarCategory> categoryArg;
+    int freeCount = 1;
+    std::optional<int> patternArg;
+    std::optional<ParamQuery> paramQuery;
+    std::vector<VarMapping> mappings;
+    std::optional<VarRemap> remapRule;
+    bool allowCollisions = false;
+    VarRange freeRange;
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--file" && i + 1 < argc) {
             inputPath = argv[++i];
-        } else if (command == "scan" && arg == "--var" && i + 1 < argc) {
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--cache") {
+            writeSidecar = true;
+        } else if (arg == "--no-cache") {
+            useSidecar = false;
+        } else if (arg == "--schema" && i + 1 < argc) {
+            schemaPath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            if (!parseInt(argv[++i], scanThreads) || scanThreads < 0) {
+                std::cerr << "Invalid value for --threads" << std::endl;
+                return 1;
+            }
+        } else if ((command == "scan" || command == "defuse") && arg == "--var" && i + 1 < argc) {
             int parsed = 0;
             if (!parseInt(argv[++i], parsed)) {
                 std::cerr << "Invalid value for --var" << std::endl;
@@ -216,16 +447,83 @@ int main(int argc, char** argv) {
                 return 1;
             }
             toVar = parsed;
-        } else if (command == "replace" && arg == "--out" && i + 1 < argc) {
+        } else if (command == "replace" && arg == "--map" && i + 1 < argc) {
+            std::string error;
+            if (!parseMappingList(argv[++i], mappings, error)) {
+                std::cerr << "Invalid value for --map: " << error << std::endl;
+                return 1;
+            }
+        } else if (command == "replace" && arg == "--map-file" && i + 1 < argc) {
+            std::string error;
+            if (!loadMappingFile(argv[++i], mappings, error)) {
+                std::cerr << "Invalid mapping file: " << error << std::endl;
+                return 1;
+            }
+        } else if (command == "remap" && arg == "--rule" && i + 1 < argc) {
+            VarRemap parsed;
+            std::string error;
+            if (!varswap::parseVarRemap(argv[++i], parsed, error)) {
+                std::cerr << "Invalid value for --rule: " << error << std::endl;
+                return 1;
+            }
+            remapRule = std::move(parsed);
+        } else if (command == "remap" && arg == "--allow-collisions") {
+            allowCollisions = true;
+        } else if ((command == "replace" || command == "remap") && arg == "--out" && i + 1 < argc) {
             outPath = argv[++i];
-        } else if (command == "replace" && arg == "--in-place") {
+        } else if ((command == "replace" || command == "remap") && arg == "--in-place") {
             inPlace = true;
-        } else if (command == "replace" && arg == "--dry-run") {
+        } else if ((command == "replace" || command == "remap") && arg == "--dry-run") {
             dryRun = true;
-        } else if (command == "replace" && arg == "--log" && i + 1 < argc) {
+        } else if ((command == "replace" || command == "remap") && arg == "--log" && i + 1 < argc) {
             logPath = argv[++i];
-        } else if (command == "replace" && arg == "--no-log") {
+        } else if ((command == "replace" || command == "remap") && arg == "--no-log") {
             disableLog = true;
+        } else if (command == "stats" && arg == "--memory") {
+            memoryStats = true;
+        } else if (command == "stats" && arg == "--top" && i + 1 < argc) {
+            if (!parseInt(argv[++i], topSequences) || topSequences < 0) {
+                std::cerr << "Invalid value for --top" << std::endl;
+                return 1;
+            }
+        } else if ((command == "defuse" || command == "refs" || command == "spawns") && arg == "--pattern" && i + 1 < argc) {
+            int parsed = 0;
+            if (!parseInt(argv[++i], parsed) || parsed < 0) {
+                std::cerr << "Invalid value for --pattern" << std::endl;
+                return 1;
+            }
+            patternArg = parsed;
+        } else if (command == "params" && arg == "--query" && i + 1 < argc) {
+            ParamQuery parsed;
+            std::string error;
+            if (!varswap::parseParamQuery(argv[++i], parsed, error)) {
+                std::cerr << "Invalid value for --query: " << error << std::endl;
+                return 1;
+            }
+            paramQuery = parsed;
+        } else if ((command == "free" || command == "defuse" || command == "replace") && arg == "--category" &&
+                   i + 1 < argc) {
+            VarCategory parsed;
+            if (!varswap::parseCategoryName(argv[++i], parsed)) {
+                std::cerr << "Invalid value for --category" << std::endl;
+                return 1;
+            }
+            categoryArg = parsed;
+        } else if (command == "free" && arg == "--count" && i + 1 < argc) {
+            if (!parseInt(argv[++i], freeCount) || freeCount <= 0) {
+                std::cerr << "Invalid value for --count" << std::endl;
+                return 1;
+            }
+        } else if (command == "free" && arg == "--min" && i + 1 < argc) {
+            if (!parseInt(argv[++i], freeRange.min)) {
+                std::cerr << "Invalid value for --min" << std::endl;
+                return 1;
+            }
+        } else if (command == "free" && arg == "--max" && i + 1 < argc) {
+            if (!parseInt(argv[++i], freeRange.max)) {
+                std::cerr << "Invalid value for --max" << std::endl;
+                return 1;
+            }
         } else {
             std::cerr << "Unknown or misplaced argument: " << arg << std::endl;
             printUsage();
@@ -238,24 +536,113 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (schemaPath) {
+        varswap::OccurrenceSchema schema = varswap::OccurrenceSchema::builtIn();
+        std::string error;
+        if (!schema.loadFile(schemaPath->string(), error) || !varswap::installSchema(schema, error)) {
+            std::cerr << "Invalid schema: " << error << std::endl;
+            return 1;
+        }
+    }
+
+    ProfileReportOnExit profileReport;
+    if (profile) {
+        AllocProfiler::instance().setEnabled(true);
+    }
+
     FrameData data;
-    if (!data.load(inputPath.string().c_str())) {
-        std::cerr << "Failed to load HA6 file: " << inputPath << std::endl;
-        return 1;
+    {
+        AllocProfiler::Scope phase("load");
+        if (!data.load(inputPath.string().c_str())) {
+            std::cerr << "Failed to load HA6 file: " << inputPath << std::endl;
+            return 1;
+        }
     }
 
-    auto occurrences = collectOccurrences(data);
+    // A sidecar written for the same bytes and schema stands in for the
+    // scan, the value decode and the var index keys. Reading one is the
+    // default; writing it next to the input only happens with --cache.
+    varswap::ScanSidecar sidecar;
+    bool sidecarHit = false;
+    std::string sidecarPath = varswap::scanSidecarPath(inputPath.string());
+    if (useSidecar) {
+        AllocProfiler::Scope phase("sidecar");
+        std::string error;
+        useSidecar = varswap::hashFileContents({inputPath.string()}, sidecar.contentHash, error);
+        sidecarHit = useSidecar && varswap::readScanSidecar(sidecarPath, sidecar.contentHash, data, sidecar, error);
+    }
+
+    std::vector<Occurrence> occurrences;
+    // Decoded var and remainder per occurrence; filled whenever the sidecar
+    // is read or written, otherwise left empty for the commands that decode themselves.
+    std::vector<int> vars;
+    std::vector<int> remainders;
+    VarIndex varIndex;
+    if (sidecarHit) {
+        occurrences = std::move(sidecar.occurrences);
+        vars = std::move(sidecar.vars);
+        remainders = std::move(sidecar.remainders);
+    } else {
+        {
+            AllocProfiler::Scope phase("scan");
+            occurrences = collectOccurrences(data, static_cast<unsigned>(scanThreads));
+        }
+        if (useSidecar && writeSidecar) {
+            AllocProfiler::Scope phase("sidecar");
+            vars.resize(occurrences.size());
+            remainders.resize(occurrences.size());
+            varswap::decodeOccurrenceValues(data, occurrences.data(), occurrences.size(), vars.data(),
+                                            remainders.data());
+            varIndex.build(data, occurrences);
+            sidecar.occurrences = occurrences;
+            sidecar.vars = vars;
+            sidecar.remainders = remainders;
+            sidecar.varKeys = varIndex.keys();
+            std::string error;
+            if (!varswap::writeScanSidecar(sidecarPath, sidecar, error)) {
+                std::cerr << "Warning: " << error << std::endl;
+            }
+        }
+    }
+
+    // Only var lookups need the index; a plain scan lists everything.
+    std::vector<std::uint32_t> matchIds;
+    std::optional<int> lookupVar = (command == "scan") ? scanVar : std::nullopt;
+    if (lookupVar) {
+        AllocProfiler::Scope phase("index");
+        if (sidecarHit) {
+            varIndex.assign(std::move(sidecar.varKeys));
+        } else if (varIndex.empty()) {
+            varIndex.build(data, occurrences);
+        }
+        matchIds = varIndex.findVar(*lookupVar);
+    }
 
     if (command == "scan") {
         int totalMatches = 0;
         std::map<OccurrenceKind, int> perKind;
-        for (auto& occ : occurrences) {
-            if (scanVar && currentVar(occ) != *scanVar) {
-                continue;
+        auto forEachListed = [&](auto&& fn) {
+            if (scanVar) {
+                for (std::uint32_t id : matchIds) {
+                    fn(occurrences[id]);
+                }
+            } else {
+                for (const auto& occ : occurrences) {
+                    fn(occ);
+                }
             }
-            describeOccurrence(occ, std::cout);
-            ++totalMatches;
-            perKind[occ.kind]++;
+        };
+        {
+            // Row labels, the CLI's counterpart of the pane's metadata.
+            AllocProfiler::Scope phase("metadata");
+            forEachListed([&](const Occurrence& occ) { describeOccurrence(data, occ, std::cout); });
+        }
+        {
+            AllocProfiler::Scope phase("summary");
+            forEachListed([&](const Occurrence& occ) {
+                ++totalMatches;
+                perKind[occ.kind]++;
+            });
         }
 
         if (totalMatches == 0) {
@@ -277,64 +664,492 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    // Var edits decode against the values before the first write.
+    auto ensureValueColumns = [&]() {
+        if (vars.size() != occurrences.size()) {
+            vars.resize(occurrences.size());
+            remainders.resize(occurrences.size());
+            varswap::decodeOccurrenceValues(data, occurrences.data(), occurrences.size(), vars.data(),
+                                            remainders.data());
+        }
+    };
+
+    // Writes the edited document and its change log, or reports a dry run.
+    auto saveEdits = [&](const std::vector<LogEntry>& logEntries) {
+        fs::path output = inPlace ? inputPath : (outPath ? *outPath : defaultOutputPath(inputPath));
+
+        if (dryRun) {
+            std::cout << "Dry run only. No file was written." << std::endl;
+            if (!logEntries.empty()) {
+                std::cout << "Log file generation is skipped during dry runs." << std::endl;
+            }
+            return 0;
+        }
+
+        {
+            AllocProfiler::Scope phase("save");
+            data.save(output.string().c_str());
+        }
+        std::cout << "Updated file written to " << output << std::endl;
+
+        if (!disableLog && !logEntries.empty()) {
+            fs::path resolvedLog = logPath ? *logPath : defaultLogPath(output);
+            writeLogFile(resolvedLog, output, logEntries);
+            std::cout << "Logged " << logEntries.size()
+                      << " occurrence(s) to " << resolvedLog << std::endl;
+        } else if (disableLog) {
+            std::cout << "Log file generation disabled for this run." << std::endl;
+        }
+        return 0;
+    };
+
     if (command == "replace") {
-        if (!fromVar || !toVar) {
-            std::cerr << "--from and --to are required for replace" << std::endl;
+        if (fromVar.has_value() != toVar.has_value()) {
+            std::cerr << "--from and --to must be given together" << std::endl;
+            return 1;
+        }
+        if (fromVar) {
+            mappings.push_back({std::nullopt, *fromVar, *toVar});
+        }
+        if (mappings.empty()) {
+            std::cerr << "--from/--to, --map or --map-file is required for replace" << std::endl;
             return 1;
         }
 
+        // A category-scoped entry wins over an unscoped one for the same var.
+        // The lookup key's top bits hold the category's id space, so a
+        // projectile entry also covers ProjectileNoChange rows, or Count when
+        // unscoped.
+        auto mappingKey = [](std::optional<VarCategory> category, int var) {
+            auto scope = static_cast<std::uint64_t>(category ? varIdSpace(*category) : VarCategory::Count);
+            return (scope << 32) | static_cast<std::uint32_t>(var);
+        };
+        std::map<std::uint64_t, size_t> lookup;
+        for (size_t i = 0; i < mappings.size(); ++i) {
+            if (!mappings[i].category) {
+                mappings[i].category = categoryArg;
+            }
+            if (!lookup.emplace(mappingKey(mappings[i].category, mappings[i].fromVar), i).second) {
+                std::cerr << "Var " << mappings[i].fromVar << " is mapped more than once" << std::endl;
+                return 1;
+            }
+        }
+
         int modifiedCount = 0;
         std::vector<LogEntry> logEntries;
-        for (auto& occ : occurrences) {
-            if (currentVar(occ) == *fromVar) {
-                int rawBefore = occ.valuePtr ? *occ.valuePtr : 0;
-                int rawAfter = (occ.encoding == ValueEncoding::Direct)
-                                   ? *toVar
-                                   : (*toVar * 10 + compositeRemainder(occ));
-                logEntries.push_back({*fromVar,
-                                      *toVar,
+        {
+            AllocProfiler::Scope phase("apply");
+            // Every lookup uses the var decoded before the first write, so
+            // swaps and longer cycles (3:7,7:3) map each block exactly once.
+            ensureValueColumns();
+            for (size_t id = 0; id < occurrences.size(); ++id) {
+                const auto& occ = occurrences[id];
+                auto it = lookup.find(mappingKey(occ.category, vars[id]));
+                if (it == lookup.end()) {
+                    it = lookup.find(mappingKey(std::nullopt, vars[id]));
+                }
+                if (it == lookup.end()) {
+                    continue;
+                }
+                VarMapping& mapping = mappings[it->second];
+                if (mapping.fromVar == mapping.toVar) {
+                    continue;
+                }
+                // Dry runs edit the in-memory copy too, only the save is
+                // skipped, so the logged raw value is the one that would be
+                // written.
+                int rawBefore = rawValue(data, occ);
+                applyVarChange(data, occ, mapping.toVar);
+                logEntries.push_back({mapping.fromVar,
+                                      mapping.toVar,
                                       occ.seqIndex,
-                                      sequenceLabel(*occ.sequence, occ.seqIndex),
+                                      sequenceLabel(*data.peek_sequence(occ.seqIndex), occ.seqIndex),
                                       occ.frameIndex,
-                                      nodeLabel(occ),
+                                      nodeLabel(data, occ),
                                       rawBefore,
-                                      rawAfter});
+                                      rawValue(data, occ)});
+                ++mapping.applied;
                 ++modifiedCount;
-                if (!dryRun) {
-                    applyVarChange(occ, *toVar);
-                }
             }
         }
 
         if (modifiedCount == 0) {
-            std::cout << "No occurrences with var " << *fromVar << " found." << std::endl;
+            std::cout << "No occurrences of the mapped vars found." << std::endl;
             return 0;
         }
 
+        for (const VarMapping& mapping : mappings) {
+            std::cout << "  ";
+            if (mapping.category) {
+                std::cout << categoryLabel(*mapping.category) << ' ';
+            }
+            std::cout << "var " << mapping.fromVar << " -> " << mapping.toVar << ": " << mapping.applied << '\n';
+        }
         std::cout << modifiedCount << " occurrence(s) "
                   << (dryRun ? "would be" : "were")
-                  << " updated from var " << *fromVar << " to " << *toVar << "." << std::endl;
+                  << " updated by " << mappings.size() << " mapping(s)." << std::endl;
 
-        fs::path output = inPlace ? inputPath : (outPath ? *outPath : defaultOutputPath(inputPath));
+        return saveEdits(logEntries);
+    }
 
-        if (dryRun) {
-            std::cout << "Dry run only. No file was written." << std::endl;
-            if (!logEntries.empty()) {
-                std::cout << "Log file generation is skipped during dry runs." << std::endl;
+    if (command == "remap") {
+        if (!remapRule) {
+            std::cerr << "--rule is required for remap" << std::endl;
+            return 1;
+        }
+        ensureValueColumns();
+
+        varswap::RemapPlan plan;
+        {
+            AllocProfiler::Scope phase("plan");
+            std::string error;
+            if (!varswap::planVarRemap(data, occurrences, vars.data(), *remapRule, plan, error)) {
+                std::cerr << "Invalid remap: " << error << std::endl;
+                return 1;
+            }
+        }
+
+        auto printIds = [](const char* label, const std::vector<int>& ids) {
+            std::cout << label << ':';
+            for (int varId : ids) {
+                std::cout << ' ' << varId;
+            }
+            std::cout << '\n';
+        };
+        bool refused = false;
+        if (!plan.unencodable.empty()) {
+            std::cerr << plan.unencodable.size() << " occurrence(s) cannot hold their new id:" << std::endl;
+            for (std::uint32_t id : plan.unencodable) {
+                describeOccurrence(data, occurrences[id], std::cerr);
             }
+            refused = true;
+        }
+        if (!plan.merged.empty()) {
+            printIds("Ids reached from more than one source id", plan.merged);
+            refused = refused || !allowCollisions;
+        }
+        if (!plan.collisions.empty()) {
+            printIds("Ids already used outside the source range", plan.collisions);
+            refused = refused || !allowCollisions;
+        }
+        if (refused) {
+            std::cerr << "Remap refused; nothing was changed." << std::endl;
+            return 1;
+        }
+        if (plan.ids.empty()) {
+            std::cout << "No occurrences in the source range found." << std::endl;
             return 0;
         }
 
-        data.save(output.string().c_str());
-        std::cout << "Updated file written to " << output << std::endl;
+        std::vector<LogEntry> logEntries;
+        {
+            AllocProfiler::Scope phase("apply");
+            if (!disableLog && !dryRun) {
+                logEntries.reserve(plan.ids.size());
+                for (size_t j = 0; j < plan.ids.size(); ++j) {
+                    const Occurrence& occ = occurrences[plan.ids[j]];
+                    logEntries.push_back({plan.fromVars[j],
+                                          plan.toVars[j],
+                                          occ.seqIndex,
+                                          sequenceLabel(*data.peek_sequence(occ.seqIndex), occ.seqIndex),
+                                          occ.frameIndex,
+                                          nodeLabel(data, occ),
+                                          rawValue(data, occ),
+                                          plan.rawValues[j]});
+                }
+            }
+            varswap::applyRemapPlan(data, occurrences, plan);
+        }
+        std::cout << plan.ids.size() << " occurrence(s) " << (dryRun ? "would be" : "were") << " remapped." << std::endl;
+        return saveEdits(logEntries);
+    }
 
-        if (!disableLog && !logEntries.empty()) {
-            fs::path resolvedLog = logPath ? *logPath : defaultLogPath(output);
-            writeLogFile(resolvedLog, output, logEntries);
-            std::cout << "Logged " << logEntries.size()
-                      << " occurrence(s) to " << resolvedLog << std::endl;
-        } else if (disableLog) {
-            std::cout << "Log file generation disabled for this run." << std::endl;
+    if (command == "stats") {
+        size_t frameCount = 0;
+        size_t efCount = 0;
+        size_t ifCount = 0;
+        for (int i = 0; i < data.get_sequence_count(); ++i) {
+            const Sequence* seq = data.peek_sequence(i);
+            frameCount += seq->frames.size();
+            for (const auto& frame : seq->frames) {
+                efCount += frame.EF.size();
+                ifCount += frame.IF.size();
+            }
+        }
+        std::cout << "Patterns: " << data.get_sequence_count()
+                  << ", frames: " << frameCount
+                  << ", EF blocks: " << efCount
+                  << ", IF blocks: " << ifCount
+                  << ", occurrences: " << occurrences.size() << std::endl;
+
+        if (memoryStats) {
+            MemoryReport report = data.memoryReport();
+            report.component("scan occurrences").add_vector(occurrences);
+            std::cout << "\nMemory:\n";
+            printMemoryReport(data, report, topSequences, std::cout);
+        }
+        return 0;
+    }
+
+    if (command == "free") {
+        if (!categoryArg) {
+            std::cerr << "--category is required for free" << std::endl;
+            return 1;
+        }
+
+        VarUsage usage;
+        std::vector<int> freeVars;
+        {
+            AllocProfiler::Scope phase("index");
+            if (vars.size() == occurrences.size()) {
+                usage.build(occurrences, vars.data());
+            } else {
+                usage.build(data, occurrences);
+            }
+            freeVars = usage.findFreeVars(*categoryArg, freeCount, freeRange);
+        }
+
+        auto countBits = [](const std::vector<std::uint64_t>& bits) {
+            size_t count = 0;
+            for (std::uint64_t word : bits) {
+                for (; word; word &= word - 1) {
+                    ++count;
+                }
+            }
+            return count;
+        };
+        std::cout << categoryLabel(*categoryArg) << " vars used: " << usage.usedCount(*categoryArg)
+                  << " (read-only " << countBits(usage.readOnly(*categoryArg))
+                  << ", written-only " << countBits(usage.writeOnly(*categoryArg))
+                  << ", both " << countBits(usage.readWrite(*categoryArg)) << ")" << std::endl;
+
+        if (freeVars.empty()) {
+            std::cout << "No free ids in " << freeRange.min << ".." << freeRange.max << "." << std::endl;
+            return 0;
+        }
+        std::cout << "Free ids in " << freeRange.min << ".." << freeRange.max << ":";
+        for (int varId : freeVars) {
+            std::cout << ' ' << varId;
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+
+    if (command == "refs") {
+        if (!patternArg || *patternArg >= data.get_sequence_count()) {
+            std::cerr << "--pattern must name an existing pattern" << std::endl;
+            return 1;
+        }
+
+        PatternXref xref;
+        {
+            AllocProfiler::Scope phase("index");
+            xref.build(data);
+        }
+        const auto& refs = xref.referencesTo(*patternArg);
+        const Sequence* target = data.peek_sequence(*patternArg);
+        std::string targetLabel = target ? sequenceLabel(*target, *patternArg) : std::to_string(*patternArg);
+        if (refs.empty()) {
+            std::cout << "Nothing references " << targetLabel << "." << std::endl;
+            return 0;
+        }
+        for (const PatternRef& ref : refs) {
+            const Sequence* seq = data.peek_sequence(ref.seqIndex);
+            std::cout << (seq ? sequenceLabel(*seq, ref.seqIndex) : std::to_string(ref.seqIndex))
+                      << " | frame " << ref.frameIndex << " | " << varswap::patternRefSourceLabel(ref.source);
+            if (ref.blockIndex >= 0) {
+                std::cout << " #" << ref.blockIndex << " slot " << static_cast<int>(ref.slot);
+            }
+            std::cout << '\n';
+        }
+        std::cout << "\n" << refs.size() << " reference(s) to " << targetLabel << "." << std::endl;
+        return 0;
+    }
+
+    if (command == "params") {
+        if (!paramQuery) {
+            std::cerr << "--query is required for params" << std::endl;
+            return 1;
+        }
+
+        std::vector<ParamHit> hits;
+        {
+            AllocProfiler::Scope phase("index");
+            BlockTable table;
+            table.build(data);
+            ParamIndex index;
+            index.build(table);
+            hits = index.find(*paramQuery);
+        }
+        for (const ParamHit& hit : hits) {
+            const Sequence* seq = data.peek_sequence(hit.seqIndex);
+            std::cout << (seq ? sequenceLabel(*seq, hit.seqIndex) : std::to_string(hit.seqIndex)) << " | frame "
+                      << hit.frameIndex << " | " << (paramQuery->isEffect ? "EF" : "IF") << paramQuery->type;
+            if (paramQuery->isEffect) {
+                std::cout << " #" << hit.number;
+            }
+            std::cout << " block " << hit.blockIndex << " | p" << paramQuery->slot << " = " << hit.value << '\n';
+        }
+        std::cout << "\n" << hits.size() << " block(s) matched." << std::endl;
+        return 0;
+    }
+
+    if (command == "ranges") {
+        VarRangeAnalysis analysis;
+        std::vector<varswap::CheckFinding> checks;
+        {
+            AllocProfiler::Scope phase("index");
+            analysis.build(data);
+            checks = analysis.decidedChecks();
+        }
+        auto label = [&data](int seqIndex) {
+            const Sequence* seq = data.peek_sequence(seqIndex);
+            return seq ? sequenceLabel(*seq, seqIndex) : std::to_string(seqIndex);
+        };
+        auto bound = [](int value) {
+            return value == INT_MIN ? std::string("-inf") : value == INT_MAX ? std::string("inf") : std::to_string(value);
+        };
+        const char* compareOps[] = {">", "<", "=="};
+        for (const auto& check : checks) {
+            const char* op = (check.compareMode >= 0 && check.compareMode < 3) ? compareOps[check.compareMode] : "?";
+            std::cout << label(check.seqIndex) << " | frame " << check.frameIndex << " | IF #" << check.blockIndex
+                      << " V" << check.var << ' ' << op << ' ' << check.compareValue << " | range ["
+                      << bound(check.range.lo) << ", " << bound(check.range.hi) << "] | "
+                      << varswap::checkVerdictLabel(check.verdict) << '\n';
+        }
+        auto deadWrites = analysis.deadWrites();
+        for (const auto& write : deadWrites) {
+            std::cout << label(write.seqIndex) << " | frame " << write.frameIndex << " | "
+                      << (write.isEffect ? "EF #" : "IF #") << write.blockIndex << " V" << write.var
+                      << " | overwritten before read\n";
+        }
+        std::cout << "\n" << checks.size() << " comparison(s) with a fixed outcome, " << deadWrites.size()
+                  << " dead write(s)." << std::endl;
+        return 0;
+    }
+
+    if (command == "spawns") {
+        if (patternArg && *patternArg >= data.get_sequence_count()) {
+            std::cerr << "--pattern must name an existing pattern" << std::endl;
+            return 1;
+        }
+
+        SpawnTree tree;
+        std::vector<SpawnImbalance> imbalances;
+        {
+            AllocProfiler::Scope phase("index");
+            tree.build(data);
+            imbalances = tree.imbalances();
+        }
+        auto label = [&data](int seqIndex) {
+            const Sequence* seq = data.peek_sequence(seqIndex);
+            return seq ? sequenceLabel(*seq, seqIndex) : std::to_string(seqIndex);
+        };
+        auto printDeltas = [](const char* heading, const std::vector<RegisterDelta>& deltas) {
+            std::cout << heading;
+            if (deltas.empty()) {
+                std::cout << " balanced";
+            }
+            for (const RegisterDelta& entry : deltas) {
+                std::cout << " V" << entry.var << (entry.delta >= 0 ? " +" : " ") << entry.delta
+                          << (entry.unbounded ? " per loop" : "");
+            }
+            std::cout << '\n';
+        };
+
+        if (patternArg) {
+            std::cout << label(*patternArg) << '\n';
+            std::cout << "  spawns:";
+            for (const auto& edge : tree.spawnTargets(*patternArg)) {
+                std::cout << ' ' << edge.first;
+                if (edge.second > 1) {
+                    std::cout << " x" << edge.second;
+                }
+            }
+            std::cout << "\n  spawned by:";
+            for (int parent : tree.spawnedBy(*patternArg)) {
+                std::cout << ' ' << parent;
+            }
+            std::cout << '\n';
+            printDeltas("  own:", tree.ownDelta(*patternArg));
+            printDeltas("  subtree:", tree.subtreeDelta(*patternArg));
+            std::cout.flush();
+            return 0;
+        }
+
+        for (const SpawnImbalance& entry : imbalances) {
+            std::cout << label(entry.root) << " | V" << entry.var << (entry.net >= 0 ? " +" : " ") << entry.net
+                      << (entry.unbounded ? " per loop" : "") << " |";
+            for (int seqIndex : tree.imbalancePath(entry.root, entry.var)) {
+                std::cout << ' ' << seqIndex;
+            }
+            std::cout << '\n';
+        }
+        std::cout << "\n" << imbalances.size() << " unbalanced spawn tree register(s)." << std::endl;
+        return 0;
+    }
+
+    if (command == "defuse") {
+        if (scanVar.has_value() != patternArg.has_value() || (scanVar && !categoryArg)) {
+            std::cerr << "--var needs --pattern and --category" << std::endl;
+            return 1;
+        }
+
+        DefUseGraph graph;
+        {
+            AllocProfiler::Scope phase("index");
+            if (vars.size() != occurrences.size()) {
+                vars.resize(occurrences.size());
+                remainders.resize(occurrences.size());
+                varswap::decodeOccurrenceValues(data, occurrences.data(), occurrences.size(), vars.data(),
+                                                remainders.data());
+            }
+            graph.build(data, occurrences, vars.data());
+        }
+
+        auto printPatterns = [&](const std::vector<int>& patterns) {
+            for (int seqIndex : patterns) {
+                const Sequence* seq = data.peek_sequence(seqIndex);
+                std::cout << "  " << (seq ? sequenceLabel(*seq, seqIndex) : std::to_string(seqIndex)) << '\n';
+            }
+        };
+
+        if (scanVar) {
+            VarCategory category = *categoryArg;
+            if (*patternArg >= data.get_sequence_count()) {
+                std::cerr << "Pattern " << *patternArg << " does not exist" << std::endl;
+                return 1;
+            }
+            std::vector<int> writers = graph.writersReaching(category, *scanVar, *patternArg);
+            if (writers.empty()) {
+                std::cout << "No writer of " << categoryLabel(category) << " var " << *scanVar
+                          << " can reach pattern " << *patternArg << "." << std::endl;
+                return 0;
+            }
+            std::cout << writers.size() << " pattern(s) writing " << categoryLabel(category) << " var "
+                      << *scanVar << " can reach pattern " << *patternArg << ":\n";
+            printPatterns(writers);
+            return 0;
+        }
+
+        auto printIds = [](const char* label, const std::vector<int>& ids) {
+            std::cout << "  " << label << ':';
+            if (ids.empty()) {
+                std::cout << " none";
+            }
+            for (int varId : ids) {
+                std::cout << ' ' << varId;
+            }
+            std::cout << '\n';
+        };
+        for (int c = 0; c < static_cast<int>(VarCategory::Count); ++c) {
+            VarCategory category = static_cast<VarCategory>(c);
+            if (categoryArg ? category != *categoryArg : category == VarCategory::ProjectileNoChange) {
+                continue;
+            }
+            std::cout << categoryLabel(category) << ":\n";
+            printIds("read but never written", graph.readNeverWritten(category));
+            printIds("written but never read", graph.writtenNeverRead(category));
         }
         return 0;
     }
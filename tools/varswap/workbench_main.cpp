@@ -1,5 +1,8 @@
 #include "context_gl.h"
+#include "varswap/alloc_profile.h"
 #include "varswap/varswap_pane.h"
+#include "varswap/occurrence_schema.h"
+#include "varswap/scan_sidecar.h"
 #include "framedata.h"
 #include "filedialog.h"
 #include "ui/font_loader.h"
@@ -17,9 +20,12 @@
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 #endif
 
+#include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <cwchar>
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -28,6 +34,10 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg
 #include <utility>
 #include <vector>
 
+#ifndef VARSWAP_NO_ALLOC_HOOKS
+#include "varswap/alloc_hooks.inl"
+#endif
+
 HWND mainWindowHandle = nullptr;
 ImVec2 clientRect = ImVec2(1280.f, 720.f);
 
@@ -35,6 +45,49 @@ namespace {
 ContextGl* gContext = nullptr;
 char gIniPath[MAX_PATH] = {};
 
+constexpr int kMinUndoHistoryMb = 1;
+constexpr int kMaxUndoHistoryMb = 256;
+
+// Workbench options kept in varswap_workbench.ini as [VarSwap][Workbench],
+// next to the window layout. Loaded before the frame is built; written back
+// whenever ImGui saves the ini.
+struct WorkbenchSettings {
+    bool allocProfile = false;
+    int undoHistoryMb = static_cast<int>(varswap::EditJournal::kDefaultMemoryLimit >> 20);
+};
+WorkbenchSettings gWorkbenchSettings;
+
+void* WorkbenchSettingsOpen(ImGuiContext*, ImGuiSettingsHandler*, const char* name) {
+    return std::strcmp(name, "Workbench") == 0 ? &gWorkbenchSettings : nullptr;
+}
+
+void WorkbenchSettingsReadLine(ImGuiContext*, ImGuiSettingsHandler*, void* entry, const char* line) {
+    auto* settings = static_cast<WorkbenchSettings*>(entry);
+    int value = 0;
+    if (std::sscanf(line, "AllocProfile=%d", &value) == 1) {
+        settings->allocProfile = value != 0;
+    } else if (std::sscanf(line, "UndoHistoryMB=%d", &value) == 1) {
+        settings->undoHistoryMb = std::clamp(value, kMinUndoHistoryMb, kMaxUndoHistoryMb);
+    }
+}
+
+void WorkbenchSettingsWriteAll(ImGuiContext*, ImGuiSettingsHandler*, ImGuiTextBuffer* out) {
+    out->append("[VarSwap][Workbench]\n");
+    out->appendf("AllocProfile=%d\n", gWorkbenchSettings.allocProfile ? 1 : 0);
+    out->appendf("UndoHistoryMB=%d\n", gWorkbenchSettings.undoHistoryMb);
+    out->append("\n");
+}
+
+void RegisterWorkbenchSettings() {
+    ImGuiSettingsHandler handler;
+    handler.TypeName = "VarSwap";
+    handler.TypeHash = ImHashStr("VarSwap");
+    handler.ReadOpenFn = WorkbenchSettingsOpen;
+    handler.ReadLineFn = WorkbenchSettingsReadLine;
+    handler.WriteAllFn = WorkbenchSettingsWriteAll;
+    ImGui::AddSettingsHandler(&handler);
+}
+
 std::string WideToUtf8(const std::wstring& input) {
     if (input.empty()) {
         return {};
@@ -105,6 +158,11 @@ public:
             SetStatus("Pending changes");
         };
         defaultDockLayoutPending = (gIniPath[0] == '\0') ? true : !std::filesystem::exists(gIniPath);
+        LoadSchemaOverrides();
+        pane->setUndoMemoryLimit(static_cast<size_t>(gWorkbenchSettings.undoHistoryMb) << 20);
+        if (gWorkbenchSettings.allocProfile) {
+            SetAllocProfiling(true, false);
+        }
     }
 
     void RenderFrame() {
@@ -116,6 +174,8 @@ public:
         DrawMenuBar();
         HandleShortcuts();
         pane->Draw();
+        DrawMemoryWindow();
+        DrawAllocProfileWindow();
         DrawWelcomeOverlay();
         DrawStatusBar();
 
@@ -162,6 +222,23 @@ public:
         return dirty;
     }
 
+    // Counts allocations per phase (load, scan, metadata, summary, apply,
+    // remap, save, ...) from here on. `persist` stores the choice in the ini.
+    void SetAllocProfiling(bool enabled, bool persist) {
+        varswap::AllocProfiler& profiler = varswap::AllocProfiler::instance();
+        if (enabled && !profiler.enabled()) {
+            profiler.reset();
+        }
+        profiler.setEnabled(enabled);
+        if (enabled) {
+            showAllocProfileWindow = true;
+        }
+        if (persist && gWorkbenchSettings.allocProfile != enabled) {
+            gWorkbenchSettings.allocProfile = enabled;
+            ImGui::MarkIniSettingsDirty();
+        }
+    }
+
 private:
     ContextGl* context;
     FrameData frameData;
@@ -172,6 +249,10 @@ private:
     bool dirty = false;
     std::string statusMessage;
     bool defaultDockLayoutPending = false;
+    bool showMemoryWindow = false;
+    bool showAllocProfileWindow = false;
+    MemoryReport documentMemory;
+    MemoryReport paneMemory;
 
     void DrawDockspace() {
         ImGuiWindowFlags windowFlags = ImGuiWindowFlags_NoTitleBar |
@@ -229,10 +310,197 @@ private:
                 }
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("Edit")) {
+                if (ImGui::MenuItem("Undo", "Ctrl+Z", false, pane->canUndo())) {
+                    pane->Undo();
+                }
+                if (ImGui::MenuItem("Redo", "Ctrl+Y", false, pane->canRedo())) {
+                    pane->Redo();
+                }
+                ImGui::Separator();
+                int historyMb = static_cast<int>(pane->undoMemoryLimit() >> 20);
+                if (ImGui::SliderInt("History (MB)", &historyMb, kMinUndoHistoryMb, kMaxUndoHistoryMb)) {
+                    pane->setUndoMemoryLimit(static_cast<size_t>(historyMb) << 20);
+                    gWorkbenchSettings.undoHistoryMb = historyMb;
+                    ImGui::MarkIniSettingsDirty();
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Debug")) {
+                if (ImGui::MenuItem("Memory Report", nullptr, showMemoryWindow)) {
+                    showMemoryWindow = !showMemoryWindow;
+                    if (showMemoryWindow) {
+                        RefreshMemoryReport();
+                    }
+                }
+                bool profiling = varswap::AllocProfiler::instance().enabled();
+                if (ImGui::MenuItem("Allocation Profiling", nullptr, profiling)) {
+                    SetAllocProfiling(!profiling, true);
+                }
+                if (ImGui::MenuItem("Allocation Profile", nullptr, showAllocProfileWindow)) {
+                    showAllocProfileWindow = !showAllocProfileWindow;
+                }
+                ImGui::EndMenu();
+            }
             ImGui::EndMainMenuBar();
         }
     }
 
+    void RefreshMemoryReport() {
+        documentMemory = frameData.memoryReport();
+        paneMemory = pane ? pane->memoryReport() : MemoryReport();
+    }
+
+    static void DrawMemoryTable(const char* id, const MemoryReport& report) {
+        ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp;
+        if (!ImGui::BeginTable(id, 5, flags)) {
+            return;
+        }
+        ImGui::TableSetupColumn("Component");
+        ImGui::TableSetupColumn("Reserved");
+        ImGui::TableSetupColumn("Slack");
+        ImGui::TableSetupColumn("Overhead");
+        ImGui::TableSetupColumn("Allocs");
+        ImGui::TableHeadersRow();
+        auto row = [](const char* label, const MemoryUsage& usage) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(label);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f KiB", usage.bytes / 1024.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f KiB", (usage.bytes - usage.used) / 1024.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f KiB", usage.overhead / 1024.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", usage.allocations);
+        };
+        for (const auto& component : report.components) {
+            row(component.name.c_str(), component.usage);
+        }
+        row("total", report.total());
+        ImGui::EndTable();
+    }
+
+    void DrawMemoryWindow() {
+        if (!showMemoryWindow) {
+            return;
+        }
+        ImGui::SetNextWindowSize(ImVec2(520.f, 560.f), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Memory Report", &showMemoryWindow)) {
+            if (ImGui::Button("Refresh")) {
+                RefreshMemoryReport();
+            }
+            ImGui::SameLine();
+            MemoryUsage total = documentMemory.total();
+            total += paneMemory.total();
+            ImGui::TextDisabled("Estimated heap: %.2f MiB", total.total() / (1024.0 * 1024.0));
+
+            ImGui::SeparatorText("Document");
+            DrawMemoryTable("DocumentMemory", documentMemory);
+            ImGui::SeparatorText("VarSwap pane");
+            DrawMemoryTable("PaneMemory", paneMemory);
+
+            ImGui::SeparatorText("Patterns");
+            std::vector<MemoryReport::SequenceUsage> perSequence = documentMemory.sequences;
+            for (auto& entry : perSequence) {
+                if (entry.index >= 0 && entry.index < static_cast<int>(paneMemory.sequences.size())) {
+                    entry.usage += paneMemory.sequences[entry.index].usage;
+                }
+            }
+            std::stable_sort(perSequence.begin(), perSequence.end(), [](const auto& a, const auto& b) {
+                return a.usage.total() > b.usage.total();
+            });
+            ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingStretchProp;
+            if (ImGui::BeginTable("SequenceMemory", 3, flags, ImVec2(0.f, 0.f))) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Pattern");
+                ImGui::TableSetupColumn("Heap");
+                ImGui::TableSetupColumn("Allocs");
+                ImGui::TableHeadersRow();
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(perSequence.size()));
+                while (clipper.Step()) {
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                        const auto& entry = perSequence[i];
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%03d%s", entry.index, entry.shared ? " (shared)" : "");
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.1f KiB", entry.usage.total() / 1024.0);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%zu", entry.usage.allocations);
+                    }
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
+
+    static std::string FormatBytes(std::uint64_t bytes) {
+        char buffer[32];
+        if (bytes >= 1024ull * 1024ull) {
+            std::snprintf(buffer, sizeof(buffer), "%.2f MiB", bytes / (1024.0 * 1024.0));
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "%.1f KiB", bytes / 1024.0);
+        }
+        return buffer;
+    }
+
+    void DrawAllocProfileWindow() {
+        if (!showAllocProfileWindow) {
+            return;
+        }
+        ImGui::SetNextWindowSize(ImVec2(640.f, 300.f), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Allocation Profile", &showAllocProfileWindow)) {
+            varswap::AllocProfiler& profiler = varswap::AllocProfiler::instance();
+            bool profiling = profiler.enabled();
+            if (ImGui::Checkbox("Enabled", &profiling)) {
+                SetAllocProfiling(profiling, true);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Reset")) {
+                profiler.reset();
+            }
+            if (!profiling) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("Start with --profile or set AllocProfile=1 in varswap_workbench.ini.");
+            }
+
+            ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp;
+            if (ImGui::BeginTable("AllocProfile", 7, flags)) {
+                ImGui::TableSetupColumn("Phase");
+                ImGui::TableSetupColumn("Runs");
+                ImGui::TableSetupColumn("Allocs");
+                ImGui::TableSetupColumn("Frees");
+                ImGui::TableSetupColumn("Allocated");
+                ImGui::TableSetupColumn("Peak live");
+                ImGui::TableSetupColumn("Peak growth");
+                ImGui::TableHeadersRow();
+                for (const auto& stats : profiler.phases()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(stats.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%llu", static_cast<unsigned long long>(stats.runs));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%llu", static_cast<unsigned long long>(stats.allocations));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%llu", static_cast<unsigned long long>(stats.frees));
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(FormatBytes(stats.bytesAllocated).c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(FormatBytes(stats.peakLiveBytes).c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(FormatBytes(stats.peakGrowth).c_str());
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
+
     void DrawStatusBar() {
         const ImGuiViewport* viewport = ImGui::GetMainViewport();
         ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x, viewport->Pos.y + viewport->Size.y - 22));
@@ -300,6 +568,13 @@ private:
                     Save();
                 }
             }
+            // Text fields keep Ctrl+Z/Ctrl+Y for their own undo.
+            if (!io.WantTextInput && ImGui::IsKeyPressed(ImGuiKey_Z, false)) {
+                pane->Undo();
+            }
+            if (!io.WantTextInput && ImGui::IsKeyPressed(ImGuiKey_Y, false)) {
+                pane->Redo();
+            }
         }
     }
 
@@ -346,7 +621,10 @@ private:
 
     bool SaveToPath(const std::string& path) {
         std::string normalized = NormalizePath(path);
-        frameData.save(normalized.c_str());
+        {
+            varswap::AllocProfiler::Scope phase("save");
+            frameData.save(normalized.c_str());
+        }
         std::error_code ec;
         if (!std::filesystem::exists(normalized, ec)) {
             auto title = Utf8ToWide("Failed to save " + normalized);
@@ -417,6 +695,23 @@ private:
         return false;
     }
 
+    // Extra or overridden occurrence kinds from varswap_schema.txt in the
+    // working directory, next to the layout ini.
+    void LoadSchemaOverrides() {
+        std::error_code ec;
+        std::filesystem::path path = std::filesystem::current_path(ec) / "varswap_schema.txt";
+        if (ec || !std::filesystem::exists(path, ec)) {
+            return;
+        }
+        varswap::OccurrenceSchema schema = varswap::OccurrenceSchema::builtIn();
+        std::string error;
+        if (!schema.loadFile(path.string(), error) || !varswap::installSchema(schema, error)) {
+            SetStatus("Schema not loaded: " + error);
+            return;
+        }
+        SetStatus("Loaded " + std::to_string(schema.kinds().size()) + " occurrence kinds from varswap_schema.txt");
+    }
+
     void SetStatus(const std::string& text) {
         statusMessage = text;
     }
@@ -442,9 +737,26 @@ private:
         SetWindowTextW(mainWindowHandle, title.c_str());
     }
 
+    // Scans the freshly loaded document, reusing the sidecar next to
+    // `documentPath` when it was written for these exact file contents.
+    void RescanLoaded(const std::string& documentPath, const std::vector<std::string>& contentPaths) {
+        std::uint64_t contentHash = 0;
+        std::string error;
+        if (!varswap::hashFileContents(contentPaths, contentHash, error)) {
+            pane->ForceRescan();
+            return;
+        }
+        pane->RescanWithSidecar(varswap::scanSidecarPath(documentPath), contentHash);
+    }
+
     bool LoadHa6File(const std::string& path) {
         FrameData newData;
-        if (!newData.load(path.c_str())) {
+        bool loaded;
+        {
+            varswap::AllocProfiler::Scope phase("load");
+            loaded = newData.load(path.c_str());
+        }
+        if (!loaded) {
             auto title = Utf8ToWide("Failed to load " + path);
             MessageBoxW(mainWindowHandle, title.c_str(), L"VarSwap Workbench", MB_ICONERROR | MB_OK);
             SetStatus("Load failed");
@@ -456,7 +768,7 @@ private:
         currentTxtPath.clear();
         layeredHa6Paths.clear();
         layeredHa6Paths.push_back(path);
-        pane->ForceRescan();
+        RescanLoaded(path, layeredHa6Paths);
         MarkDirty(false);
         SetStatus("Loaded " + FormatNiceName(path));
         return true;
@@ -492,7 +804,12 @@ private:
             std::filesystem::path candidate = baseFolder / ha6file;
             std::string normalized = NormalizePath(candidate.string());
             bool patch = !loadedPaths.empty();
-            if (!newData.load(normalized.c_str(), patch)) {
+            bool loaded;
+            {
+                varswap::AllocProfiler::Scope phase("load");
+                loaded = newData.load(normalized.c_str(), patch);
+            }
+            if (!loaded) {
                 auto title = Utf8ToWide("Failed to load " + normalized + " from " + path);
                 MessageBoxW(mainWindowHandle, title.c_str(), L"VarSwap Workbench", MB_ICONERROR | MB_OK);
                 SetStatus("Load failed");
@@ -512,7 +829,7 @@ private:
         currentTxtPath = path;
         layeredHa6Paths = loadedPaths;
         currentFilePath = layeredHa6Paths.back();
-        pane->ForceRescan();
+        RescanLoaded(path, layeredHa6Paths);
         MarkDirty(false);
         std::string label = "Loaded " + FormatNiceName(path) + " (" + FormatNiceName(currentFilePath) + ")";
         SetStatus(label);
@@ -572,16 +889,22 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR pCmdLine, int nCmdShow
     DragAcceptFiles(hwnd, TRUE);
 
     std::wstring startupPath;
+    bool profileFlag = false;
     int argc = 0;
     LPWSTR fullCmd = GetCommandLineW();
     LPWSTR* argv = CommandLineToArgvW(fullCmd, &argc);
     if (argv) {
         for (int i = 1; i < argc; ++i) {
+            if (argv[i] && std::wcscmp(argv[i], L"--profile") == 0) {
+                profileFlag = true;
+                continue;
+            }
             if (!argv[i] || argv[i][0] == L'-' || argv[i][0] == L'/') {
                 continue;
             }
-            startupPath = argv[i];
-            break;
+            if (startupPath.empty()) {
+                startupPath = argv[i];
+            }
         }
         LocalFree(argv);
     }
@@ -606,6 +929,12 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR pCmdLine, int nCmdShow
             continue;
         }
 
+        // --profile covers this session only; the Debug menu persists it.
+        if (profileFlag) {
+            frame->SetAllocProfiling(true, false);
+            profileFlag = false;
+        }
+
         if (!startupPath.empty()) {
             frame->LoadFile(WideToUtf8(startupPath));
             startupPath.clear();
@@ -641,6 +970,10 @@ LRESULT CALLBACK WorkbenchWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPa
         int appendAt = GetCurrentDirectoryA(MAX_PATH, gIniPath);
         strcpy_s(gIniPath + appendAt, MAX_PATH - appendAt, "\\varswap_workbench.ini");
         io.IniFilename = gIniPath;
+        // Read now rather than on the first frame, so the frame below starts
+        // with the stored workbench settings.
+        RegisterWorkbenchSettings();
+        ImGui::LoadIniSettingsFromDisk(gIniPath);
 
         LoadJapaneseFonts(io);
 